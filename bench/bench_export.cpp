@@ -0,0 +1,69 @@
+// Serializer cost and output size per sample for the headless exporter,
+// writing a synthetic 50k-process snapshot in every format to an unlinked
+// temporary file, whose offset gives the bytes written.
+//
+//   bench_export [processes] [iterations]
+#include "exporter.h"
+#include "name_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+int main(int argc, char** argv) {
+    int processes = argc > 1 ? std::atoi(argv[1]) : 50000;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    Snapshot snapshot;
+    snapshot.timestamp_ms = 1700000000000LL;
+    snapshot.has_processes = true;
+    snapshot.stats.cpu_percent = 42.5f;
+    snapshot.stats.mem_total = 16 * 1024 * 1024;
+    snapshot.stats.mem_used = 8 * 1024 * 1024;
+    snapshot.stats.disks = {{"nvme0n1", 120.5f, 30.25f}};
+    snapshot.stats.network = {{"eth0", 900.0f, 450.0f}};
+    snapshot.processes.resize(processes);
+    for (int i = 0; i < processes; ++i) {
+        ProcessData& p = snapshot.processes[i];
+        p.pid = i + 1;
+        p.ppid = i / 10 + 1;
+        p.name = InternProcessName(i % 97 ? "postgres" : "tmux: \"server\"");
+        p.state = 'S';
+        p.memory = 1000 + i * 13;
+        p.cpu_usage = (float)(i % 400) / 4.0f;
+        p.io_read_rate = (float)(i % 100);
+        p.io_write_rate = (float)(i % 50);
+    }
+
+    struct Format { ExportFormat format; const char* name; };
+    const Format formats[] = {{ExportFormat::CSV, "csv"}, {ExportFormat::JSONL, "jsonl"}, {ExportFormat::BINARY, "binary"}};
+
+    std::printf("%d processes, best of %d\n", processes, iterations);
+    std::printf("%-8s %12s %14s %12s\n", "format", "ms/sample", "bytes/sample", "max Hz");
+    for (const Format& f : formats) {
+        // A regular file, so the size per sample can be measured.
+        char path[] = "/tmp/pm-export-XXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0) {
+            std::perror("mkstemp");
+            return 1;
+        }
+        unlink(path);
+
+        SnapshotWriter writer(f.format, fd);
+        writer.Write(snapshot); // Header and first frame
+        off_t before = lseek(fd, 0, SEEK_CUR);
+        double best = 1e300;
+        for (int i = 0; i < iterations; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            writer.Write(snapshot);
+            auto end = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        double bytes = (double)(lseek(fd, 0, SEEK_CUR) - before) / iterations;
+        close(fd);
+        std::printf("%-8s %12.2f %14.0f %12.0f\n", f.name, best, bytes, 1000.0 / best);
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+// GPU collection against a stub nvidia-smi on PATH (no GPU needed): the
+// cost of one sample with the old per-tick popen() versus a copy of the
+// background collector's cache, the stub being parsed as it streams, values
+// going stale when it stops, and the restart backoff when the tool is
+// missing.
+//
+//   bench_gpu [iterations]
+#include "gpu_collector.h"
+#include "proc_fixture.h"
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+
+namespace {
+
+// Streams two GPUs every -lms milliseconds. STUB_BATCHES limits the output.
+const char kStub[] =
+    "#!/bin/sh\n"
+    "ms=1000; prev=\n"
+    "for a in \"$@\"; do [ \"$prev\" = -lms ] && ms=$a; prev=$a; done\n"
+    "i=0\n"
+    "while [ -z \"$STUB_BATCHES\" ] || [ $i -lt \"$STUB_BATCHES\" ]; do\n"
+    "  echo \"0, Stub GPU A100, $((i % 100)), 1024, 40960\"\n"
+    "  echo \"1, Stub GPU, [N/A], 2048, 8192\"\n"
+    "  i=$((i + 1))\n"
+    "  [ \"$i\" = \"$STUB_BATCHES\" ] && break\n"
+    "  sleep $(awk \"BEGIN { print $ms / 1000 }\")\n"
+    "done\n";
+
+// The collector as it was: one popen() per sample, read to EOF.
+double LegacySampleMs() {
+    auto start = std::chrono::steady_clock::now();
+    FILE* pipe = popen("STUB_BATCHES=1 nvidia-smi --query-gpu=index,name,utilization.gpu,memory.used,memory.total --format=csv,noheader,nounits", "r");
+    std::array<char, 128> buffer;
+    while (pipe && fgets(buffer.data(), buffer.size(), pipe) != nullptr) {}
+    if (pipe) pclose(pipe);
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool WaitFor(const GpuCollector& collector, std::vector<GpuStats>& gpus, bool (*done)(const std::vector<GpuStats>&)) {
+    for (int i = 0; i < 200; ++i) {
+        collector.Copy(gpus);
+        if (done(gpus)) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 20;
+
+    std::string dir = MakeTempDir("gpu");
+    {
+        std::ofstream stub(dir + "/nvidia-smi");
+        stub << kStub;
+    }
+    chmod((dir + "/nvidia-smi").c_str(), 0755);
+    std::string path = std::getenv("PATH") ? std::getenv("PATH") : "/usr/bin:/bin";
+    setenv("PATH", (dir + ":" + path).c_str(), 1);
+    int errors = 0;
+
+    double legacy = 0;
+    for (int i = 0; i < iterations; ++i) legacy += LegacySampleMs();
+
+    std::vector<GpuStats> gpus;
+    {
+        GpuCollector collector;
+        collector.Start(std::chrono::milliseconds(100));
+        if (!WaitFor(collector, gpus, [](const std::vector<GpuStats>& g) { return g.size() == 2; })) ++errors;
+        else if (gpus[0].name != "Stub GPU A100" || gpus[0].mem_total_mb != 40960 || gpus[1].utilization != 0) ++errors;
+
+        auto start = std::chrono::steady_clock::now();
+        const int copies = 100000;
+        for (int i = 0; i < copies; ++i) collector.Copy(gpus);
+        double copy_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / copies;
+        std::printf("per sample: popen %.2f ms, cached copy %.3f us\n", legacy / iterations, copy_us);
+        std::printf("streaming parse: %s, spawns %u\n", errors ? "FAILED" : "ok", collector.Spawns());
+    }
+
+    // The stub exits after a few batches: values age and go stale, and the
+    // restart waits for the backoff.
+    setenv("STUB_BATCHES", "3", 1);
+    {
+        GpuCollector collector;
+        collector.Start(std::chrono::milliseconds(100));
+        bool stale = WaitFor(collector, gpus, [](const std::vector<GpuStats>& g) { return !g.empty() && g[0].stale; });
+        std::printf("stale after exit: %s (age %d ms), spawns %u\n", stale ? "ok" : "FAILED",
+                    gpus.empty() ? 0 : gpus[0].age_ms, collector.Spawns());
+        if (!stale || collector.Spawns() != 1) ++errors;
+    }
+    unsetenv("STUB_BATCHES");
+
+    // No nvidia-smi at all: a handful of attempts, not one per tick.
+    setenv("PATH", path.c_str(), 1);
+    {
+        GpuCollector collector;
+        collector.Start(std::chrono::milliseconds(100));
+        std::this_thread::sleep_for(std::chrono::milliseconds(3500));
+        collector.Copy(gpus);
+        std::printf("missing tool: %u spawn attempts in 3.5 s (backoff from %lld ms), %zu gpus\n", collector.Spawns(),
+                    (long long)GpuCollector::kInitialBackoff.count(), gpus.size());
+        if (collector.Spawns() > 3 || !gpus.empty()) ++errors;
+    }
+
+    RemoveTree(dir);
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+// History store overhead: bytes per process and time per tick for a
+// synthetic process table (mostly idle, a few busy), plus checks of the
+// compressed series' running means and of the store's one- and five-minute
+// windows against a plain recomputation, and that within the cap every
+// process's CPU series holds its full five minutes.
+//
+//   bench_history [processes] [ticks] [cap_mb]
+#include "history.h"
+#include "sampler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+
+namespace {
+
+// Appends random values with evictions, the limits shrinking now and then
+// as after a gap in sampling, and compares both means with the values kept
+// in a deque. Returns the number of mismatches.
+int CheckSeries() {
+    MemoryBudget budget(1 << 20);
+    CompressedSeries series;
+    std::deque<long long> reference;
+    unsigned long long x = 12345;
+    size_t window = 0;
+    int errors = 0;
+    for (int i = 0; i < 2000; ++i) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        long long value = (long long)(x >> 40) % 5000 - (i % 7 == 0 ? 100000 : 0);
+        size_t max_samples = i % 101 == 0 ? 3 : 50;
+        // Samples that left the window never come back into it.
+        window = std::min({window + 1, i % 89 == 0 ? (size_t)1 : (size_t)12, max_samples});
+        series.Append(value, max_samples, window, budget);
+        reference.push_back(value);
+        while (reference.size() > max_samples) reference.pop_front();
+
+        double all = 0, recent = 0;
+        for (size_t j = 0; j < reference.size(); ++j) {
+            all += reference[j];
+            if (j + window >= reference.size()) recent += reference[j];
+        }
+        all /= reference.size();
+        recent /= std::min(window, reference.size());
+        if (series.Size() != reference.size() || std::fabs(all - series.Mean()) > 1e-6 || std::fabs(recent - series.WindowMean()) > 1e-6) ++errors;
+    }
+    std::vector<float> decoded;
+    series.Recent(reference.size(), 1.0f, decoded);
+    for (size_t j = 0; j < decoded.size(); ++j) {
+        if ((long long)decoded[j] != reference[j]) ++errors;
+    }
+    return errors;
+}
+
+// Records one process through a HistoryStore at irregular times -- mostly
+// every second, with extra samples in between and gaps -- and checks its
+// 1m and 5m CPU averages against the samples of the last one and five
+// minutes. Returns the number of mismatches.
+int CheckWindows() {
+    HistoryStore store(std::chrono::milliseconds(1000), 1 << 20);
+    Snapshot snapshot;
+    snapshot.has_processes = true;
+    snapshot.processes.resize(1);
+    snapshot.processes[0].pid = 1;
+    snapshot.processes[0].starttime = 1;
+    snapshot.timestamp_ms = 1700000000000LL;
+    struct Sample { long long time; float cpu; };
+    std::deque<Sample> reference;
+    int errors = 0;
+    for (int i = 0; i < 3000; ++i) {
+        if (i % 5 == 0) snapshot.timestamp_ms += 40;            // An extra sample
+        else if (i % 397 == 0) snapshot.timestamp_ms += 90000; // A gap
+        else snapshot.timestamp_ms += 1000;
+        ProcessData& p = snapshot.processes[0];
+        p.cpu_usage = (float)(i % 13) * 7.5f;
+        store.Record(snapshot);
+        reference.push_back({snapshot.timestamp_ms, p.cpu_usage});
+        while (snapshot.timestamp_ms - reference.front().time >= 5 * 60 * 1000) reference.pop_front();
+
+        double all = 0, recent = 0;
+        int in_window = 0;
+        for (const Sample& s : reference) {
+            all += s.cpu;
+            if (snapshot.timestamp_ms - s.time < 60 * 1000) {
+                recent += s.cpu;
+                ++in_window;
+            }
+        }
+        if (std::fabs(all / reference.size() - p.cpu_avg_5m) > 1e-3 ||
+            std::fabs(recent / in_window - p.cpu_avg_1m) > 1e-3) {
+            ++errors;
+        }
+    }
+    return errors;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int processes = argc > 1 ? std::atoi(argv[1]) : 50000;
+    int ticks = argc > 2 ? std::atoi(argv[2]) : 300;
+    size_t cap_mb = argc > 3 ? (size_t)std::atoll(argv[3]) : 64;
+
+    int errors = CheckSeries();
+    std::printf("series check: %s\n", errors ? "FAILED" : "ok");
+    int window_errors = CheckWindows();
+    std::printf("window check: %s\n", window_errors ? "FAILED" : "ok");
+    errors += window_errors;
+
+    HistoryStore store(std::chrono::milliseconds(1000), cap_mb << 20);
+    Snapshot snapshot;
+    snapshot.has_processes = true;
+    snapshot.processes.resize(processes);
+    for (int i = 0; i < processes; ++i) {
+        snapshot.processes[i].pid = i + 1;
+        snapshot.processes[i].starttime = 1000 + i;
+        snapshot.processes[i].memory = 4000 + i % 1000;
+    }
+
+    double total_ms = 0;
+    unsigned long long x = 42;
+    for (int t = 0; t < ticks; ++t) {
+        for (int i = 0; i < processes; ++i) {
+            ProcessData& p = snapshot.processes[i];
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            bool busy = i % 20 == 0;
+            p.cpu_usage = busy ? (float)((x >> 33) % 10000) / 100.0f : 0.0f;
+            p.io_read_rate = busy ? (float)((x >> 20) % 2000) : 0.0f;
+            if (busy) p.memory += (long)((x >> 50) % 64) - 32;
+        }
+        snapshot.timestamp_ms += 1000;
+        auto start = std::chrono::steady_clock::now();
+        store.Record(snapshot);
+        total_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::printf("%d processes x %d ticks, cap %zu MiB\n", processes, ticks, cap_mb);
+    std::printf("tracked %zu, store %.1f MiB, %.0f bytes/process, %.2f ms/tick (%.0f ns/process)\n",
+                store.TrackedProcesses(), store.BytesUsed() / 1048576.0,
+                (double)store.BytesUsed() / processes, total_ms / ticks, total_ms / ticks * 1e6 / processes);
+
+    // Samples were a second apart: the CPU series should hold the last five
+    // minutes of them, none dropped to stay under the cap.
+    size_t expected = (size_t)std::min(ticks, 300);
+    int short_series = 0;
+    for (const ProcessData& p : snapshot.processes) {
+        const CompressedSeries* cpu = store.ProcessCpu(p.pid, p.starttime);
+        if (!cpu || cpu->Size() != expected) ++short_series;
+    }
+    std::printf("full series check: %s (%d of %d processes short of %zu samples)\n", short_series ? "FAILED" : "ok",
+                short_series, processes, expected);
+    errors += short_series;
+
+    // Every process exits: the store must give all of it back.
+    snapshot.processes.clear();
+    store.Record(snapshot);
+    std::printf("after all exit: tracked %zu, %zu bytes\n", store.TrackedProcesses(), store.BytesUsed());
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+// Load test for the metrics endpoint. The collector samples a synthetic
+// /proc tree at a fixed interval, publishing every sample, while scraper
+// threads pull /metrics over keep-alive connections (loopback TCP, then a
+// Unix socket), first at a fixed rate and then as fast as they can. Each
+// row reports the scrapes served and their latency next to the collector's
+// tick time, which the scrapers should not move: a scrape only copies a
+// pointer under the lock the collector publishes with.
+//
+// On a machine with fewer cores than scrapers + 1, the unthrottled rows also
+// measure the scrapers competing with the collector for CPU.
+//
+//   bench_metrics [processes] [ticks] [interval_ms] [scrapers] [scrapes_per_second]
+#include "metrics_server.h"
+#include "proc_fixture.h"
+#include "process_parser.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int Connect(const std::string& address) {
+    if (address.compare(0, 5, "unix:") == 0) {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", address.c_str() + 5);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, (const sockaddr*)&addr, sizeof(addr)) == 0) return fd;
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)std::atoi(address.c_str() + address.rfind(':') + 1));
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, (const sockaddr*)&addr, sizeof(addr)) == 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return fd;
+    }
+    if (fd >= 0) close(fd);
+    return -1;
+}
+
+// Sends one GET and reads the whole response; false on a broken connection
+// or a status other than 200.
+bool Scrape(int fd, std::vector<char>& buf) {
+    static const char kRequest[] = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    if (send(fd, kRequest, sizeof(kRequest) - 1, MSG_NOSIGNAL) != (ssize_t)sizeof(kRequest) - 1) return false;
+    size_t len = 0;
+    size_t total = 0; // Header plus body, once the header is in
+    while (total == 0 || len < total) {
+        if (len == buf.size()) buf.resize(buf.size() * 2);
+        ssize_t n = recv(fd, buf.data() + len, buf.size() - len, 0);
+        if (n <= 0) return false;
+        len += n;
+        if (total == 0) {
+            std::string_view text(buf.data(), len);
+            size_t end = text.find("\r\n\r\n");
+            if (end == std::string_view::npos) continue;
+            if (text.compare(0, 12, "HTTP/1.1 200") != 0) return false;
+            size_t field = text.find("Content-Length: ");
+            if (field == std::string_view::npos || field > end) return false;
+            total = end + 4 + std::strtoull(buf.data() + field + 16, nullptr, 10);
+        }
+    }
+    return true;
+}
+
+struct ScraperResult {
+    std::vector<double> latencies_us;
+    long failures = 0;
+};
+
+// Scrapes `address` until `stop`, at `rate` per second (0: back to back).
+void RunScraper(const std::string& address, double rate, const std::atomic<bool>& stop, ScraperResult& result) {
+    int fd = Connect(address);
+    std::vector<char> buf(64 * 1024);
+    auto next = Clock::now();
+    auto period = rate > 0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate))
+                           : Clock::duration::zero();
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (rate > 0) {
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+        if (fd < 0) fd = Connect(address);
+        auto start = Clock::now();
+        if (fd < 0 || !Scrape(fd, buf)) {
+            ++result.failures;
+            if (fd >= 0) close(fd);
+            fd = -1;
+            continue;
+        }
+        result.latencies_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+    if (fd >= 0) close(fd);
+}
+
+double Percentile(std::vector<double>& values, double p) {
+    if (values.empty()) return 0.0;
+    size_t i = std::min(values.size() - 1, (size_t)(p * (double)values.size()));
+    std::nth_element(values.begin(), values.begin() + i, values.end());
+    return values[i];
+}
+
+struct Options {
+    int ticks;
+    std::chrono::milliseconds interval;
+    int scrapers;
+};
+
+// Samples `options.ticks` times at the interval while `scrapers` threads
+// scrape `address` at `rate` each, then prints a row.
+void Row(const char* label, SnapshotCollector& collector, const std::string& address, int scrapers, double rate,
+         const Options& options) {
+    std::atomic<bool> stop{false};
+    std::vector<ScraperResult> results(scrapers);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < scrapers; ++i) {
+        threads.emplace_back(RunScraper, address, rate, std::cref(stop), std::ref(results[i]));
+    }
+
+    Snapshot snapshot;
+    std::vector<double> ticks_ms;
+    auto start = Clock::now();
+    auto next = start;
+    for (int i = 0; i < options.ticks; ++i) {
+        next += options.interval;
+        std::this_thread::sleep_until(next);
+        auto tick_start = Clock::now();
+        collector.Collect(snapshot, true, true);
+        ticks_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - tick_start).count());
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    stop = true;
+    for (std::thread& thread : threads) thread.join();
+
+    std::vector<double> latencies;
+    long failures = 0;
+    for (ScraperResult& result : results) {
+        latencies.insert(latencies.end(), result.latencies_us.begin(), result.latencies_us.end());
+        failures += result.failures;
+    }
+    std::printf("%-14s %8.0f %8ld %9.1f %9.1f %9.2f %9.2f %9.2f\n", label, (double)latencies.size() / seconds, failures,
+                Percentile(latencies, 0.5), Percentile(latencies, 0.99), Percentile(ticks_ms, 0.5),
+                Percentile(ticks_ms, 0.99), *std::max_element(ticks_ms.begin(), ticks_ms.end()));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ProcFixtureOptions fixture;
+    fixture.processes = argc > 1 ? std::atoi(argv[1]) : 2000;
+    Options options;
+    options.ticks = argc > 2 ? std::atoi(argv[2]) : 40;
+    options.interval = std::chrono::milliseconds(argc > 3 ? std::atoi(argv[3]) : 50);
+    options.scrapers = argc > 4 ? std::atoi(argv[4]) : 4;
+    double rate = argc > 5 ? std::atof(argv[5]) : 2000.0;
+    double per_scraper = options.scrapers > 0 ? rate / options.scrapers : 0.0;
+
+    std::string root = MakeTempDir("metrics");
+    WriteProcFixture(root, fixture);
+    SetProcRoot(root);
+
+    std::printf("# bench_metrics processes=%d ticks=%d interval_ms=%lld scrapers=%d target=%.0f/s\n", fixture.processes,
+                options.ticks, (long long)options.interval.count(), options.scrapers, rate);
+    std::printf("%-14s %8s %8s %9s %9s %9s %9s %9s\n", "row", "scrape/s", "failed", "p50_us", "p99_us", "tick_p50",
+                "tick_p99", "tick_max");
+
+    SnapshotCollector collector;
+    Snapshot snapshot;
+    collector.Collect(snapshot, true, true); // Primes the rates
+    Row("no server", collector, "", 0, 0.0, options);
+
+    struct Transport { const char* name; std::string address; };
+    const Transport transports[] = {{"tcp", "127.0.0.1:0"}, {"unix", "unix:" + root + "/metrics.sock"}};
+    for (const Transport& transport : transports) {
+        MetricsServer server;
+        std::string error;
+        if (!server.Start(transport.address, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        collector.SetMetrics(&server);
+        collector.Collect(snapshot, true, true); // Something to serve
+
+        std::string label = std::string(transport.name) + " idle";
+        Row(label.c_str(), collector, server.Address(), 0, 0.0, options);
+        label = std::string(transport.name) + " paced";
+        Row(label.c_str(), collector, server.Address(), options.scrapers, per_scraper, options);
+        label = std::string(transport.name) + " flood";
+        Row(label.c_str(), collector, server.Address(), options.scrapers, 0.0, options);
+
+        // Rendering cost alone, for the last sample.
+        auto start = Clock::now();
+        const int publishes = 200;
+        for (int i = 0; i < publishes; ++i) server.Publish(snapshot);
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / publishes;
+        std::printf("# %s: Publish() %.1f us per sample, %llu scrapes served\n", transport.name, us,
+                    (unsigned long long)server.Scrapes());
+        collector.SetMetrics(nullptr);
+    }
+
+    std::filesystem::remove_all(root);
+    return 0;
+}
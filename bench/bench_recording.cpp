@@ -0,0 +1,190 @@
+// Record/replay: bytes and time per frame for a synthetic process table
+// (1 in 20 processes busy, a few starting and exiting every tick), a
+// round-trip check of every frame, seek latency through the time index, and
+// recovery of a recording whose index was never written.
+//
+//   bench_recording [processes] [frames]
+#include "exporter.h"
+#include "name_pool.h"
+#include "recording.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+bool SameProcess(const ProcessData& a, const ProcessData& b) {
+    return a.pid == b.pid && a.ppid == b.ppid && a.name == b.name && a.state == b.state &&
+           a.memory == b.memory && a.utime == b.utime && a.stime == b.stime && a.starttime == b.starttime &&
+           a.cpu_usage == b.cpu_usage && a.read_bytes == b.read_bytes && a.write_bytes == b.write_bytes &&
+           a.io_read_rate == b.io_read_rate && a.io_write_rate == b.io_write_rate;
+}
+
+// Advances the synthetic system by one tick.
+void Tick(Snapshot& s, int tick, std::mt19937& rng) {
+    s.timestamp_ms = 1700000000000LL + tick * 1000LL;
+    s.stats.cpu_percent = (float)(rng() % 10000) / 100.0f;
+    s.stats.mem_used = s.stats.mem_total / 2 + (long)(rng() % 100000);
+    s.stats.mem_free = s.stats.mem_total - s.stats.mem_used;
+    for (DiskStats& d : s.stats.disks) d.read_rate_kb = (float)(rng() % 5000);
+    for (ProcessData& p : s.processes) {
+        bool busy = p.pid % 20 == 0;
+        if (busy) {
+            p.utime += rng() % 100;
+            p.stime += rng() % 10;
+            p.memory += (long)(rng() % 64) - 32;
+            p.read_bytes += rng() % 100000;
+            p.cpu_usage = (float)(rng() % 10000) / 100.0f;
+            p.io_read_rate = (float)(rng() % 2000);
+            p.state = rng() % 4 ? 'R' : 'S';
+        } else {
+            p.cpu_usage = 0.0f;
+            p.io_read_rate = 0.0f;
+        }
+    }
+    // Churn: a few exits and PID reuse with a new starttime.
+    for (int i = 0; i < 5; ++i) {
+        ProcessData& p = s.processes[rng() % s.processes.size()];
+        p.starttime = 100000 + tick;
+        p.name = InternProcessName("worker-" + std::to_string(tick));
+        p.utime = p.stime = 0;
+        p.read_bytes = p.write_bytes = 0;
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int processes = argc > 1 ? std::atoi(argv[1]) : 50000;
+    int frames = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    Snapshot snapshot;
+    snapshot.has_processes = true;
+    snapshot.has_devices = true;
+    snapshot.stats.mem_total = 16 * 1024 * 1024;
+    snapshot.stats.disks = {{"nvme0n1", 0.0f, 0.0f, {}}, {"sda", 0.0f, 0.0f, {}}};
+    snapshot.stats.network = {{"eth0", 900.0f, 450.0f, {}}};
+    snapshot.processes.resize(processes);
+    for (int i = 0; i < processes; ++i) {
+        ProcessData& p = snapshot.processes[i];
+        p = {};
+        p.pid = i + 1;
+        p.ppid = i / 10 + 1;
+        p.name = InternProcessName(i % 97 ? "postgres" : "tmux: \"server\"");
+        p.state = 'S';
+        p.memory = 1000 + i * 13;
+        p.starttime = 5000 + i;
+        p.utime = i;
+    }
+
+    std::string path = "/tmp/pm-recording-" + std::to_string(getpid());
+    unlink(path.c_str());
+    std::mt19937 rng(7);
+    std::vector<Snapshot> expected;
+    double append_ms = 0;
+    {
+        RecordingWriter writer;
+        std::string error;
+        if (!writer.Open(path, std::chrono::milliseconds(1000), error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        for (int t = 0; t < frames; ++t) {
+            Tick(snapshot, t, rng);
+            if (t % 50 == 0 || t == frames - 1) expected.push_back(snapshot);
+            auto start = std::chrono::steady_clock::now();
+            writer.Append(snapshot);
+            append_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+    struct stat st;
+    stat(path.c_str(), &st);
+    // The binary export frame of the last sample, for comparison.
+    double export_bytes = 0;
+    {
+        char export_path[] = "/tmp/pm-export-XXXXXX";
+        int fd = mkstemp(export_path);
+        if (fd < 0) return 1;
+        unlink(export_path);
+        {
+            SnapshotWriter exporter(ExportFormat::BINARY, fd);
+            exporter.Write(snapshot);
+        }
+        struct stat est;
+        fstat(fd, &est);
+        export_bytes = (double)est.st_size - 8; // Minus the stream header
+        close(fd);
+    }
+
+    RecordingReader reader;
+    std::string error;
+    if (!reader.Open(path, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    RecordingCursor cursor(reader);
+    cursor.Restart(0);
+    Snapshot decoded;
+    int errors = 0;
+    size_t next_expected = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < frames; ++t) {
+        if (!cursor.Next(decoded)) {
+            ++errors;
+            break;
+        }
+        if (next_expected < expected.size() && expected[next_expected].timestamp_ms == decoded.timestamp_ms) {
+            const Snapshot& want = expected[next_expected++];
+            bool same = want.processes.size() == decoded.processes.size() &&
+                        want.stats.cpu_percent == decoded.stats.cpu_percent &&
+                        want.stats.disks.size() == decoded.stats.disks.size();
+            std::vector<ProcessData> sorted = want.processes; // Decoded rows are in PID order
+            std::sort(sorted.begin(), sorted.end(), [](const ProcessData& a, const ProcessData& b) { return a.pid < b.pid; });
+            for (size_t i = 0; same && i < sorted.size(); ++i) same = SameProcess(sorted[i], decoded.processes[i]);
+            if (!same) ++errors;
+        }
+    }
+    double decode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (next_expected != expected.size()) ++errors;
+
+    // Random seeks: index lookup, then decode up to the target.
+    const int seeks = 50;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < seeks; ++i) {
+        long long target = reader.FirstTimestamp() + (long long)(rng() % (unsigned)(reader.LastTimestamp() - reader.FirstTimestamp() + 1));
+        if (!cursor.Seek(target, decoded) || decoded.timestamp_ms > target || target - decoded.timestamp_ms >= 1000) ++errors;
+    }
+    double seek_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / seeks;
+
+    std::printf("round trip: %s\n", errors ? "FAILED" : "ok");
+    std::printf("%d processes x %d frames, %zu segments, %.1f MiB\n", processes, frames,
+                reader.Segments().size(), st.st_size / 1048576.0);
+    std::printf("%.0f bytes/frame (%.1f bytes/process; binary export %.0f), append %.2f ms/frame, decode %.2f ms/frame\n",
+                (double)st.st_size / frames, (double)st.st_size / frames / processes, export_bytes,
+                append_ms / frames, decode_ms / frames);
+    std::printf("seek: %.2f ms average\n", seek_ms);
+
+    // Crash recovery: drop the index as if the recorder had been killed,
+    // then continue the recording.
+    off_t without_index = st.st_size - (off_t)(reader.Segments().size() * 32 + 24);
+    if (truncate(path.c_str(), without_index) != 0) return 1;
+    RecordingReader recovered;
+    bool ok = recovered.Open(path, error) && recovered.Recovered() && recovered.Frames() == (unsigned long long)frames;
+    {
+        RecordingWriter writer;
+        ok = ok && writer.Open(path, std::chrono::milliseconds(1000), error);
+        Tick(snapshot, frames, rng);
+        ok = ok && writer.Append(snapshot);
+    }
+    RecordingReader continued;
+    ok = ok && continued.Open(path, error) && !continued.Recovered() && continued.Frames() == (unsigned long long)frames + 1;
+    std::printf("recovery and continue: %s\n", ok ? "ok" : "FAILED");
+
+    unlink(path.c_str());
+    return errors == 0 && ok ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+// Bytes written to the terminal per frame by DrawUI, with a full repaint
+// every frame (what clear() used to force) against the incremental path.
+// Output goes to a temporary file standing in for the tty.
+//
+//   bench_render [frames]
+#include "name_pool.h"
+#include "ui_manager.h"
+#include <cstdio>
+#include <cstdlib>
+#include <ncurses.h>
+#include <numeric>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// Synthetic frame: a few rows and meters change between consecutive frames,
+// as on a typical refresh.
+void MakeFrame(int frame, SystemStats& stats, std::vector<ProcessData>& processes) {
+    stats.cpu_percent = 20.0f + (frame * 7) % 30;
+    stats.mem_total = 16 * 1024 * 1024;
+    stats.mem_used = stats.mem_total / 2 + frame * 1024;
+    stats.mem_free = stats.mem_total - stats.mem_used;
+    stats.mem_percent = 100.0f * stats.mem_used / stats.mem_total;
+    stats.disks = {{"nvme0n1", (float)(frame % 5) * 100.0f, 12.0f}, {"sda", 0.0f, 0.0f}};
+    stats.network = {{"eth0", (float)(frame % 3) * 50.0f, 8.0f}, {"lo", 0.0f, 0.0f}};
+
+    processes.resize(200);
+    for (int i = 0; i < (int)processes.size(); ++i) {
+        ProcessData& p = processes[i];
+        p.pid = 1000 + i;
+        p.name = InternProcessName(i % 2 ? "worker" : "nginx");
+        p.state = i % 9 ? 'S' : 'R';
+        p.memory = 10000 + i * 37;
+        p.cpu_usage = (i + frame) % 10 == 0 ? (float)((frame * 13 + i) % 100) : 0.0f;
+        p.io_read_rate = i < 3 ? (float)(frame % 7) : 0.0f;
+        p.io_write_rate = 0.0f;
+    }
+}
+
+// Renders `frames` frames of `view` and returns the average bytes per frame.
+double BytesPerFrame(FILE* tty, ViewMode view, int frames, bool full_repaint) {
+    SystemStats stats = {};
+    std::vector<ProcessData> processes;
+    ProcessColumns columns;
+    std::vector<uint32_t> order;
+    off_t start = lseek(fileno(tty), 0, SEEK_END);
+    for (int frame = 0; frame < frames; ++frame) {
+        MakeFrame(frame, stats, processes);
+        columns.Assign(processes);
+        order.resize(processes.size());
+        std::iota(order.begin(), order.end(), 0u);
+        if (full_repaint) clearok(stdscr, TRUE);
+        DrawUI(view, stats, columns, order, SortKey::CPU, 0);
+    }
+    off_t end = lseek(fileno(tty), 0, SEEK_END);
+    return (double)(end - start) / frames;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? std::atoi(argv[1]) : 200;
+
+    setenv("TERM", "xterm-256color", 0);
+    setenv("COLUMNS", "160", 1);
+    setenv("LINES", "50", 1);
+    FILE* tty = std::tmpfile();
+    SCREEN* screen = newterm(nullptr, tty, stdin);
+    if (!screen) {
+        std::fprintf(stderr, "newterm failed (TERM=%s)\n", getenv("TERM"));
+        return 1;
+    }
+
+    // Prime the screen so both runs start from a drawn frame.
+    BytesPerFrame(tty, ViewMode::PROCESSES, 1, false);
+
+    double results[2][2];
+    ViewMode views[2] = {ViewMode::PROCESSES, ViewMode::PERFORMANCE};
+    for (int v = 0; v < 2; ++v) {
+        results[v][0] = BytesPerFrame(tty, views[v], frames, true);
+        results[v][1] = BytesPerFrame(tty, views[v], frames, false);
+    }
+    endwin();
+    delscreen(screen);
+
+    std::printf("%-12s %16s %16s %8s\n", "view", "full-repaint B/f", "incremental B/f", "ratio");
+    const char* names[2] = {"processes", "performance"};
+    for (int v = 0; v < 2; ++v) {
+        std::printf("%-12s %16.0f %16.0f %7.1fx\n", names[v], results[v][0], results[v][1],
+                    results[v][0] / results[v][1]);
+    }
+    return 0;
+}
@@ -0,0 +1,259 @@
+// Before/after benchmark for the /proc scan: the original ifstream and
+// stringstream parser against ProcScanner, over a synthetic PID tree.
+// "scanner-cold" opens every file (fresh scanner per scan); "scanner-warm"
+// re-reads cached fds with pread(); "tiered" reads status and io only for
+// active and due processes (see ProcScanner::SetIdleInterval()).
+//
+// Then checks the I/O rates of the tiered scan: every process of a small
+// fixture reads and writes at a steady rate while idle ones get their io
+// file read only once per idle interval; each must report that rate on
+// every sample from its first io re-read on.
+//
+//   bench_scan [processes] [iterations]
+#include "instrumentation.h"
+#include "name_pool.h"
+#include "proc_fixture.h"
+#include "proc_scanner.h"
+#include "rate_engine.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// --- The original GetAllProcesses(), kept verbatim as the baseline ---
+std::string GetValueFromStatus(const std::string& line) {
+    size_t colon_pos = line.find(":");
+    if (colon_pos != std::string::npos) {
+        size_t value_start = line.find_first_not_of(" \t", colon_pos + 1);
+        if (value_start != std::string::npos)
+            return line.substr(value_start);
+    }
+    return "";
+}
+
+std::vector<ProcessData> LegacyGetAllProcesses(const std::string& proc_path) {
+    std::vector<ProcessData> processes;
+    for (const auto& entry : fs::directory_iterator(proc_path)) {
+        if (entry.is_directory()) {
+            std::string dir_name = entry.path().filename().string();
+            if (std::all_of(dir_name.begin(), dir_name.end(), ::isdigit)) {
+                ProcessData p = {};
+                p.pid = std::stoi(dir_name);
+
+                std::ifstream status_file(entry.path().string() + "/status");
+                if (status_file.is_open()) {
+                    std::string line;
+                    while (std::getline(status_file, line)) {
+                        if (line.rfind("Name:", 0) == 0) p.name = InternProcessName(GetValueFromStatus(line));
+                        else if (line.rfind("State:", 0) == 0) p.state = GetValueFromStatus(line)[0];
+                        else if (line.rfind("VmRSS:", 0) == 0) p.memory = std::stol(GetValueFromStatus(line));
+                        else if (line.rfind("PPid:", 0) == 0) p.ppid = std::stoi(GetValueFromStatus(line));
+                    }
+                }
+
+                std::ifstream stat_file(entry.path().string() + "/stat");
+                if (stat_file.is_open()) {
+                    std::string line;
+                    std::getline(stat_file, line);
+                    std::stringstream ss(line);
+                    std::string token;
+                    for (int i = 0; i < 13; ++i) ss >> token;
+                    ss >> p.utime >> p.stime;
+                }
+
+                std::ifstream io_file(entry.path().string() + "/io");
+                if (io_file.is_open()) {
+                    std::string line;
+                    while (std::getline(io_file, line)) {
+                        std::stringstream ss(line);
+                        std::string key;
+                        ss >> key;
+                        if (key == "rchar:") ss >> p.read_bytes;
+                        else if (key == "wchar:") ss >> p.write_bytes;
+                    }
+                }
+                processes.push_back(p);
+            }
+        }
+    }
+    return processes;
+}
+
+bool SameRecord(const ProcessData& a, const ProcessData& b) {
+    return a.pid == b.pid && a.ppid == b.ppid && a.name == b.name && a.state == b.state &&
+           a.memory == b.memory && a.utime == b.utime && a.stime == b.stime &&
+           a.read_bytes == b.read_bytes && a.write_bytes == b.write_bytes;
+}
+
+template <typename F>
+double BestOfMs(int iterations, F&& f) {
+    double best = 1e300;
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+struct IoPerScan {
+    double syscalls = 0;
+    double bytes = 0;
+};
+
+// Averages the I/O of `scans` scans, a whole idle interval's worth.
+IoPerScan MeasureIo(ProcScanner& scanner, std::vector<ProcessData>& out, int scans) {
+    EndInstrumentedTick();
+    for (int i = 0; i < scans; ++i) scanner.Scan(out);
+    EndInstrumentedTick();
+    TickIo io = LastTickIo();
+    return {(double)io.syscalls / scans, (double)io.bytes / scans};
+}
+
+void WriteIo(const std::string& root, int pid, unsigned long long rchar, unsigned long long wchar) {
+    std::ofstream(root + "/" + std::to_string(pid) + "/io")
+        << "rchar: " << rchar << "\nwchar: " << wchar << "\nsyscr: 9\nsyscw: 0\nread_bytes: 0\nwrite_bytes: 0\n";
+}
+
+// Samples a fixture whose processes read `kReadKb` and write half that per
+// second of steady_clock time, `ticks` times, and counts the samples whose
+// rates are off by more than 5% once a process's io has been re-read. The
+// expected rate is the bytes written between two reads of the io file over
+// the time between the two rate updates, so a stall between writing the
+// fixture and sampling it does not count against the engine.
+int CheckIdleIoRates(int processes, int ticks) {
+    constexpr double kReadKb = 400.0;
+    std::string root = MakeTempDir("rates");
+    WriteProcFixture(root, processes);
+    ProcScanner scanner(root);
+    scanner.SetIdleInterval(kDefaultIdleInterval);
+    RateEngine rates;
+    std::vector<ProcessData> out;
+    std::vector<double> written, updated;        // Per tick, seconds since start
+    std::vector<int> last_read(processes + 1, -1); // Tick of each process's latest io read
+    std::vector<double> expected(processes + 1, -1.0);
+    int off = 0, samples = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto since_start = [&] { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+    auto read_bytes = [&](int tick) { return (unsigned long long)(kReadKb * 1024 * written[tick]); };
+    for (int tick = 0; tick < ticks; ++tick) {
+        written.push_back(since_start());
+        for (int pid = 1; pid <= processes; ++pid) WriteIo(root, pid, read_bytes(tick), read_bytes(tick) / 2);
+        scanner.Scan(out);
+        updated.push_back(since_start());
+        rates.Update(out, 0);
+        for (const ProcessData& p : out) {
+            if (!p.io_carried) {
+                int prev = last_read[p.pid];
+                if (prev >= 0) {
+                    double kb = (double)(read_bytes(tick) - read_bytes(prev)) / 1024.0;
+                    expected[p.pid] = kb / (updated[tick] - updated[prev]);
+                }
+                last_read[p.pid] = tick;
+            }
+            double read = expected[p.pid];
+            if (read < 0) continue;
+            ++samples;
+            if (std::abs(p.io_read_rate - read) > 0.05 * read || std::abs(p.io_write_rate - read / 2) > 0.05 * read) {
+                ++off;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    RemoveTree(root);
+    std::printf("io rates: %d of %d samples off by more than 5%%\n", off, samples);
+    return off;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int processes = argc > 1 ? std::atoi(argv[1]) : 50000;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    std::string root = MakeTempDir("scan");
+    if (root.empty()) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::printf("writing %d-process fixture to %s\n", processes, root.c_str());
+    WriteProcFixture(root, processes);
+
+    std::vector<ProcessData> legacy, scanned;
+    double legacy_ms = BestOfMs(iterations, [&] { legacy = LegacyGetAllProcesses(root); });
+    double cold_ms = BestOfMs(iterations, [&] {
+        ProcScanner fresh(root);
+        fresh.Scan(scanned);
+    });
+    double warm_ms;
+    IoPerScan warm_io;
+    size_t cached_fds, fd_budget;
+    {
+        // Scoped so its fds are closed before the tiered scanner claims the
+        // same budget.
+        ProcScanner scanner(root);
+        scanner.Scan(scanned);
+        warm_ms = BestOfMs(iterations, [&] { scanner.Scan(scanned); });
+        warm_io = MeasureIo(scanner, scanned, kDefaultIdleInterval);
+        cached_fds = scanner.CachedFds();
+        fd_budget = scanner.FdBudget();
+    }
+
+    // Tiered: past the first scan only the running, disk-sleep and due
+    // processes get their status and io read. The fixture never changes, so
+    // the carried fields must still match the legacy parser exactly.
+    ProcScanner tiered(root);
+    tiered.SetIdleInterval(kDefaultIdleInterval);
+    std::vector<ProcessData> tiered_out;
+    tiered.Scan(tiered_out);
+    double tiered_ms = BestOfMs(iterations, [&] { tiered.Scan(tiered_out); });
+    IoPerScan tiered_io = MeasureIo(tiered, tiered_out, kDefaultIdleInterval);
+
+    // The legacy stat parser misreads utime/stime when comm has spaces;
+    // every other record must match field for field.
+    auto by_pid = [](const ProcessData& a, const ProcessData& b) { return a.pid < b.pid; };
+    std::sort(legacy.begin(), legacy.end(), by_pid);
+    std::sort(scanned.begin(), scanned.end(), by_pid);
+    std::sort(tiered_out.begin(), tiered_out.end(), by_pid);
+    int mismatches = 0, comm_fixes = 0;
+    for (size_t i = 0; i < std::min(legacy.size(), scanned.size()); ++i) {
+        if (SameRecord(legacy[i], scanned[i])) continue;
+        if (IsPathologicalPid(scanned[i].pid)) ++comm_fixes;
+        else ++mismatches;
+    }
+    for (size_t i = 0; i < std::min(scanned.size(), tiered_out.size()); ++i) {
+        if (!SameRecord(scanned[i], tiered_out[i])) ++mismatches;
+    }
+
+    std::printf("%-12s %10s %12s\n", "parser", "ms/scan", "ns/process");
+    std::printf("%-12s %10.2f %12.0f\n", "legacy", legacy_ms, legacy_ms * 1e6 / processes);
+    std::printf("%-12s %10.2f %12.0f\n", "scanner-cold", cold_ms, cold_ms * 1e6 / processes);
+    std::printf("%-12s %10.2f %12.0f\n", "scanner-warm", warm_ms, warm_ms * 1e6 / processes);
+    std::printf("%-12s %10.2f %12.0f\n", "tiered", tiered_ms, tiered_ms * 1e6 / processes);
+    if (InstrumentationEnabled()) {
+        std::printf("per scan: warm %.0f syscalls %.0f KB, tiered %.0f syscalls %.0f KB (%.0f%% / %.0f%% of warm)\n",
+                    warm_io.syscalls, warm_io.bytes / 1024, tiered_io.syscalls, tiered_io.bytes / 1024,
+                    100 * tiered_io.syscalls / warm_io.syscalls, 100 * tiered_io.bytes / warm_io.bytes);
+    }
+    std::printf("cached fds %zu of budget %zu\n", cached_fds, fd_budget);
+    std::printf("speedup cold %.2fx, warm %.2fx, records %zu/%zu, comm fixes %d, mismatches %d\n",
+                legacy_ms / cold_ms, legacy_ms / warm_ms, scanned.size(), legacy.size(),
+                comm_fixes, mismatches);
+
+    RemoveTree(root);
+    int rate_errors = CheckIdleIoRates(64, 4 * kDefaultIdleInterval);
+    return (mismatches == 0 && rate_errors == 0 && legacy.size() == scanned.size() &&
+            tiered_out.size() == scanned.size()) ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+// Sort stage cost per tick: the old full std::sort (comparator picked by
+// comparing sort_key strings) against SortTopK over the visible window, of
+// the rows and of row indices into their ProcessColumns. Checks that both
+// top-k sorts put the same PIDs first.
+//
+//   bench_sort [processes] [iterations]
+#include "name_pool.h"
+#include "process_sort.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace {
+
+// --- The sort stage main() used before, kept as the baseline ---
+void LegacySort(std::vector<ProcessData>& current_processes, const std::string& sort_key) {
+    if (sort_key == "pid") { std::sort(current_processes.begin(), current_processes.end(), [](const auto& a, const auto& b){ return a.pid < b.pid; }); }
+    else if (sort_key == "memory") { std::sort(current_processes.begin(), current_processes.end(), [](const auto& a, const auto& b){ return a.memory > b.memory; }); }
+    else if (sort_key == "cpu") { std::sort(current_processes.begin(), current_processes.end(), [](const auto& a, const auto& b){ return a.cpu_usage > b.cpu_usage; }); }
+    else if (sort_key == "io") { std::sort(current_processes.begin(), current_processes.end(), [](const auto& a, const auto& b){ return (a.io_read_rate + a.io_write_rate) > (b.io_read_rate + b.io_write_rate); }); }
+}
+
+// Mostly idle processes, so the CPU and I/O keys have many ties.
+std::vector<ProcessData> MakeProcesses(int n) {
+    std::vector<ProcessData> processes(n);
+    unsigned long long x = 88172645463325252ULL;
+    for (int i = 0; i < n; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        ProcessData& p = processes[i];
+        p.pid = i + 1;
+        p.name = InternProcessName("proc");
+        p.state = 'S';
+        p.memory = (long)(x % 1000000);
+        p.cpu_usage = (x >> 20) % 20 == 0 ? (float)((x >> 30) % 10000) / 100.0f : 0.0f;
+        p.io_read_rate = (x >> 40) % 50 == 0 ? (float)((x >> 44) % 1000) : 0.0f;
+    }
+    return processes;
+}
+
+template <typename F>
+double MedianMs(const std::vector<ProcessData>& input, int iterations, F&& sort) {
+    std::vector<double> times;
+    std::vector<ProcessData> work;
+    for (int i = 0; i < iterations; ++i) {
+        work = input;
+        auto start = std::chrono::steady_clock::now();
+        sort(work);
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Median time to order a fresh index over `columns` with `sort`.
+template <typename F>
+double MedianMs(const ProcessColumns& columns, int iterations, F&& sort) {
+    std::vector<double> times;
+    std::vector<uint32_t> order(columns.Size());
+    for (int i = 0; i < iterations; ++i) {
+        std::iota(order.begin(), order.end(), 0u);
+        auto start = std::chrono::steady_clock::now();
+        sort(order);
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Whether the first `k` rows by `key` are the same PIDs either way.
+bool SameTopK(const std::vector<ProcessData>& input, const ProcessColumns& columns, SortKey key, size_t k) {
+    std::vector<ProcessData> rows = input;
+    SortTopK(rows, key, k);
+    std::vector<uint32_t> order(columns.Size());
+    std::iota(order.begin(), order.end(), 0u);
+    SortTopK(columns, key, k, order);
+    for (size_t i = 0; i < std::min(k, rows.size()); ++i) {
+        if (rows[i].pid != columns.pid[order[i]]) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int processes = argc > 1 ? std::atoi(argv[1]) : 50000;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 21;
+    const size_t visible = 45;
+
+    std::vector<ProcessData> input = MakeProcesses(processes);
+    ProcessColumns columns;
+    columns.Assign(input);
+    struct Key { SortKey key; const char* name; };
+    const Key keys[] = {{SortKey::PID, "pid"}, {SortKey::MEMORY, "memory"}, {SortKey::CPU, "cpu"}, {SortKey::IO, "io"}};
+
+    std::printf("%d processes, %zu visible rows, median of %d\n", processes, visible, iterations);
+    std::printf("%-8s %12s %12s %14s %14s %8s\n", "key", "full ms", "top-k ms", "top-k@5000 ms", "columns ms",
+                "speedup");
+    bool ok = true;
+    for (const Key& k : keys) {
+        double full = MedianMs(input, iterations, [&](auto& v) { LegacySort(v, k.name); });
+        double top = MedianMs(input, iterations, [&](auto& v) { SortTopK(v, k.key, 2 * visible); });
+        // Selection scrolled 5000 rows down: prefix of selection + two screens.
+        double deep = MedianMs(input, iterations, [&](auto& v) { SortTopK(v, k.key, 5000 + 2 * visible); });
+        double cols = MedianMs(columns, iterations, [&](auto& v) { SortTopK(columns, k.key, 2 * visible, v); });
+        std::printf("%-8s %12.3f %12.3f %14.3f %14.3f %7.1fx\n", k.name, full, top, deep, cols, full / top);
+        ok = ok && SameTopK(input, columns, k.key, 2 * visible) && SameTopK(input, columns, k.key, 5000);
+    }
+    std::printf("check: %s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
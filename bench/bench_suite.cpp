@@ -0,0 +1,269 @@
+// Per-stage cost of one tick against a synthetic procfs tree: every
+// collector, the rate and history updates, top-K sort, the process tree, the
+// process filter and rendering.
+// Prints one tab-separated row per stage so two runs can be diffed:
+//
+//   stage  items  ns_per_item  allocs_per_tick  peak_rss_kb
+//
+// items is what the stage works through per tick (processes, disks, rows);
+// allocs_per_tick counts operator new calls; peak_rss_kb is the process's
+// high-water mark while the stage ran (reset before each stage). A header
+// line reports a check of how disk and network counters that step back are
+// read (32-bit wrap or reset).
+//
+//   bench_suite [processes] [disks] [interfaces] [ticks] [cgroups]
+#include "cgroup_stats.h"
+#include "history.h"
+#include "proc_fixture.h"
+#include "process_columns.h"
+#include "process_filter.h"
+#include "process_parser.h"
+#include "process_sort.h"
+#include "process_tree.h"
+#include "rate_engine.h"
+#include "sampler.h"
+#include "system_collector.h"
+#include "system_stats.h"
+#include "ui_manager.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <ncurses.h>
+#include <new>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+// --- Allocation counting ---
+// The replacements pair malloc with free; GCC can't see that through the
+// operator new/delete boundary.
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+namespace {
+std::atomic<unsigned long long> g_allocations{0};
+} // namespace
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+// Resets VmHWM so each stage reports its own peak.
+void ResetPeakRss() {
+    if (FILE* f = std::fopen("/proc/self/clear_refs", "w")) {
+        std::fputs("5", f);
+        std::fclose(f);
+    }
+}
+
+long PeakRssKb() {
+    long kb = 0;
+    if (FILE* f = std::fopen("/proc/self/status", "r")) {
+        char line[256];
+        while (std::fgets(line, sizeof(line), f)) {
+            if (std::strncmp(line, "VmHWM:", 6) == 0) kb = std::atol(line + 6);
+        }
+        std::fclose(f);
+    }
+    return kb;
+}
+
+// Runs `setup` untimed and `tick` timed, `ticks` times, after one warm-up
+// round, and prints the stage's row.
+void Stage(const char* name, size_t items, int ticks, const std::function<void()>& setup,
+           const std::function<void()>& tick) {
+    setup();
+    tick();
+    ResetPeakRss();
+    double ns = 0;
+    unsigned long long allocations = 0;
+    for (int i = 0; i < ticks; ++i) {
+        setup();
+        unsigned long long before = g_allocations.load();
+        auto start = std::chrono::steady_clock::now();
+        tick();
+        ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        allocations += g_allocations.load() - before;
+    }
+    std::printf("%s\t%zu\t%.1f\t%.1f\t%ld\n", name, items, ns / ticks / (items ? items : 1),
+                (double)allocations / ticks, PeakRssKb());
+    std::fflush(stdout);
+}
+
+void WriteNetDev(const std::string& root, unsigned long long rx, unsigned long long tx) {
+    if (FILE* f = std::fopen((root + "/net/dev").c_str(), "w")) {
+        std::fprintf(f, "Inter-|   Receive\n face |bytes packets errs drop fifo frame compressed multicast|bytes\n"
+                        "  eth0: %llu 1 0 0 0 0 0 0 %llu 1 0 0 0 0 0 0\n", rx, tx);
+        std::fclose(f);
+    }
+}
+
+// A counter stepping from just below 2^32 to just above 0 must be read as
+// a 32-bit wrap (512 bytes here), and any other step back as a reset (no
+// rate). Returns the number of wrong rates.
+int CheckCounterSteps() {
+    struct Step { unsigned long long prev, cur; bool wraps; };
+    const Step steps[] = {
+        {0xffffff00ULL, 0x100ULL, true},       // 32-bit wrap
+        {1000000ULL, 10ULL, false},            // Reset well inside the 32-bit range
+        {0xd0000000ULL, 0x60000000ULL, false}, // From near the top, but not to near 0
+        {1ULL << 40, 10ULL, false},            // 64-bit reset
+    };
+    std::string root = MakeTempDir("counters");
+    std::filesystem::create_directories(root + "/net");
+    SetProcRoot(root);
+    int errors = 0;
+    for (const Step& step : steps) {
+        SystemCollector collector;
+        std::vector<NetworkStats> network;
+        WriteNetDev(root, step.prev, step.prev);
+        collector.CollectNetwork(network);
+        auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        WriteNetDev(root, step.cur, step.cur);
+        collector.CollectNetwork(network);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        float expected = step.wraps ? (float)(512 / 1024.0 / seconds) : 0.0f;
+        if (network.size() != 1 || std::fabs(network[0].rx_rate_kb - expected) > 0.25f * expected + 1e-6f ||
+            network[0].tx_rate_kb != network[0].rx_rate_kb) {
+            ++errors;
+        }
+    }
+    RemoveTree(root);
+    return errors;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ProcFixtureOptions options;
+    options.processes = argc > 1 ? std::atoi(argv[1]) : 50000;
+    options.disks = argc > 2 ? std::atoi(argv[2]) : 8;
+    options.interfaces = argc > 3 ? std::atoi(argv[3]) : 16;
+    int ticks = argc > 4 ? std::atoi(argv[4]) : 5;
+    int cgroups = argc > 5 ? std::atoi(argv[5]) : 500;
+    const int system_ticks = 1000; // The system-wide files are tiny
+
+    int counter_errors = CheckCounterSteps();
+
+    std::string root = MakeTempDir("suite");
+    WriteProcFixture(root, options);
+    SetProcRoot(root);
+    WriteCgroupFixture(root + "/cgroup", cgroups);
+    SetCgroupRoot(root + "/cgroup");
+
+    std::printf("# bench_suite processes=%d disks=%d interfaces=%d ticks=%d cgroups=%d\n", options.processes,
+                options.disks, options.interfaces, ticks, cgroups);
+    std::printf("# counter wrap/reset check: %s\n", counter_errors ? "FAILED" : "ok");
+    std::printf("stage\titems\tns_per_item\tallocs_per_tick\tpeak_rss_kb\n");
+
+    // --- Collectors ---
+    std::vector<ProcessData> processes;
+    auto none = [] {};
+    Stage("collect.processes", options.processes, ticks, none, [&] { GetAllProcesses(processes); });
+    SystemCollector system;
+    SystemStats system_stats{};
+    long long total = 0, idle = 0;
+    Stage("collect.cpu_times", 1, system_ticks, none, [&] { system.CollectCpu(system_stats, total, idle); });
+    Stage("collect.meminfo", 1, system_ticks, none, [&] { system.CollectMemory(system_stats); });
+    Stage("collect.pressure", 3, system_ticks, none, [&] { system.CollectPressure(system_stats); });
+    std::vector<DiskStats> disks;
+    system.CollectDisks(disks); // items: the devices the view shows
+    Stage("collect.diskstats", disks.size(), system_ticks, none, [&] { system.CollectDisks(disks); });
+    std::vector<NetworkStats> network;
+    system.CollectNetwork(network);
+    Stage("collect.netdev", network.size(), system_ticks, none, [&] { system.CollectNetwork(network); });
+    CgroupCollector cgroup_collector;
+    std::vector<CgroupStats> groups;
+    cgroup_collector.Collect(groups, 0); // items: every group, slices and root included
+    Stage("collect.cgroups", groups.size(), ticks * 10, none, [&] { cgroup_collector.Collect(groups, 0); });
+
+    // --- Derived values ---
+    RateEngine rates;
+    long long fake_total = 0;
+    Stage("rates.update", processes.size(), ticks, none, [&] {
+        fake_total += 100 * 8;
+        rates.Update(processes, fake_total);
+    });
+    HistoryStore history(std::chrono::milliseconds(1000), 64 << 20);
+    Snapshot snapshot;
+    snapshot.has_processes = true;
+    snapshot.processes = processes;
+    Stage("history.record", processes.size(), ticks, none, [&] {
+        snapshot.timestamp_ms += 1000;
+        history.Record(snapshot);
+    });
+
+    // --- Sort (a fresh unsorted copy each tick, copied untimed) ---
+    std::vector<ProcessData> shuffled = processes;
+    for (size_t i = 0; i < shuffled.size(); ++i) shuffled[i].cpu_usage = (float)((i * 7919) % 10007) / 100.0f;
+    std::vector<ProcessData> work;
+    Stage("sort.topk", shuffled.size(), ticks, [&] { work = shuffled; }, [&] { SortTopK(work, SortKey::CPU, 100); });
+    ProcessColumns columns;
+    Stage("columns.assign", shuffled.size(), ticks, none, [&] { columns.Assign(shuffled); });
+    std::vector<uint32_t> order;
+    auto all_rows = [&] {
+        order.resize(columns.Size());
+        std::iota(order.begin(), order.end(), 0u);
+    };
+    Stage("sort.topk.columns", columns.Size(), ticks, all_rows, [&] { SortTopK(columns, SortKey::CPU, 100, order); });
+    ProcessTree tree;
+    Stage("tree.build", shuffled.size(), ticks, none, [&] { tree.Build(shuffled, SortKey::CPU); });
+    ProcessFilter filter;
+    filter.Compile("cpu>5 && name~\"nginx\" && state==R || ppid==1");
+    std::vector<uint32_t> selected;
+    Stage("filter.select", columns.Size(), ticks, none, [&] { filter.Select(columns, selected); });
+
+    // --- Render (ncurses into a temporary file standing in for the tty) ---
+    setenv("TERM", "xterm-256color", 0);
+    setenv("COLUMNS", "160", 1);
+    setenv("LINES", "50", 1);
+    FILE* tty = std::tmpfile();
+    SCREEN* screen = tty ? newterm(nullptr, tty, stdin) : nullptr;
+    if (screen) {
+        SystemStats stats = system_stats; // Memory, cores and pressure
+        stats.disks = disks;
+        stats.network = network;
+        all_rows();
+        SortTopK(columns, SortKey::CPU, VisibleProcessRows(), order);
+        int frame = 0;
+        Stage("render.processes", VisibleProcessRows(), ticks * 20, none, [&] {
+            columns.cpu_usage[order[frame++ % 10]] += 1.0f;
+            DrawUI(ViewMode::PROCESSES, stats, columns, order, SortKey::CPU, 0);
+        });
+        Stage("render.performance", stats.disks.size() + stats.network.size(), ticks * 20, none, [&] {
+            stats.cpu_percent = (float)(frame++ % 100);
+            DrawUI(ViewMode::PERFORMANCE, stats, columns, order, SortKey::CPU, 0);
+        });
+        endwin();
+        delscreen(screen);
+    } else {
+        std::fprintf(stderr, "newterm failed (TERM=%s); render stages skipped\n", getenv("TERM"));
+    }
+
+    RemoveTree(root);
+    return counter_errors == 0 ? 0 : 1;
+}
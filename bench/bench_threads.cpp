@@ -0,0 +1,51 @@
+// Scaling of the parallel collector: warm ProcScanner scans over a synthetic
+// PID tree with 1, 2, 4, 8 and 16 workers.
+//
+//   bench_threads [processes] [iterations]
+#include "proc_fixture.h"
+#include "proc_scanner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+int main(int argc, char** argv) {
+    int processes = argc > 1 ? std::atoi(argv[1]) : 50000;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    std::string root = MakeTempDir("threads");
+    if (root.empty()) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::printf("writing %d-process fixture to %s (%u hardware threads)\n", processes,
+                root.c_str(), std::thread::hardware_concurrency());
+    WriteProcFixture(root, processes);
+
+    int failures = 0;
+    double base_ms = 0;
+    std::printf("%-8s %10s %12s %8s\n", "workers", "ms/scan", "ns/process", "speedup");
+    for (unsigned workers : {1u, 2u, 4u, 8u, 16u}) {
+        ProcScanner scanner(root);
+        scanner.SetWorkers(workers);
+        std::vector<ProcessData> out;
+        scanner.Scan(out); // Open and cache fds outside the timed scans
+
+        double best = 1e300;
+        for (int i = 0; i < iterations; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            scanner.Scan(out);
+            auto end = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        if (workers == 1) base_ms = best;
+        if ((int)out.size() != processes) ++failures;
+        std::printf("%-8u %10.2f %12.0f %7.2fx\n", workers, best, best * 1e6 / processes,
+                    base_ms / best);
+    }
+
+    RemoveTree(root);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+#include "proc_fixture.h"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* const kNames[] = {
+    "systemd", "kworker/0:1", "nginx", "postgres", "java", "bash", "sshd", "python3",
+};
+const char* const kOddNames[] = {
+    "tmux: server", "(sd-pam)", "x) S 1 2 (y", "a b c d e f g h",
+};
+const char* const kStates[] = {"S (sleeping)", "I (idle)", "R (running)", "D (disk sleep)"};
+
+// Like a real host, nearly everything sleeps: one process in 40 is running
+// and one in 40 is in disk sleep.
+const char* StateFor(unsigned long long r) {
+    unsigned k = (unsigned)(r % 40);
+    return kStates[k < 2 ? 2 + k : k & 1];
+}
+// Processes are spread over this many service groups (see WriteCgroupFixture).
+constexpr int kFixtureServices = 500;
+constexpr int kFixtureSlices = 10;
+
+// Deterministic per-PID values so two runs over the same fixture agree.
+unsigned long long Mix(unsigned long long x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+}
+
+void WriteFile(const fs::path& path, const char* data, int len) {
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return;
+    std::fwrite(data, 1, len, f);
+    std::fclose(f);
+}
+
+} // namespace
+
+bool IsPathologicalPid(int pid) {
+    return pid % 97 == 0;
+}
+
+void WriteProcFixture(const std::string& root, int processes) {
+    char buf[4096];
+    for (int pid = 1; pid <= processes; ++pid) {
+        fs::path dir = fs::path(root) / std::to_string(pid);
+        fs::create_directories(dir);
+
+        unsigned long long r = Mix(pid);
+        const char* name = IsPathologicalPid(pid) ? kOddNames[r % 4] : kNames[r % 8];
+        const char* state = StateFor(r >> 8);
+        int ppid = pid == 1 ? 0 : 1 + (int)((r >> 16) % pid);
+        long utime = (long)((r >> 4) % 100000);
+        long stime = (long)((r >> 12) % 50000);
+        long rss_kb = (long)((r >> 20) % 500000) & ~3L; // Whole 4 KB pages, as stat counts them
+        unsigned long long starttime = 100 + pid;
+        unsigned long long rchar = (r >> 24) % 100000000ULL;
+        unsigned long long wchar = (r >> 28) % 10000000ULL;
+
+        int n = std::snprintf(buf, sizeof(buf),
+            "%d (%s) %c %d %d %d 0 -1 4194560 1234 0 5 0 %ld %ld 0 0 20 0 1 0 %llu "
+            "2703360 %ld 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n",
+            pid, name, state[0], ppid, pid, pid, utime, stime, starttime, rss_kb / 4);
+        WriteFile(dir / "stat", buf, n);
+
+        n = std::snprintf(buf, sizeof(buf),
+            "Name:\t%s\nUmask:\t0022\nState:\t%s\nTgid:\t%d\nNgid:\t0\nPid:\t%d\nPPid:\t%d\n"
+            "TracerPid:\t0\nUid:\t0\t0\t0\t0\nGid:\t0\t0\t0\t0\nFDSize:\t64\nGroups:\t \n"
+            "NStgid:\t%d\nNSpid:\t%d\nNSpgid:\t%d\nNSsid:\t%d\nKthread:\t0\n"
+            "VmPeak:\t    %ld kB\nVmSize:\t    %ld kB\nVmLck:\t       0 kB\nVmPin:\t       0 kB\n"
+            "VmHWM:\t    %ld kB\nVmRSS:\t    %ld kB\nRssAnon:\t     100 kB\nRssFile:\t    1152 kB\n"
+            "RssShmem:\t       0 kB\nVmData:\t     360 kB\nVmStk:\t     132 kB\nVmExe:\t      20 kB\n"
+            "VmLib:\t    1528 kB\nVmPTE:\t      44 kB\nVmSwap:\t       0 kB\nHugetlbPages:\t       0 kB\n"
+            "CoreDumping:\t0\nTHP_enabled:\t1\nThreads:\t1\nSigQ:\t0/23960\n"
+            "SigPnd:\t0000000000000000\nShdPnd:\t0000000000000000\nSigBlk:\t0000000000000000\n"
+            "SigIgn:\t0000000000000000\nSigCgt:\t0000000000000000\nCapInh:\t0000000000000000\n"
+            "CapPrm:\t000001fffeffffff\nCapEff:\t000001fffeffffff\nCapBnd:\t000001fffeffffff\n"
+            "CapAmb:\t0000000000000000\nNoNewPrivs:\t0\nSeccomp:\t0\nSeccomp_filters:\t0\n"
+            "Speculation_Store_Bypass:\tthread vulnerable\nCpus_allowed:\tff\nCpus_allowed_list:\t0-7\n"
+            "Mems_allowed:\t00000001\nMems_allowed_list:\t0\n"
+            "voluntary_ctxt_switches:\t%llu\nnonvoluntary_ctxt_switches:\t0\n",
+            name, state, pid, pid, ppid, pid, pid, pid, pid,
+            rss_kb * 3, rss_kb * 3, rss_kb, rss_kb, r % 1000);
+        WriteFile(dir / "status", buf, n);
+
+        n = std::snprintf(buf, sizeof(buf),
+            "rchar: %llu\nwchar: %llu\nsyscr: 9\nsyscw: 0\nread_bytes: 0\nwrite_bytes: 0\n"
+            "cancelled_write_bytes: 0\n",
+            rchar, wchar);
+        WriteFile(dir / "io", buf, n);
+
+        int service = pid % kFixtureServices;
+        n = std::snprintf(buf, sizeof(buf), "0::/slice-%d.slice/svc-%d.service\n", service % kFixtureSlices, service);
+        WriteFile(dir / "cgroup", buf, n);
+    }
+}
+
+void WriteCgroupFixture(const std::string& root, int groups) {
+    char buf[1024];
+    auto write_group = [&](const fs::path& dir, unsigned long long r) {
+        fs::create_directories(dir);
+        int n = std::snprintf(buf, sizeof(buf),
+            "usage_usec %llu\nuser_usec %llu\nsystem_usec %llu\nnr_periods 0\nnr_throttled 0\n"
+            "throttled_usec 0\nnr_bursts 0\nburst_usec 0\n",
+            r % 100000000000ULL, r % 60000000000ULL, r % 40000000000ULL);
+        WriteFile(dir / "cpu.stat", buf, n);
+        n = std::snprintf(buf, sizeof(buf), "%llu\n", (r >> 8) % 4000000000ULL);
+        WriteFile(dir / "memory.current", buf, n);
+        n = std::snprintf(buf, sizeof(buf),
+            "8:0 rbytes=%llu wbytes=%llu rios=%llu wios=%llu dbytes=0 dios=0\n"
+            "259:0 rbytes=%llu wbytes=%llu rios=%llu wios=%llu dbytes=0 dios=0\n",
+            r % 1000000000000ULL, (r >> 4) % 1000000000000ULL, r % 1000000, (r >> 4) % 1000000,
+            (r >> 8) % 1000000000000ULL, (r >> 12) % 1000000000000ULL, (r >> 8) % 1000000, (r >> 12) % 1000000);
+        WriteFile(dir / "io.stat", buf, n);
+        n = std::snprintf(buf, sizeof(buf),
+            "some avg10=%.2f avg60=0.50 avg300=0.20 total=%llu\nfull avg10=0.00 avg60=0.00 avg300=0.00 total=0\n",
+            (double)(r % 1000) / 100.0, r % 100000000);
+        WriteFile(dir / "cpu.pressure", buf, n);
+        for (const char* file : {"cgroup.procs", "cgroup.controllers", "cgroup.events", "cgroup.type",
+                                 "memory.max", "memory.stat", "io.pressure", "memory.pressure"}) {
+            WriteFile(dir / file, "", 0);
+        }
+    };
+
+    write_group(root, Mix(900));
+    for (int s = 0; s < kFixtureSlices; ++s) {
+        write_group(fs::path(root) / ("slice-" + std::to_string(s) + ".slice"), Mix(1000 + s));
+    }
+    for (int g = 0; g < groups; ++g) {
+        fs::path slice = fs::path(root) / ("slice-" + std::to_string(g % kFixtureSlices) + ".slice");
+        write_group(slice / ("svc-" + std::to_string(g) + ".service"), Mix(2000 + g));
+    }
+}
+
+void WriteProcFixture(const std::string& root, const ProcFixtureOptions& options) {
+    WriteProcFixture(root, options.processes);
+    std::string text;
+    char buf[512];
+
+    // stat: an aggregate cpu line, one per CPU, then the usual counters.
+    auto cpu_line = [&](const char* label, unsigned long long r, int scale) {
+        int n = std::snprintf(buf, sizeof(buf), "%s %llu %llu %llu %llu %llu %llu %llu %llu 0 0\n", label,
+                              scale * (r % 900000), scale * (r % 3000), scale * (r % 400000), scale * (r % 9000000),
+                              scale * (r % 20000), 0ULL, scale * (r % 8000), 0ULL);
+        text.append(buf, n);
+    };
+    cpu_line("cpu ", Mix(0), options.cpus);
+    for (int cpu = 0; cpu < options.cpus; ++cpu) cpu_line(("cpu" + std::to_string(cpu)).c_str(), Mix(cpu + 1), 1);
+    int n = std::snprintf(buf, sizeof(buf), "intr 123456789 0 9 0 0\nctxt 987654321\nbtime 1700000000\n"
+                          "processes %d\nprocs_running 3\nprocs_blocked 0\nsoftirq 1234 0 1 2 3 4 5 6 7 8 9\n",
+                          options.processes * 4);
+    text.append(buf, n);
+    WriteFile(fs::path(root) / "stat", text.data(), (int)text.size());
+
+    n = std::snprintf(buf, sizeof(buf),
+        "MemTotal:       32594392 kB\nMemFree:         1864032 kB\nMemAvailable:   20485112 kB\n"
+        "Buffers:          884220 kB\nCached:         16815476 kB\nSwapCached:         2236 kB\n"
+        "Active:          9873720 kB\nInactive:       18316364 kB\nSwapTotal:       8388604 kB\n"
+        "SwapFree:        8329468 kB\nDirty:              1180 kB\nShmem:            905476 kB\n"
+        "Slab:            1987456 kB\nCommitLimit:    24685800 kB\nCommitted_AS:   22849620 kB\n");
+    WriteFile(fs::path(root) / "meminfo", buf, n);
+    n = std::snprintf(buf, sizeof(buf), "123456.78 456789.12\n");
+    WriteFile(fs::path(root) / "uptime", buf, n);
+    fs::create_directories(fs::path(root) / "pressure");
+    for (const char* resource : {"cpu", "memory", "io"}) {
+        n = std::snprintf(buf, sizeof(buf),
+            "some avg10=1.25 avg60=0.80 avg300=0.42 total=123456789\n"
+            "full avg10=0.00 avg60=0.00 avg300=0.00 total=1234567\n");
+        WriteFile(fs::path(root) / "pressure" / resource, buf, n);
+    }
+
+    // diskstats: every whole disk with two partitions, plus loop devices
+    // and device-mapper volumes; the disk view shows only disks and dm-*.
+    text.clear();
+    auto disk_line = [&](int major, int minor, const std::string& name, unsigned long long r) {
+        int len = std::snprintf(buf, sizeof(buf),
+            "%4d %7d %s %llu %llu %llu %llu %llu %llu %llu %llu 0 %llu %llu 0 0 0 0 0 0\n",
+            major, minor, name.c_str(), r % 900000, r % 1000, r % 90000000, r % 500000,
+            (r >> 8) % 800000, r % 2000, (r >> 8) % 80000000, r % 700000, r % 600000, r % 1200000);
+        text.append(buf, len);
+    };
+    for (int i = 0; i < 4; ++i) disk_line(7, i, "loop" + std::to_string(i), Mix(100 + i));
+    for (int d = 0; d < options.disks; ++d) {
+        std::string name = d % 2 ? std::string("sd") + (char)('a' + d / 2 % 26) : "nvme" + std::to_string(d / 2) + "n1";
+        std::string part = d % 2 ? "" : "p";
+        disk_line(d % 2 ? 8 : 259, d * 16, name, Mix(200 + d));
+        for (int p = 1; p <= 2; ++p) disk_line(d % 2 ? 8 : 259, d * 16 + p, name + part + std::to_string(p), Mix(300 + d * 4 + p));
+    }
+    for (int i = 0; i < 2; ++i) disk_line(253, i, "dm-" + std::to_string(i), Mix(400 + i));
+    WriteFile(fs::path(root) / "diskstats", text.data(), (int)text.size());
+
+    // net/dev: lo, then physical-looking and container veth interfaces.
+    fs::create_directories(fs::path(root) / "net");
+    text = "Inter-|   Receive                                                |  Transmit\n"
+           " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n";
+    auto net_line = [&](const std::string& name, unsigned long long r) {
+        int len = std::snprintf(buf, sizeof(buf),
+            "%6s: %llu %llu 0 0 0 0 0 0 %llu %llu 0 0 0 0 0 0\n",
+            name.c_str(), r % 100000000000ULL, r % 90000000, (r >> 4) % 10000000000ULL, (r >> 4) % 9000000);
+        text.append(buf, len);
+    };
+    net_line("lo", Mix(500));
+    for (int i = 0; i < options.interfaces; ++i) {
+        char name[32];
+        if (i < 2) std::snprintf(name, sizeof(name), "eth%d", i);
+        else std::snprintf(name, sizeof(name), "veth%08llx", Mix(600 + i) & 0xffffffffULL);
+        net_line(name, Mix(700 + i));
+    }
+    WriteFile(fs::path(root) / "net" / "dev", text.data(), (int)text.size());
+}
+
+std::string MakeTempDir(const char* tag) {
+    std::string templ = (fs::temp_directory_path() / (std::string("pm-") + tag + "-XXXXXX")).string();
+    if (!mkdtemp(templ.data())) return "";
+    return templ;
+}
+
+void RemoveTree(const std::string& root) {
+    std::error_code ec;
+    fs::remove_all(root, ec);
+}
@@ -0,0 +1,36 @@
+#ifndef PROC_FIXTURE_H
+#define PROC_FIXTURE_H
+
+#include <string>
+
+// Builds a synthetic procfs tree under `root` with `processes` PID
+// directories, each holding realistic stat, status, io and cgroup files.
+// The cgroup files name the groups WriteCgroupFixture() creates.
+// Every 97th process gets a pathological comm (spaces and parentheses).
+void WriteProcFixture(const std::string& root, int processes);
+
+struct ProcFixtureOptions {
+    int processes = 1000;
+    int disks = 4;       // Whole disks; each also gets partitions
+    int interfaces = 2;  // Besides lo
+    int cpus = 8;
+};
+
+// Like the above, plus the system-wide files: stat, meminfo, uptime,
+// diskstats (disks, partitions, loop and dm devices), net/dev and
+// pressure/{cpu,memory,io}.
+void WriteProcFixture(const std::string& root, const ProcFixtureOptions& options);
+
+// Builds a cgroup v2 hierarchy under `root`: `groups` service groups
+// spread over ten slices, each with cpu.stat, memory.current, io.stat,
+// cpu.pressure and the other files a real group lists.
+void WriteCgroupFixture(const std::string& root, int groups);
+
+// True if WriteProcFixture gave this PID a pathological comm.
+bool IsPathologicalPid(int pid);
+
+// Creates a fresh temporary directory and returns its path.
+std::string MakeTempDir(const char* tag);
+void RemoveTree(const std::string& root);
+
+#endif // PROC_FIXTURE_H
@@ -0,0 +1,64 @@
+#ifndef CGROUP_STATS_H
+#define CGROUP_STATS_H
+
+#include "rate_engine.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Usage of one cgroup v2 group, from its own counters: the kernel charges
+// every task that ever ran in it, including children too short-lived for
+// any /proc scan to see.
+struct CgroupStats {
+    std::string path;         // Relative to the cgroup root; "/" is the root
+    int depth;                // 0 for the root
+    float cpu_percent;        // cpu.stat usage_usec, as a share of all CPUs
+    long memory_kb;           // memory.current; 0 where the controller is off
+    float io_read_rate_kb;    // io.stat rbytes/wbytes summed over devices
+    float io_write_rate_kb;
+    float cpu_pressure;       // cpu.pressure "some avg10", in percent
+};
+
+// Walks the cgroup v2 hierarchy every sample, parents before children and
+// siblings by name, reading cpu.stat, memory.current, io.stat and
+// cpu.pressure of each group through openat() relative to its directory.
+// Rates come from a RateEngine keyed by the directory's inode, so a group
+// that is removed and recreated under the same name starts from zero.
+class CgroupCollector {
+public:
+    // `system_total_time` is the GetSystemCpuTimes() total of this sample.
+    void Collect(std::vector<CgroupStats>& cgroups, long long system_total_time);
+
+private:
+    struct Sample {
+        unsigned long long inode;
+        RateEngine::Counters counters;
+    };
+    struct Child {
+        std::string name;
+        unsigned long long inode;
+    };
+
+    // Appends the group at `dir_fd` and its descendants at cgroups[count...].
+    void Walk(int dir_fd, unsigned long long inode, int depth, std::vector<CgroupStats>& cgroups, size_t& count);
+    void ReadGroup(int dir_fd, unsigned long long inode, CgroupStats& group);
+
+    RateEngine rates_;
+    std::vector<Sample> samples_;       // Parallel to the output of Collect()
+    std::string path_;                  // Of the group being walked
+    // Per depth, the subdirectories of the group being walked there. Kept
+    // with their strings between samples; only the first entries are live.
+    std::vector<std::vector<Child>> children_;
+};
+
+// Root of the cgroup v2 hierarchy. The default is /sys/fs/cgroup, or its
+// "unified" subdirectory on hybrid v1/v2 hosts.
+void SetCgroupRoot(const std::string& root);
+const std::string& CgroupRoot();
+
+// Cgroup paths of processes are interned: ProcessData::cgroup holds the id,
+// 0 when unknown. Interning is thread-safe; ids are never reused.
+unsigned InternCgroupPath(const char* path, size_t len);
+std::string CgroupPath(unsigned id);
+
+#endif // CGROUP_STATS_H
@@ -0,0 +1,97 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include "sampler.h"
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+enum class ExportFormat { CSV, JSONL, BINARY };
+
+// Parses "csv", "jsonl" or "binary".
+bool ParseExportFormat(const std::string& text, ExportFormat& format);
+
+// Fixed-size output buffer in front of a file descriptor. Numbers are
+// formatted straight into it with std::to_chars; it is flushed with one
+// write() when full and at the end of each sample, and never reallocates.
+class OutputBuffer {
+public:
+    explicit OutputBuffer(int fd);
+
+    void Append(std::string_view text);
+    void Append(char c);
+    void AppendInt(long long value);
+    void AppendFloat(float value);  // Fixed, two decimals
+    void AppendRaw(const void* data, size_t size);
+
+    // Returns false once a write has failed (e.g. EPIPE); output stops then.
+    bool Flush();
+    bool Failed() const { return failed_; }
+    int Error() const { return error_; }
+
+private:
+    static constexpr size_t kCapacity = 256 * 1024;
+    char* Reserve(size_t size);
+    void WriteAll(const char* data, size_t size);
+
+    int fd_;
+    size_t len_ = 0;
+    bool failed_ = false;
+    int error_ = 0;
+    std::unique_ptr<char[]> data_;
+};
+
+// Serializes snapshots as CSV, JSON Lines or the binary framing below.
+//
+// CSV and JSON Lines emit one "system" record per sample, then one record
+// per disk, network interface, GPU and process, each tagged with its type.
+//
+// Binary: the stream starts with the 8 bytes "PMONBIN1". Each sample is one
+// frame; all integers and floats are in host byte order (little-endian on
+// every supported target), strings are a u8 length followed by the bytes:
+//   u32 frame_bytes (excluding this field)
+//   i64 timestamp_ms, f32 cpu_percent, f32 mem_percent,
+//   i64 mem_total_kb, i64 mem_used_kb,
+//   u32 processes, u16 disks, u16 interfaces, u16 gpus, u16 reserved
+//   per process: i32 pid, i32 ppid, i64 mem_kb, f32 cpu_percent,
+//                f32 read_kbs, f32 write_kbs, u8 state, str name
+//   per disk / interface: str name, f32 read_or_rx_kbs, f32 write_or_tx_kbs
+//   per gpu: i32 id, i32 utilization, i32 mem_used_mb, i32 mem_total_mb, str name
+class SnapshotWriter {
+public:
+    SnapshotWriter(ExportFormat format, int fd);
+
+    // Returns false once the output is gone; Error() has the errno.
+    bool Write(const Snapshot& snapshot);
+    int Error() const { return out_.Error(); }
+
+private:
+    void WriteHeader();
+    void WriteCsv(const Snapshot& snapshot);
+    void WriteJsonl(const Snapshot& snapshot);
+    void WriteBinary(const Snapshot& snapshot);
+
+    ExportFormat format_;
+    bool header_written_ = false;
+    OutputBuffer out_;
+};
+
+struct HeadlessOptions {
+    ExportFormat format = ExportFormat::JSONL;
+    std::chrono::milliseconds interval{1000};
+    std::string output;       // Empty: stdout
+    long long count = 0;      // Samples to write; 0 = until interrupted
+    std::string record;       // Also append every sample to this recording
+    bool timings = false;     // One JSON line of phase timings per sample on stderr
+    std::string filter;       // Only processes matching this ProcessFilter expression are written
+    std::string metrics;      // Also serve every sample here (see MetricsServer); unfiltered
+    size_t metrics_top = 20;  // Processes in the metrics
+};
+
+// Runs the collectors at a fixed cadence and streams every sample to the
+// output, without ever touching ncurses. Returns the process exit code.
+int RunHeadless(const HeadlessOptions& options);
+
+#endif // EXPORTER_H
@@ -0,0 +1,77 @@
+#ifndef GPU_COLLECTOR_H
+#define GPU_COLLECTOR_H
+
+#include "system_stats.h"
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+// Keeps one long-lived `nvidia-smi --query-gpu=... -lms N` child and parses
+// its output as it streams in, on a thread of its own. Readers only copy the
+// cached values, so a slow or hung nvidia-smi never blocks a sample.
+//
+// When the tool is missing or exits, it is restarted after a delay that
+// doubles up to kMaxBackoff; a child that ran for a while resets the delay.
+// nvidia-smi is looked up on PATH, so a stub script can stand in for it.
+class GpuCollector {
+public:
+    GpuCollector() = default;
+    ~GpuCollector();
+
+    GpuCollector(const GpuCollector&) = delete;
+    GpuCollector& operator=(const GpuCollector&) = delete;
+
+    void Start(std::chrono::milliseconds interval);
+    void Stop();
+
+    // Copies the last reported values. Each GPU's age_ms is the time since
+    // nvidia-smi last reported it; it is marked stale after a few missed
+    // intervals (e.g. while the child is being restarted).
+    void Copy(std::vector<GpuStats>& gpus) const;
+
+    // Times the child has been started (for tests and benchmarks).
+    unsigned Spawns() const;
+
+    static constexpr std::chrono::milliseconds kInitialBackoff{1000};
+    static constexpr std::chrono::milliseconds kMaxBackoff{300000};
+
+private:
+    struct Entry {
+        GpuStats stats;
+        std::chrono::steady_clock::time_point updated;
+    };
+
+    void Run();
+    bool Spawn();
+    void Reap();
+    void ReadOutput();
+    // Sleeps until `deadline` or Stop(); returns false on Stop().
+    bool WaitUntil(std::chrono::steady_clock::time_point deadline);
+
+    std::chrono::milliseconds interval_{1000};
+    std::thread thread_;
+    int stop_pipe_[2] = {-1, -1};
+
+    // --- Collector thread only ---
+    pid_t child_ = -1;
+    int out_fd_ = -1;
+    std::string pending_;                       // Partial line from the last read
+    std::chrono::milliseconds backoff_ = kInitialBackoff;
+    std::chrono::steady_clock::time_point started_;
+
+    mutable std::mutex mutex_;                  // Guards the cache and counter below
+    std::map<int, Entry> gpus_;                 // By GPU index
+    unsigned spawns_ = 0;
+};
+
+// Parses one line of `nvidia-smi --query-gpu=index,name,utilization.gpu,
+// memory.used,memory.total --format=csv,noheader,nounits`. Fields nvidia-smi
+// reports as "[N/A]" or "[Not Supported]" read as 0.
+bool ParseNvidiaSmiLine(const char* line, size_t len, GpuStats& gpu);
+
+#endif // GPU_COLLECTOR_H
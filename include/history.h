@@ -0,0 +1,145 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Snapshot;
+
+// Hard cap on the bytes all history series may hold together.
+class MemoryBudget {
+public:
+    explicit MemoryBudget(size_t cap) : cap_(cap) {}
+
+    bool TryCharge(size_t bytes) {
+        if (used_ + bytes > cap_) return false;
+        used_ += bytes;
+        return true;
+    }
+    void Release(size_t bytes) { used_ -= bytes; }
+
+    size_t Used() const { return used_; }
+    size_t Cap() const { return cap_; }
+
+private:
+    size_t cap_;
+    size_t used_ = 0;
+};
+
+// Ring of integer samples compressed as zigzag varint deltas. The oldest
+// sample is kept verbatim and each later one as its difference to the
+// previous, so a steady series costs one byte per sample. Running sums over
+// all samples and over a trailing window are kept up to date on every
+// append, making both means O(1).
+class CompressedSeries {
+public:
+    CompressedSeries() = default;
+    CompressedSeries(CompressedSeries&&) = default;
+    CompressedSeries& operator=(CompressedSeries&&) = default;
+
+    // Appends `value`, then drops the oldest samples beyond the newest
+    // `max_samples` and narrows the trailing window to the newest `window`.
+    // Growing the byte ring is charged to `budget`; when it refuses, the
+    // oldest samples are dropped instead.
+    void Append(int64_t value, size_t max_samples, size_t window, MemoryBudget& budget);
+
+    // Returns the ring's bytes to `budget` and empties the series.
+    void Release(MemoryBudget& budget);
+
+    size_t Size() const { return count_; }
+    size_t Bytes() const { return cap_; }
+    double Mean() const { return count_ ? (double)sum_ / count_ : 0.0; }
+    double WindowMean() const { return win_count_ ? (double)win_sum_ / win_count_ : 0.0; }
+
+    // Decodes the newest `n` samples, oldest first, multiplied by `scale`.
+    void Recent(size_t n, float scale, std::vector<float>& out) const;
+
+private:
+    uint8_t At(uint32_t offset) const { return ring_[(head_ + offset) % cap_]; }
+    // Decodes the varint at `offset` (relative to head_), returning its length.
+    uint32_t Decode(uint32_t offset, int64_t& delta) const;
+    bool Grow(MemoryBudget& budget);
+    void DropOldest();
+
+    std::unique_ptr<uint8_t[]> ring_;
+    uint32_t cap_ = 0;        // Ring size in bytes
+    uint32_t head_ = 0;       // Ring offset of the delta of the second-oldest sample
+    uint32_t len_ = 0;        // Bytes of deltas stored
+    uint32_t count_ = 0;      // Samples stored, including the verbatim oldest
+    int64_t base_ = 0;        // Oldest sample
+    int64_t last_ = 0;        // Newest sample
+    int64_t sum_ = 0;
+
+    // Trailing window: its oldest sample's value, and the offset (relative
+    // to head_) of the delta that produces the sample after it.
+    uint32_t win_count_ = 0;
+    uint32_t win_cursor_ = 0;
+    int64_t win_value_ = 0;
+    int64_t win_sum_ = 0;
+};
+
+// Bounded in-memory history of the system, device and per-process series,
+// all drawing from one MemoryBudget. A process keeps only its CPU series,
+// the one its 1m/5m averages are read from; it is keyed by (pid, starttime)
+// and dropped as soon as the process is no longer sampled.
+// The full ring covers the last five minutes and the short window the last
+// minute, by the snapshots' timestamps: extra samples taken off schedule
+// and gaps between samples do not stretch or shrink either span.
+class HistoryStore {
+public:
+    HistoryStore(std::chrono::milliseconds interval, size_t memory_cap_bytes);
+
+    // Appends the snapshot's values and fills in what the views read back:
+    // per-process CPU averages and the system/device sparkline data.
+    void Record(Snapshot& snapshot);
+
+    size_t BytesUsed() const { return budget_.Used(); }
+    size_t TrackedProcesses() const { return processes_.size(); }
+    // The CPU series of a process, or null when it is not tracked.
+    const CompressedSeries* ProcessCpu(int pid, unsigned long long starttime) const;
+
+private:
+    struct ProcessHistory {
+        CompressedSeries cpu;   // Hundredths of a percent
+        unsigned long long seen = 0;
+    };
+    struct DeviceHistory {
+        CompressedSeries rate;  // Total KB/s
+        unsigned long long seen = 0;
+    };
+    // Times of the recent samples of one kind of series -- system, device or
+    // process -- all of which are appended to on every sample of that kind.
+    // Turns the two spans into sample counts for their Append().
+    struct SampleTimes {
+        std::deque<int64_t> times; // Newest last, none older than five minutes
+        size_t window_start = 0;   // Index of the first within the last minute
+
+        void Add(int64_t time_ms, size_t max_samples);
+        size_t Samples() const { return times.size(); }
+        size_t Window() const { return times.size() - window_start; }
+    };
+
+    static uint64_t ProcessKey(int pid, unsigned long long starttime);
+    void RecordDevice(const std::string& key, float rate, std::vector<float>& sparkline);
+    template <typename Map> void Reap(Map& map, size_t entry_bytes);
+
+    size_t max_samples_;        // Bound on Samples(), should timestamps stand still
+    MemoryBudget budget_;
+    unsigned long long generation_ = 0;
+    CompressedSeries cpu_;      // Hundredths of a percent
+    CompressedSeries mem_;      // Hundredths of a percent
+    SampleTimes system_times_, device_times_, process_times_;
+    std::unordered_map<uint64_t, ProcessHistory> processes_;
+    std::unordered_map<std::string, DeviceHistory> devices_;
+};
+
+// Points drawn by a sparkline.
+constexpr size_t kSparklinePoints = 60;
+
+#endif // HISTORY_H
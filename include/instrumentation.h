@@ -0,0 +1,106 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// --- Self-instrumentation ---
+// Each phase of a tick is timed with the steady clock into a log-bucketed
+// histogram (four buckets per power of two, so percentiles are within
+// about 19%). Recording is a few relaxed atomic adds and safe from any
+// thread. The process scanner also counts its syscalls and bytes read.
+//
+// Building with -DPMON_NO_INSTRUMENTATION (make INSTRUMENT=0) turns the
+// macros below into nothing; the query functions then report no samples.
+
+enum class Phase {
+    TICK,        // A whole sample on the collector side
+    PROC_WALK,   // Listing PIDs (directory walk or proc events)
+    PROC_READ,   // Reading and parsing the per-PID files
+    RATES,
+    HISTORY,
+    COLUMNS,     // Filling the sample's ProcessColumns
+    SYSTEM,      // /proc/stat, /proc/meminfo and /proc/pressure
+    DISKS,
+    NETWORK,
+    GPU,
+    CGROUPS,
+    THREADS,     // The drill-down into one process's task/ directory
+    RECORD,
+    METRICS,     // Rendering the metrics response
+    FILTER,      // UI thread (or headless): the process filter
+    SORT,        // UI thread
+    TREE,        // UI thread: linking, rollups and sibling order
+    DRAW,        // UI thread, including the terminal write
+    COUNT
+};
+
+const char* PhaseName(Phase phase);
+
+struct PhaseSummary {
+    uint64_t count = 0;
+    uint64_t last_ns = 0;
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+struct TickIo {
+    uint64_t syscalls = 0;
+    uint64_t bytes = 0;
+};
+
+// False when built with PMON_NO_INSTRUMENTATION.
+bool InstrumentationEnabled();
+
+void RecordPhase(Phase phase, uint64_t ns);
+// Hot loops tally I/O in a thread-local and flush it once per batch.
+extern thread_local TickIo tl_tick_io;
+void FlushThreadIo();
+// Closes a collector tick: the I/O counted since the previous call becomes
+// LastTickIo().
+void EndInstrumentedTick();
+
+PhaseSummary SummarizePhase(Phase phase);
+TickIo LastTickIo();
+
+// Times the enclosing scope into `phase`, unless `enabled` is false.
+class ScopedPhase {
+public:
+    explicit ScopedPhase(Phase phase, bool enabled = true) : phase_(phase), enabled_(enabled) {
+        if (enabled_) start_ = std::chrono::steady_clock::now();
+    }
+    ~ScopedPhase() {
+        if (!enabled_) return;
+        RecordPhase(phase_, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count());
+    }
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+private:
+    Phase phase_;
+    bool enabled_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#define PMON_CONCAT_INNER(a, b) a##b
+#define PMON_CONCAT(a, b) PMON_CONCAT_INNER(a, b)
+
+#ifdef PMON_NO_INSTRUMENTATION
+#define PMON_TIME_PHASE(phase) do {} while (0)
+#define PMON_TIME_PHASE_IF(enabled, phase) do {} while (0)
+#define PMON_TALLY_IO(calls, nbytes) do {} while (0)
+#define PMON_FLUSH_IO() do {} while (0)
+#define PMON_END_TICK() do {} while (0)
+#else
+#define PMON_TIME_PHASE(phase) ScopedPhase PMON_CONCAT(pmon_phase_, __LINE__)(phase)
+#define PMON_TIME_PHASE_IF(enabled, phase) ScopedPhase PMON_CONCAT(pmon_phase_, __LINE__)(phase, enabled)
+#define PMON_TALLY_IO(calls, nbytes) (tl_tick_io.syscalls += (calls), tl_tick_io.bytes += (nbytes))
+#define PMON_FLUSH_IO() FlushThreadIo()
+#define PMON_END_TICK() EndInstrumentedTick()
+#endif
+
+#endif // INSTRUMENTATION_H
@@ -0,0 +1,14 @@
+#ifndef LINUX_DIRENT_H
+#define LINUX_DIRENT_H
+
+// Layout returned by the getdents64 syscall, which the /proc and cgroup
+// walkers call directly to list a directory into a reused buffer.
+struct LinuxDirent64 {
+    unsigned long long d_ino;
+    long long d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+#endif // LINUX_DIRENT_H
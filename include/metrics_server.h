@@ -0,0 +1,116 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include "sampler.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Serves the latest sample over HTTP in the Prometheus text exposition
+// format (version 0.0.4), on a Unix domain socket or a loopback TCP port:
+//
+//   GET /metrics   (or /)   200 with the newest response, 503 before the first
+//
+// The collector thread calls Publish() once per sample. It renders the
+// whole HTTP response, headers and body, into a new immutable buffer and
+// swaps it in under a lock held only for the pointer swap. Scrapers are
+// served by a single poll() thread; each takes a reference to the buffer
+// current when its request arrived and write()s straight from it. A scrape
+// never reads /proc or formats anything, and however many there are, the
+// sampler waits at most for one pointer copy.
+//
+// Exported (all gauges unless noted; rates are per second over the last
+// sample interval, memory and rates in bytes):
+//   pmon_cpu_usage_percent, pmon_cpu_core_usage_percent{cpu}
+//   pmon_memory_total_bytes, pmon_memory_used_bytes
+//   pmon_pressure_some_avg10_percent{resource}   where the kernel has PSI
+//   pmon_disk_{read,write}_bytes_per_second{device}
+//   pmon_network_{receive,transmit}_bytes_per_second{interface}
+//   pmon_gpu_utilization_percent{gpu,name}, pmon_gpu_memory_{used,total}_bytes{gpu,name}
+//   pmon_processes
+//   pmon_process_{cpu_usage_percent,resident_memory_bytes,read_bytes_per_second,
+//                 write_bytes_per_second}{pid,name}   top N by CPU; I/O is
+//                 /proc/<pid>/io rchar/wchar, i.e. all read/write syscalls
+//   pmon_sample_timestamp_seconds, pmon_samples_total (counter)
+//   pmon_scrapes_total (counter, as of the previous sample)
+class MetricsServer {
+public:
+    MetricsServer();
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // Listens on `address` and starts serving. Accepted forms:
+    //   unix:PATH, or any PATH containing '/'   a Unix domain socket
+    //   PORT, 127.0.0.1:PORT, localhost:PORT     IPv4 loopback
+    //   [::1]:PORT                               IPv6 loopback
+    // Other hosts are refused: the endpoint is unauthenticated. Port 0 picks
+    // a free port (see Address()). A stale socket file is replaced; one
+    // another process still listens on is not.
+    bool Start(const std::string& address, std::string& error);
+    // Stops serving, closes every connection and removes the socket file.
+    void Stop();
+
+    // Processes in each response: the top `count` by CPU (default 20).
+    void SetTopProcesses(size_t count) { top_processes_ = count; }
+
+    // Renders `snapshot` and makes it the response to every later scrape.
+    // Call from the collector thread, once per sample.
+    void Publish(const Snapshot& snapshot);
+
+    // Where Start() is listening, with the port chosen when asked for 0.
+    const std::string& Address() const { return address_; }
+    uint64_t Scrapes() const { return scrapes_.load(std::memory_order_relaxed); }
+
+private:
+    // An HTTP response rendered once and shared by every scrape of it.
+    struct Response {
+        std::string bytes;
+        size_t header_bytes; // What a HEAD request gets
+    };
+
+    struct Client {
+        int fd;
+        std::string request;                     // Received, not yet answered
+        std::shared_ptr<const Response> response; // Being sent; null while reading
+        size_t sent = 0;
+        size_t length = 0;
+        bool close_after = false;
+        bool eof = false;                        // The peer has shut down its side
+    };
+
+    static std::shared_ptr<const Response> MakeResponse(const char* status, const char* body);
+
+    void Run();
+    // Starts answering the first complete request in client.request, if any.
+    // Returns false when the connection is to be dropped.
+    bool Answer(Client& client);
+    bool Receive(Client& client);
+    bool Send(Client& client);
+    void RenderBody(const Snapshot& snapshot);
+
+    int listen_fd_ = -1;
+    int wake_fds_[2] = {-1, -1};   // Stop() writes to [1] to end poll()
+    std::string address_;
+    std::string unix_path_;        // Removed on Stop()
+    bool tcp_ = false;
+    std::thread thread_;
+    std::vector<Client> clients_;  // Serving thread only
+
+    std::mutex current_mutex_;     // Guards current_ only
+    std::shared_ptr<const Response> current_;
+    std::shared_ptr<const Response> unavailable_, not_found_, bad_method_;
+
+    size_t top_processes_ = 20;
+    std::string body_;                                   // Collector thread scratch
+    std::vector<const ProcessData*> top_;
+    std::atomic<uint64_t> scrapes_{0};
+};
+
+#endif // METRICS_SERVER_H
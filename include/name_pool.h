@@ -0,0 +1,60 @@
+#ifndef NAME_POOL_H
+#define NAME_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Interned strings: each distinct text is stored once, NUL-terminated, in an
+// append-only arena and named by a dense id. Ids and the text behind them
+// stay valid for the pool's lifetime, so a ProcessData can carry a 4-byte id
+// instead of a std::string and a sample can be copied with memcpy.
+//
+// Intern() takes a lock; Get() does not, and may run concurrently with
+// Intern() on other threads for any id that Intern() has returned. Nothing
+// is ever freed: the pool grows with the number of distinct names, which
+// for process names is small and stable.
+class NamePool {
+public:
+    NamePool();
+
+    NamePool(const NamePool&) = delete;
+    NamePool& operator=(const NamePool&) = delete;
+
+    // Returns the id of `text`, adding it if new. Id 0 is the empty string;
+    // it is also returned for text longer than kMaxLength or when the pool
+    // is full.
+    unsigned Intern(std::string_view text);
+    const char* Get(unsigned id) const { return blocks_[id / kBlockIds][id % kBlockIds]; }
+
+    size_t Size() const { return count_.load(std::memory_order_acquire); }
+    size_t Bytes() const;
+
+    static constexpr size_t kMaxLength = 255;
+
+private:
+    static constexpr size_t kBlockIds = 4096;        // Ids per block of the id table
+    static constexpr size_t kMaxBlocks = 4096;       // Up to 16M names
+    static constexpr size_t kChunkBytes = 64 * 1024; // Arena chunk
+
+    mutable std::mutex mutex_;                       // Guards everything but count_ and Get()
+    std::unique_ptr<const char*[]> blocks_[kMaxBlocks];
+    std::atomic<size_t> count_{0};
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    size_t chunk_used_ = kChunkBytes;                // Bytes taken from the newest chunk
+    std::unordered_map<std::string_view, unsigned> ids_; // Views into the arena
+};
+
+// The pool behind ProcessData::name.
+unsigned InternProcessName(std::string_view name);
+const NamePool& ProcessNames();
+
+inline const char* ProcessName(unsigned id) {
+    return ProcessNames().Get(id);
+}
+
+#endif // NAME_POOL_H
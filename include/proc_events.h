@@ -0,0 +1,46 @@
+#ifndef PROC_EVENTS_H
+#define PROC_EVENTS_H
+
+#include <unordered_set>
+#include <vector>
+
+// Tracks the set of live PIDs from kernel proc connector events
+// (NETLINK_CONNECTOR, PROC_EVENT_FORK/EXEC/EXIT/COMM) so a scan can skip the
+// /proc directory walk. Subscribing needs CAP_NET_ADMIN in the initial user
+// and PID namespace; Open() reports whether the kernel accepted it.
+class ProcEventListener {
+public:
+    ProcEventListener() = default;
+    ~ProcEventListener();
+
+    ProcEventListener(const ProcEventListener&) = delete;
+    ProcEventListener& operator=(const ProcEventListener&) = delete;
+
+    // Opens the socket and subscribes. Returns false, leaving the listener
+    // closed, when the socket can't be opened or the kernel refuses the
+    // subscription.
+    bool Open();
+    void Close();
+    bool IsOpen() const { return fd_ >= 0; }
+
+    // Applies all queued events without blocking. Returns false when events
+    // may have been lost (receive buffer overrun); the PID set must then be
+    // re-seeded from a full walk before it is trusted again.
+    bool Poll();
+
+    // Replaces the PID set, typically with the result of a directory walk.
+    void Reset(const std::vector<int>& pids);
+
+    // Copies the current PID set into `out`.
+    void CopyPids(std::vector<int>& out) const;
+
+private:
+    bool WaitForAck();
+    void HandleMessage(const char* buf, long len);
+
+    int fd_ = -1;
+    bool lost_ = false;
+    std::unordered_set<int> pids_;
+};
+
+#endif // PROC_EVENTS_H
@@ -0,0 +1,155 @@
+#ifndef PROC_SCANNER_H
+#define PROC_SCANNER_H
+
+#include "proc_events.h"
+#include "process_parser.h"
+#include "worker_pool.h"
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+// Walks a procfs root with getdents64() and reads every per-PID file through
+// openat() relative to a directory fd, into a buffer reused by each thread.
+// No per-PID path strings, streams or stoi calls.
+//
+// The stat/status/io fds of each PID are kept open across scans and re-read
+// with pread(), so a steady process set costs one syscall per file per tick.
+// The number of cached fds is bounded; least recently used PIDs give theirs
+// up first, and PIDs over the budget are read with a transient open().
+//
+// With more than one worker, the PIDs of a walk are split into chunks for a
+// WorkStealingPool. Each worker parses into its own buffer and only touches
+// the table entries of its chunk; the table itself is updated on the
+// calling thread before and after the parallel part.
+//
+// In event-driven mode the PID list comes from a ProcEventListener instead
+// of the directory walk, with a full walk every kEventRescanInterval scans
+// (and after lost events) to correct drift.
+//
+// Reads are tiered. stat alone yields CPU times, state, ppid and RSS, and is
+// read for every PID on every scan. status (for the name) and io are read
+// only for PIDs that are active -- CPU time or I/O counters moved within the
+// last IdleInterval() scans, or running or in disk sleep -- or in the focus
+// set, or due: every PID is read in full at least once per IdleInterval()
+// scans, staggered by PID so the refreshes spread over the interval. Between
+// full reads a PID keeps its last name and I/O counters, marked io_carried
+// so the rate engine measures an idle process's I/O over the whole span
+// between two io reads and repeats that rate in the scans between them.
+class ProcScanner {
+public:
+    // fd_budget == 0 derives the budget from RLIMIT_NOFILE.
+    explicit ProcScanner(const std::string& proc_root = "/proc", size_t fd_budget = 0);
+    ~ProcScanner();
+
+    ProcScanner(const ProcScanner&) = delete;
+    ProcScanner& operator=(const ProcScanner&) = delete;
+
+    // Replaces the contents of `out` with one entry per live PID.
+    // The vector's capacity is reused across calls.
+    void Scan(std::vector<ProcessData>& out);
+
+    // fd slots held by cached PIDs (three per PID).
+    size_t CachedFds() const { return open_fds_; }
+    size_t FdBudget() const { return fd_budget_; }
+
+    // Number of threads reading /proc, including the caller. 0 picks one per
+    // hardware thread.
+    void SetWorkers(unsigned workers);
+    unsigned Workers() const { return pool_ ? pool_->Workers() : 1; }
+
+    // Switches event-driven PID tracking on or off. Returns whether it is
+    // on: enabling falls back to plain walks if the proc connector is
+    // unavailable.
+    bool SetEventDriven(bool enabled);
+    bool EventDriven() const { return events_.IsOpen(); }
+
+    // Longest gap, in scans, between two full reads of a PID; 1 reads every
+    // PID in full on every scan.
+    void SetIdleInterval(unsigned scans) { idle_interval_ = scans > 0 ? scans : 1; }
+    unsigned IdleInterval() const { return idle_interval_; }
+
+    // PIDs read in full on every scan, e.g. the rows on screen.
+    void SetFocus(std::vector<int> pids);
+
+    // Whether Scan() records into Phase::PROC_WALK and Phase::PROC_READ
+    // (default on). Off for scans already timed under another phase.
+    void SetPhaseTiming(bool enabled) { phase_timing_ = enabled; }
+    // Gives every entry `cgroup` instead of reading /proc/<pid>/cgroup,
+    // e.g. the threads of one process, which share its cgroup.
+    void SetFixedCgroup(unsigned cgroup) {
+        fixed_cgroup_ = cgroup;
+        has_fixed_cgroup_ = true;
+    }
+
+private:
+    enum FileKind { STAT, STATUS, IO, FILE_KINDS };
+
+    struct PidEntry {
+        int fds[FILE_KINDS] = {-1, -1, -1};
+        unsigned long long starttime = 0;
+        unsigned cgroup = 0;              // Interned path, read once per process
+        bool cgroup_read = false;
+        long long cpu_ticks = 0;          // utime + stime at the last scan
+        unsigned long long full_read = 0; // Scan generation of the last status/io read; 0 = never
+        unsigned long long active_until = 0; // Read in full up to this generation
+        unsigned name = 0;                // Carried between full reads
+        long long read_bytes = 0;
+        long long write_bytes = 0;
+        unsigned long long seen = 0;      // Scan generation of the last directory walk hit
+        unsigned long long last_used = 0; // Scan generation of the last read
+        bool cached = false;              // Holds fd budget; listed in lru_
+        std::list<int>::iterator lru_pos;
+    };
+
+    struct WorkItem {
+        int pid;
+        PidEntry* entry;
+    };
+
+    void CollectPids();
+    void WalkDirectory();
+    void ReadRange(size_t begin, size_t end, std::vector<ProcessData>& out);
+    bool ReadProcess(int pid, PidEntry& e, ProcessData& p);
+    bool NeedsFullRead(int pid, const PidEntry& e) const;
+    ssize_t ReadFile(int pid, PidEntry& e, FileKind kind, bool& gone);
+    unsigned ReadCgroup(int pid);
+    bool AcquireCache(int pid, PidEntry& e);
+    void CloseFds(PidEntry& e, bool forget_denied);
+    void Release(int pid, PidEntry& e);
+
+    int root_fd_;
+    size_t fd_budget_;
+    size_t open_fds_ = 0;
+    unsigned long long generation_ = 0;
+    unsigned idle_interval_ = 1;
+    bool phase_timing_ = true;
+    bool has_fixed_cgroup_ = false;
+    unsigned fixed_cgroup_ = 0;
+    std::vector<int> focus_;                     // Sorted
+    std::vector<int> pids_;                      // PIDs to read this scan
+    ProcEventListener events_;
+    unsigned long long last_walk_ = 0;           // Generation of the last full walk
+    std::unordered_map<int, PidEntry> table_;
+    std::list<int> lru_;                         // Cached PIDs, least recently used first
+    std::vector<WorkItem> work_;                 // Table entries to read this scan
+    std::unique_ptr<WorkStealingPool> pool_;     // Null when scanning on one thread
+    std::vector<std::vector<ProcessData>> worker_out_;
+};
+
+// --- Raw file parsers (operate on the bytes of one file) ---
+// /proc/[pid]/stat: fields are located after the last ')' so a comm
+// containing spaces or parentheses cannot shift them. Fills state (in the
+// status file's "S (sleeping)" form), ppid, utime, stime, starttime and
+// memory (RSS in KB).
+bool ParseProcStat(const char* buf, size_t len, ProcessData& p);
+// /proc/[pid]/status: Name, State, PPid and VmRSS. The name is interned
+// unless it matches the one `p` already holds.
+void ParseProcStatus(const char* buf, size_t len, ProcessData& p);
+// /proc/[pid]/io: rchar and wchar.
+void ParseProcIo(const char* buf, size_t len, ProcessData& p);
+
+#endif // PROC_SCANNER_H
@@ -0,0 +1,37 @@
+#ifndef PROCESS_COLUMNS_H
+#define PROCESS_COLUMNS_H
+
+#include "process_parser.h"
+#include <cstddef>
+#include <vector>
+
+// The processes of one sample as columns: one contiguous array per field,
+// entry i of every column describing processes[i]. The filter, the top-K
+// sort and the Processes list read these instead of the rows, so a filter
+// term scans one dense array and the sort partitions 4-byte row indices
+// while reading only its key column, rather than moving 96-byte rows.
+//
+// Only the fields those consumers use have a column. The rows stay the
+// record of the sample: recordings, exports, metrics, the history and the
+// process tree read them.
+struct ProcessColumns {
+    std::vector<int> pid;
+    std::vector<int> ppid;
+    std::vector<unsigned> name;     // Interned (see ProcessName())
+    std::vector<char> state;
+    std::vector<long> memory;       // KB
+    std::vector<float> cpu_usage;
+    std::vector<float> cpu_avg_1m;
+    std::vector<float> cpu_avg_5m;
+    std::vector<float> io_read_rate;  // KB/s
+    std::vector<float> io_write_rate; // KB/s
+    std::vector<unsigned> cgroup;   // Interned (see CgroupPath())
+
+    size_t Size() const { return pid.size(); }
+
+    // Refills every column from `processes`. Capacity is kept, so a steady
+    // process set costs no allocation.
+    void Assign(const std::vector<ProcessData>& processes);
+};
+
+#endif // PROCESS_COLUMNS_H
@@ -0,0 +1,78 @@
+#ifndef PROCESS_FILTER_H
+#define PROCESS_FILTER_H
+
+#include "process_columns.h"
+#include "process_parser.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Filter expressions over the process table, e.g.
+//
+//   cpu>5 && name~"nginx" && state==R || ppid==1
+//
+// Comparisons are `field op value`, combined with && (binding tighter),
+// ||, ! and parentheses. Fields and their operators:
+//
+//   pid ppid cpu cpu1m cpu5m mem read write io   == != < <= > >=
+//   name cgroup                                  == != ~ !~ (substring)
+//   state                                        == != (R, S, D, ... or
+//                                                "running", "sleeping", ...)
+//
+// cpu is a percentage, mem is KB and read/write/io are KB/s. Strings may be
+// quoted ("tmux: server") or bare words. Matching is case-sensitive.
+//
+// An expression is compiled once into a postfix program of comparisons.
+// It runs over a sample's ProcessColumns a column at a time: each comparison
+// fills a byte mask over all rows in one tight loop, and &&, || and ! combine masks. Names and
+// cgroups are interned, so a string comparison is decided once per distinct
+// name (and remembered for the life of the filter) rather than once per row.
+class ProcessFilter {
+public:
+    // Replaces the filter with `expression`; an empty one matches
+    // everything. On a syntax error returns false, sets Error() and keeps
+    // the previous filter.
+    bool Compile(const std::string& expression);
+    void Clear();
+
+    bool Empty() const { return program_.empty(); }
+    const std::string& Expression() const { return expression_; }
+    const std::string& Error() const { return error_; }
+
+    // Sets `rows` to the indices of the rows of `columns` that match, in
+    // order (all of them when the filter is empty).
+    void Select(const ProcessColumns& columns, std::vector<uint32_t>& rows);
+    // Removes the rows of `processes` that do not match, keeping the order
+    // of the rest; `columns` must have been assigned from `processes`.
+    void Apply(const ProcessColumns& columns, std::vector<ProcessData>& processes);
+
+    enum class Field { PID, PPID, CPU, CPU_1M, CPU_5M, MEM, READ, WRITE, IO, STATE, NAME, CGROUP };
+    enum class Op { EQ, NE, LT, LE, GT, GE, CONTAINS, EXCLUDES };
+
+    struct Term {
+        Field field;
+        Op op;
+        double number = 0;
+        char state = 0;
+        std::string text;
+        std::vector<int8_t> memo; // Per interned id: -1 unknown, else the result
+    };
+
+private:
+    struct Instr {
+        enum Kind { TERM, AND, OR, NOT } kind;
+        int term;
+    };
+    class Parser;
+
+    // Leaves the match mask of every row in masks_[0].
+    void Evaluate(const ProcessColumns& columns);
+
+    std::string expression_;
+    std::string error_;
+    std::vector<Term> terms_;
+    std::vector<Instr> program_;                // Postfix
+    std::vector<std::vector<uint8_t>> masks_;   // Evaluation stack, reused
+};
+
+#endif // PROCESS_FILTER_H
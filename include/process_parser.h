@@ -2,22 +2,35 @@
 #define PROCESS_PARSER_H
 
 #include <string>
+#include <type_traits>
 #include <vector>
 
+// Plain data with no owning members, so a sample is copied and sorted with
+// memcpy-cheap moves.
 struct ProcessData {
     int pid;
     int ppid;
-    std::string name;
-    std::string state;
+    unsigned name;       // Interned (see ProcessName()); 0 = unknown
+    char state;          // The letter of /proc/[pid]/stat ('R', 'S', 'D', ...); 0 = unknown
+    bool io_carried;     // read/write_bytes are from an earlier scan's io read (see ProcScanner)
     long memory;
     long utime;
     long stime;
+    unsigned long long starttime; // Clock ticks after boot; tells reused PIDs apart
     float cpu_usage;
+    float cpu_avg_1m;    // Filled from the history store
+    float cpu_avg_5m;
     long long read_bytes;
     long long write_bytes;
     float io_read_rate;  // In KB/s
     float io_write_rate; // In KB/s
+    unsigned cgroup;     // Interned cgroup v2 path (see CgroupPath()); 0 = unknown
 };
+static_assert(std::is_trivially_copyable<ProcessData>::value, "ProcessData must stay plain data");
+
+// "S (sleeping)" for 'S', as in /proc/[pid]/status; unknown letters are
+// returned alone and 0 gives "".
+const char* StateName(char state);
 
 std::vector<ProcessData> GetAllProcesses();
 long GetSystemUptime();
@@ -26,7 +39,34 @@ long GetSystemUptime();
 std::vector<ProcessData> GetAllProcesses();
 long GetSystemUptime();
 
+// Like GetAllProcesses(), but refills `processes` in place, reusing its capacity.
+void GetAllProcesses(std::vector<ProcessData>& processes);
+
 // Add this new function declaration
 void GetSystemCpuTimes(long long& total_time, long long& idle_time);
 
+// Number of threads GetAllProcesses() reads /proc with (0 = one per core).
+void SetCollectorThreads(unsigned threads);
+
+// Root of the procfs tree the collectors read ("/proc" by default), so a
+// synthetic tree can stand in for the host's. Covers GetAllProcesses(),
+// GetSystemCpuTimes(), GetSystemUptime() and the collectors in
+// system_stats.h. Thread and event settings carry over to the new root.
+void SetProcRoot(const std::string& root);
+const std::string& ProcRoot();
+
+// Tracks PIDs with kernel proc connector events instead of walking /proc
+// every tick. Returns false (and keeps walking) when the connector is
+// unavailable, e.g. without CAP_NET_ADMIN.
+bool SetCollectorEventDriven(bool enabled);
+
+// GetAllProcesses() reads every PID's stat file each call but its status
+// and io files only for active or focused PIDs, and for idle ones once per
+// this many calls (see ProcScanner); 1 reads everything every call.
+constexpr unsigned kDefaultIdleInterval = 5;
+void SetCollectorIdleInterval(unsigned samples);
+// PIDs whose status and io are read on every call, e.g. the rows on screen.
+// Replaces the previous set.
+void SetCollectorFocus(const std::vector<int>& pids);
+
 #endif // PROCESS_PARSER_H
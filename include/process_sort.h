@@ -0,0 +1,26 @@
+#ifndef PROCESS_SORT_H
+#define PROCESS_SORT_H
+
+#include "process_columns.h"
+#include "process_parser.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class SortKey { PID, MEMORY, CPU, IO };
+
+// Short label shown in the Processes view header.
+const char* SortKeyName(SortKey key);
+
+// Puts the `k` first processes by `key` at the front of `processes`, in
+// order; the rest are left in unspecified order. Uses nth_element plus a
+// sort of the prefix, so it costs O(n + k log k) rather than O(n log n).
+// Ties are broken by PID, so equal rows keep their place from tick to tick.
+void SortTopK(std::vector<ProcessData>& processes, SortKey key, size_t k);
+
+// The same over columns: reorders the row indices in `rows` (every row, or
+// a filter's selection) so the first `k` name the top rows of `columns` by
+// `key`, in order. Only the key and PID columns are read.
+void SortTopK(const ProcessColumns& columns, SortKey key, size_t k, std::vector<uint32_t>& rows);
+
+#endif // PROCESS_SORT_H
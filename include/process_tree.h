@@ -0,0 +1,77 @@
+#ifndef PROCESS_TREE_H
+#define PROCESS_TREE_H
+
+#include "process_parser.h"
+#include "process_sort.h"
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+// Parent/child view of one snapshot, rebuilt every tick. Everything lives in
+// flat arrays indexed by the process's position in the snapshot: a
+// pid -> index table (open addressing), the parent index, and the children
+// of every node stored contiguously (counting sort on the parent). Subtree
+// totals are summed in one pass over the reverse breadth-first order, where
+// every child comes before its parent. A process whose parent is missing
+// from the snapshot is a root.
+//
+// Collapsed subtrees are remembered by (pid, starttime), so a collapsed
+// service stays collapsed across ticks but a recycled PID does not inherit it.
+class ProcessTree {
+public:
+    // Totals over a process and all its descendants.
+    struct Rollup {
+        int pid = 0;             // The process's own, kept here for sibling order
+        float cpu_usage = 0;
+        long memory = 0;
+        float io_read_rate = 0;
+        float io_write_rate = 0;
+        int descendants = 0;
+    };
+
+    // One visible line of the tree, in display order.
+    struct Row {
+        int index;       // Into the snapshot the tree was built from
+        int depth;
+        bool has_children;
+        bool collapsed;
+    };
+
+    // Links `processes` (which must stay unchanged while the tree is used),
+    // orders every group of siblings by their subtree totals for `key` (PID
+    // ascending for SortKey::PID) and lists the visible rows.
+    void Build(const std::vector<ProcessData>& processes, SortKey key);
+
+    const std::vector<Row>& Rows() const { return rows_; }
+    const Rollup& Total(int index) const { return rollups_[index]; }
+
+    // Collapses or expands the subtree under `row`. Returns false when the
+    // row has no children. Takes effect in Rows() right away.
+    bool Toggle(size_t row);
+    bool SetCollapsed(size_t row, bool collapsed);
+
+private:
+    int Find(int pid) const;
+    void SortSiblings(SortKey key);
+    void Flatten();
+
+    struct Slot {
+        int pid;
+        int index;                  // -1 marks an empty slot
+    };
+
+    const std::vector<ProcessData>* processes_ = nullptr;
+    std::vector<Slot> slots_;       // pid -> index
+    std::vector<int> parent_;       // -1 for roots
+    std::vector<int> child_begin_;  // children_[child_begin_[i], child_begin_[i + 1])
+    std::vector<int> children_;     // Roots last, from child_begin_[n]
+    std::vector<int> order_;        // Breadth-first from the roots
+    std::vector<Rollup> rollups_;
+    std::vector<Row> rows_;
+    std::vector<std::pair<int, int>> stack_; // Flatten(): (index, depth)
+    std::set<std::pair<int, unsigned long long>> collapsed_;
+};
+
+#endif // PROCESS_TREE_H
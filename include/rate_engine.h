@@ -0,0 +1,73 @@
+#ifndef RATE_ENGINE_H
+#define RATE_ENGINE_H
+
+#include "process_parser.h"
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+// Computes CPU% and I/O rates from the counters of two consecutive samples.
+// The previous sample's counters are kept in a flat open-addressing table
+// keyed by (id, generation) -- (pid, starttime) for processes -- so a
+// recycled id starts from zero instead of inheriting its predecessor's
+// counters. Two tables are swapped every sample: an update is O(n) and
+// allocates only when the item count outgrows the table.
+//
+// I/O rates are per second of steady_clock time since the item's I/O
+// counters were last read, not since the last sample: a scanner that reads
+// an idle process's io file only every few samples marks the counters it
+// carried in between, and those samples repeat the last measured rate.
+class RateEngine {
+public:
+    struct Counters {
+        long long cpu;          // Same unit as the system total passed to Begin()
+        long long read_bytes;
+        long long write_bytes;
+        bool io_carried = false; // read/write_bytes were not re-read this sample
+    };
+
+    struct Rates {
+        float cpu_percent = 0;  // Of all CPUs
+        float read_kb = 0;      // Per second
+        float write_kb = 0;
+    };
+
+    // Fills cpu_usage (percent of all CPUs), io_read_rate and io_write_rate
+    // (KB/s) for every process. `system_total_time` is the current total from
+    // GetSystemCpuTimes(); the engine remembers the previous one itself.
+    void Update(std::vector<ProcessData>& processes, long long system_total_time);
+
+    // The same for any other kind of item: Begin(), then Next() once per
+    // item, then End(). `id` must not be 0. Items first seen this sample get
+    // zero rates.
+    void Begin(size_t items, long long system_total);
+    Rates Next(unsigned long long id, unsigned long long generation, const Counters& counters);
+    void End();
+
+private:
+    struct Slot {
+        unsigned long long id;          // 0 marks an empty slot
+        unsigned long long generation;
+        Counters counters;
+        std::chrono::steady_clock::time_point io_time; // When read/write_bytes were read
+        float read_kb;                                 // The rates measured then
+        float write_kb;
+    };
+
+    static size_t Hash(unsigned long long id, unsigned long long generation);
+    const Slot* Find(unsigned long long id, unsigned long long generation) const;
+    void Insert(const Slot& slot);
+    void Reset(size_t item_count);
+
+    std::vector<Slot> prev_;
+    std::vector<Slot> cur_;
+    long long prev_system_total_ = 0;
+    bool has_prev_ = false;
+
+    // --- Current sample, between Begin() and End() ---
+    long long system_total_ = 0;
+    long long system_delta_ = 0;
+    std::chrono::steady_clock::time_point now_;
+};
+
+#endif // RATE_ENGINE_H
@@ -0,0 +1,166 @@
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include "process_parser.h"
+#include "sampler.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// --- Recording file format ---
+// A recording is a file header followed by segments of frames, and, once
+// the recorder has closed cleanly, a segment index. All integers and floats
+// are in host byte order, like the binary export stream.
+//
+//   file header (32 bytes): "PMONREC1", u32 version, u32 header_bytes,
+//                           i64 interval_ms, i64 created_ms
+//   segment header (32 bytes): "SEGM", u32 frames, u64 payload_bytes,
+//                              i64 first_ms, i64 last_ms
+//   frame: u32 frame_bytes (excluding this field), i64 timestamp_ms, u8 flags,
+//          f32 cpu_percent, f32 mem_percent, i64 mem_total, i64 mem_free,
+//          i64 mem_used,
+//          [flags & 2] u16 disks, u16 interfaces, u16 gpus, then per disk and
+//                      interface: str name, f32 rate, f32 rate; per gpu:
+//                      i32 id, i32 utilization, i32 mem_used_mb,
+//                      i32 mem_total_mb, str name
+//          [flags & 1] varint processes, then the process table one column
+//                      at a time, rows in ascending PID order
+//   index: per segment i64 first_ms, i64 last_ms, u64 offset, u32 frames,
+//          u32 reserved; then u64 index_offset, u64 segments, "PMONIDX1"
+//
+// Process columns are delta-encoded against the row with the same PID and
+// starttime in the previous frame of the segment (zero when there is none):
+// a varint for pid (against the previous row) and a zigzag varint for
+// starttime; then a bitmap with a set bit for each row that equals its
+// reference in every other column, and for the remaining rows only: zigzag
+// varints for ppid, memory, utime, stime, read and write bytes; varints of
+// the XOR of the bit patterns for cpu and I/O rates; and name and state as
+// varint len + 1 and the bytes, or 0 when unchanged. The first frame of
+// every segment is thus self-contained, so decoding can start at any
+// segment.
+//
+// The segment header is rewritten after every frame, so a recording cut
+// short by a crash is readable up to its last complete frame; readers then
+// rebuild the index by hopping from segment header to segment header.
+
+struct RecordingSegment {
+    long long first_ms;
+    long long last_ms;
+    uint64_t offset;     // Of the segment header
+    uint32_t frames;
+    unsigned long long first_frame = 0; // Frames in earlier segments (not stored)
+};
+
+// Appends snapshots to a recording. Opening an existing recording continues
+// it: its index is dropped and rewritten by Close().
+class RecordingWriter {
+public:
+    RecordingWriter() = default;
+    ~RecordingWriter();
+
+    RecordingWriter(const RecordingWriter&) = delete;
+    RecordingWriter& operator=(const RecordingWriter&) = delete;
+
+    bool Open(const std::string& path, std::chrono::milliseconds interval, std::string& error);
+    // Returns false once a write has failed; Error() has the errno.
+    bool Append(const Snapshot& snapshot);
+    // Writes the segment index. Called by the destructor if needed.
+    void Close();
+
+    int Error() const { return error_; }
+    uint64_t Bytes() const { return file_bytes_; }
+
+private:
+    void EncodeFrame(const Snapshot& snapshot);
+    void EncodeProcesses(const std::vector<ProcessData>& processes);
+    bool WriteAt(const void* data, size_t size, uint64_t offset);
+
+    int fd_ = -1;
+    int error_ = 0;
+    uint64_t file_bytes_ = 0;
+    std::vector<RecordingSegment> index_;
+    uint64_t segment_bytes_ = 0;                // Payload of the open segment
+    std::vector<ProcessData> reference_;        // Previous frame, PID order
+    std::vector<ProcessData> rows_;
+    std::vector<const ProcessData*> order_;
+    std::vector<int32_t> refs_;                 // Row -> reference_ index, or -1
+    std::vector<uint32_t> changed_;             // Rows that differ from their reference
+    std::vector<char> buf_;
+    bool segment_open_ = false;
+};
+
+// Maps a recording read-only and exposes its segment index.
+class RecordingReader {
+public:
+    RecordingReader() = default;
+    ~RecordingReader();
+
+    RecordingReader(const RecordingReader&) = delete;
+    RecordingReader& operator=(const RecordingReader&) = delete;
+
+    bool Open(const std::string& path, std::string& error);
+
+    const std::vector<RecordingSegment>& Segments() const { return segments_; }
+    std::chrono::milliseconds Interval() const { return interval_; }
+    long long FirstTimestamp() const { return segments_.empty() ? 0 : segments_.front().first_ms; }
+    long long LastTimestamp() const { return segments_.empty() ? 0 : segments_.back().last_ms; }
+    unsigned long long Frames() const;
+    // True when the index was rebuilt from segment headers (no clean Close()).
+    bool Recovered() const { return recovered_; }
+
+    // Index of the last segment starting at or before `timestamp_ms` (0 if
+    // none does). Binary search over the index.
+    size_t FindSegment(long long timestamp_ms) const;
+
+    const char* Data() const { return data_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::chrono::milliseconds interval_{1000};
+    std::vector<RecordingSegment> segments_;
+    bool recovered_ = false;
+};
+
+// Decodes the frames of a recording in order, carrying the previous frame
+// the deltas refer to.
+class RecordingCursor {
+public:
+    explicit RecordingCursor(const RecordingReader& reader) : reader_(reader) {}
+
+    // Positions the cursor at the first frame of `segment`.
+    void Restart(size_t segment);
+    // Timestamp of the frame Next() returns, or -1 at the end.
+    long long PeekTimestamp() const;
+    // Decodes the next frame into `snapshot`. Returns false at the end or on
+    // a corrupt frame.
+    bool Next(Snapshot& snapshot);
+    // Decodes the last frame at or before `timestamp_ms` (the first frame if
+    // there is none) into `snapshot`: a binary search of the index, then at
+    // most one segment of frames.
+    bool Seek(long long timestamp_ms, Snapshot& snapshot);
+
+    size_t Segment() const { return segment_; }
+    // Frames of the recording up to and including the last decoded one.
+    unsigned long long Position() const { return position_; }
+
+private:
+    // Decodes a frame, leaving its processes in reference_.
+    bool Decode(Snapshot& snapshot);
+    bool DecodeProcesses(const char*& p, const char* end);
+    void CopyProcesses(Snapshot& snapshot) const;
+
+    const RecordingReader& reader_;
+    size_t segment_ = 0;
+    uint32_t frame_ = 0;                        // Within the segment
+    uint64_t offset_ = 0;                       // Of the next frame
+    unsigned long long position_ = 0;
+    std::vector<ProcessData> reference_;
+    std::vector<ProcessData> rows_;
+    std::vector<int32_t> refs_;
+    std::vector<uint32_t> changed_;
+};
+
+#endif // RECORDING_H
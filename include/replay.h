@@ -0,0 +1,50 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "history.h"
+#include "recording.h"
+#include "sampler.h"
+#include <chrono>
+#include <memory>
+#include <string>
+
+// Plays a recording back in place of the Sampler: the UI polls Acquire()
+// and draws Latest() the same way. Playback follows a recording-time clock
+// that advances with wall time times the speed, and can be paused or moved.
+class ReplayPlayer {
+public:
+    // `history_bytes` caps the history rebuilt during playback (0 = none).
+    explicit ReplayPlayer(size_t history_bytes);
+
+    bool Open(const std::string& path, std::string& error);
+
+    // --- Same contract as Sampler ---
+    bool Acquire();
+    Snapshot& Latest() { return frame_; }
+
+    // --- Transport ---
+    void TogglePause();
+    // Moves the clock by `delta_ms` of recording time; lands on the last
+    // frame at or before the target.
+    void SeekBy(long long delta_ms);
+    void SeekTo(long long timestamp_ms);
+    // 1x, 2x, 4x ... 64x, then back to 1x.
+    void CycleSpeed();
+
+    // One line describing the position, e.g. for the UI header.
+    std::string Status() const;
+
+private:
+    RecordingReader reader_;
+    RecordingCursor cursor_{reader_};
+    size_t history_bytes_;
+    std::unique_ptr<HistoryStore> history_;
+    Snapshot frame_;
+    long long clock_ms_ = 0;            // Recording time being shown
+    bool seek_pending_ = true;
+    bool paused_ = false;
+    int speed_ = 1;
+    std::chrono::steady_clock::time_point last_tick_;
+};
+
+#endif // REPLAY_H
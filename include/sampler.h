@@ -0,0 +1,142 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "cgroup_stats.h"
+#include "history.h"
+#include "process_columns.h"
+#include "process_parser.h"
+#include "rate_engine.h"
+#include "system_collector.h"
+#include "system_stats.h"
+#include "task_scanner.h"
+#include "triple_buffer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class MetricsServer;
+class RecordingWriter;
+
+// One sample of everything the views draw. Once published it is never
+// touched by the sampler again until the consumer hands the slot back.
+struct Snapshot {
+    SystemStats stats = {};
+    std::vector<ProcessData> processes;
+    ProcessColumns columns;           // Of processes, once the sample is complete
+    std::vector<ProcessData> threads; // Of process threads_of; not recorded or exported
+    int threads_of = 0;
+    bool has_processes = false;
+    bool has_devices = false;
+    bool has_cgroups = false;
+    unsigned long long sequence = 0; // 0 until the first sample lands
+    long long timestamp_ms = 0;      // Wall-clock time of the sample (Unix epoch)
+};
+
+// Fills Snapshots from the collectors, carrying the state that rates need
+// from one sample to the next. Used by the Sampler thread and directly by
+// headless mode.
+class SnapshotCollector {
+public:
+    void Collect(Snapshot& snapshot, bool processes, bool devices, bool cgroups = false);
+
+    // Keeps a bounded history of every sample from now on and fills the
+    // averages and sparklines derived from it into each snapshot.
+    void EnableHistory(std::chrono::milliseconds interval, size_t memory_cap_bytes);
+
+    // Also scans the threads of `pid` while processes are collected; 0 stops.
+    void SetThreadsOf(int pid) { threads_of_ = pid; }
+    // PIDs kept fully fresh on every sample (see SetCollectorFocus()).
+    void SetFocus(const std::vector<int>& pids) { SetCollectorFocus(pids); }
+
+    // Appends every sample to `recorder` (not owned) from now on.
+    void SetRecorder(RecordingWriter* recorder) { recorder_ = recorder; }
+    bool Recording() const { return recorder_ != nullptr; }
+    // Hands every sample to `metrics` (not owned) from now on.
+    void SetMetrics(MetricsServer* metrics) { metrics_ = metrics; }
+    bool Publishing() const { return metrics_ != nullptr; }
+
+private:
+    // One sample; Collect() times it and closes the instrumented tick.
+    void CollectTick(Snapshot& snapshot, bool processes, bool devices, bool cgroups);
+
+    SystemCollector system_;
+    RateEngine rates_;
+    CgroupCollector cgroups_;
+    TaskScanner tasks_;
+    int threads_of_ = 0;
+    std::unique_ptr<HistoryStore> history_;
+    RecordingWriter* recorder_ = nullptr;
+    MetricsServer* metrics_ = nullptr;
+    unsigned long long sequence_ = 0;
+};
+
+// Collects a Snapshot on a background thread at a fixed cadence and hands it
+// to the UI through a TripleBuffer, so input handling and drawing never wait
+// on /proc, and the sampling rate doesn't depend on how fast keys arrive.
+class Sampler {
+public:
+    // `history_bytes` caps the history store (0 disables it).
+    Sampler(std::chrono::milliseconds interval, size_t history_bytes);
+    ~Sampler();
+
+    Sampler(const Sampler&) = delete;
+    Sampler& operator=(const Sampler&) = delete;
+
+    void Start();
+    void Stop();
+
+    // Which collectors run. A change triggers an immediate sample.
+    void SetCollectProcesses(bool enabled);
+    void SetCollectDevices(bool enabled);
+    void SetCollectCgroups(bool enabled);
+    // Drills down into the threads of `pid` (0 = none).
+    void SetThreadsOf(int pid);
+    // The PIDs on screen and selected, read in full on every sample from the
+    // next one on. Does not trigger a sample.
+    void SetFocus(std::vector<int> pids);
+
+    // Takes the next sample now instead of at the next tick.
+    void RequestSample();
+
+    // Records every sample, with all recorded collectors (not cgroups or
+    // threads) running regardless of the settings above. Call before
+    // Start(); `recorder` must outlive Stop().
+    void SetRecorder(RecordingWriter* recorder) { collector_.SetRecorder(recorder); }
+    // Publishes every sample to `metrics`, likewise with processes and
+    // devices always collected. Call before Start(); `metrics` must outlive
+    // Stop().
+    void SetMetrics(MetricsServer* metrics) { collector_.SetMetrics(metrics); }
+
+    // --- UI side ---
+    // Swaps in the newest snapshot; returns true if Latest() changed.
+    bool Acquire() { return buffer_.Update(); }
+    // Owned by the caller until the next Acquire(); safe to sort in place.
+    Snapshot& Latest() { return buffer_.Front(); }
+
+private:
+    void Run();
+
+    std::chrono::milliseconds interval_;
+    TripleBuffer<Snapshot> buffer_;
+    std::atomic<bool> collect_processes_{true};
+    std::atomic<bool> collect_devices_{false};
+    std::atomic<bool> collect_cgroups_{false};
+    std::atomic<int> threads_of_{0};
+    std::mutex focus_mutex_;
+    std::vector<int> focus_;        // Guarded by focus_mutex_
+    bool focus_changed_ = false;
+
+    SnapshotCollector collector_;   // Only used on the sampler thread
+
+    std::thread thread_;
+    std::mutex mutex_;              // Guards only the wakeup flags below
+    std::condition_variable wake_cv_;
+    bool wake_ = false;
+    bool stop_ = false;
+};
+
+#endif // SAMPLER_H
@@ -0,0 +1,85 @@
+#ifndef SYSTEM_COLLECTOR_H
+#define SYSTEM_COLLECTOR_H
+
+#include "system_stats.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Reads the system-wide files under ProcRoot() -- stat, meminfo, diskstats,
+// net/dev and pressure/{cpu,memory,io} -- through descriptors opened once
+// and kept open, so a sample costs one pread() per file into a buffer that
+// is reused across samples. The descriptors are reopened when ProcRoot()
+// changes; a file that is missing (e.g. no PSI) is not retried until then.
+//
+// Disk and network rates are per second of steady_clock (CLOCK_MONOTONIC)
+// time between two reads of the file, so samples taken early or late, or
+// every 100 ms, report the same rates. A counter that goes backwards is
+// taken to have wrapped when it steps from near 2^32 to near 0 (drivers
+// that still export 32-bit counters) and to have been reset otherwise, in
+// which case the device reports no rate for that sample.
+//
+// Not thread-safe: each sampling thread owns its collector.
+class SystemCollector {
+public:
+    SystemCollector() = default;
+    ~SystemCollector();
+
+    SystemCollector(const SystemCollector&) = delete;
+    SystemCollector& operator=(const SystemCollector&) = delete;
+
+    // Fills cpu_percent and core_percent from the jiffies since the previous
+    // call. `total_time` and `idle_time` get the aggregate jiffies, as from
+    // GetSystemCpuTimes().
+    void CollectCpu(SystemStats& stats, long long& total_time, long long& idle_time);
+    // Fills mem_total, mem_free (MemAvailable), mem_used and mem_percent.
+    void CollectMemory(SystemStats& stats);
+    // Fills cpu_pressure, memory_pressure and io_pressure; -1 without PSI.
+    void CollectPressure(SystemStats& stats);
+    // Whole disks only: partitions, loop and ram devices and devices that
+    // never did any I/O are skipped. In /proc/diskstats order.
+    void CollectDisks(std::vector<DiskStats>& disks);
+    // Every interface, in /proc/net/dev order.
+    void CollectNetwork(std::vector<NetworkStats>& network);
+
+private:
+    enum File { STAT, MEMINFO, DISKSTATS, NETDEV, PRESSURE_CPU, PRESSURE_MEMORY, PRESSURE_IO, FILE_COUNT };
+
+    // Two monotonically increasing counters of one device, e.g. bytes in and out.
+    struct Counters {
+        std::string name;
+        unsigned long long first;
+        unsigned long long second;
+    };
+
+    struct CpuTimes {
+        unsigned long long total;
+        unsigned long long idle;
+    };
+
+    // Reads `file` into buf_ and NUL-terminates it; returns the length, or
+    // -1 when the file could not be opened or read. Sets read_time_.
+    long Read(File file);
+    void Reopen();
+    // Rates of `current` against `previous` (matched by name) over `seconds`,
+    // in KB/s; `scale` converts counter units to bytes. Then swaps them.
+    void Rates(std::vector<Counters>& current, std::vector<Counters>& previous, double seconds, double scale,
+               std::vector<float>& first_rates, std::vector<float>& second_rates);
+
+    std::string root_;
+    bool opened_ = false;
+    int fds_[FILE_COUNT] = {-1, -1, -1, -1, -1, -1, -1};
+    std::vector<char> buf_;
+    std::chrono::steady_clock::time_point read_time_;
+
+    CpuTimes total_prev_ = {0, 0};
+    std::vector<CpuTimes> cores_prev_; // By CPU number
+    std::vector<CpuTimes> cores_;
+
+    std::vector<Counters> disks_, disks_prev_;
+    std::vector<Counters> net_, net_prev_;
+    std::chrono::steady_clock::time_point disks_time_, net_time_;
+    std::vector<float> first_rates_, second_rates_;
+};
+
+#endif // SYSTEM_COLLECTOR_H
@@ -1,6 +1,8 @@
 #ifndef SYSTEM_STATS_H
 #define SYSTEM_STATS_H
 
+#include "cgroup_stats.h"
+#include <chrono>
 #include <string>
 #include <vector>
 
@@ -8,12 +10,14 @@ struct DiskStats {
     std::string name;
     float read_rate_kb;
     float write_rate_kb;
+    std::vector<float> history; // Recent read + write KB/s, oldest first
 };
 
 struct NetworkStats {
     std::string interface_name;
     float rx_rate_kb; // Received
     float tx_rate_kb; // Transmitted
+    std::vector<float> history; // Recent rx + tx KB/s, oldest first
 };
 
 struct GpuStats {
@@ -22,6 +26,8 @@ struct GpuStats {
     int utilization = 0;
     int mem_used_mb = 0;
     int mem_total_mb = 0;
+    int age_ms = 0;     // Since nvidia-smi last reported this GPU
+    bool stale = false; // Not reported for several query intervals
 };
 
 struct SystemStats {
@@ -33,15 +39,27 @@ struct SystemStats {
     std::vector<DiskStats> disks;
     std::vector<NetworkStats> network;
     std::vector<GpuStats> gpus;
+    std::vector<CgroupStats> cgroups; // Only in the cgroup view; not recorded or exported
+    // Live only, like cgroups: neither recorded nor exported.
+    std::vector<float> core_percent;  // Busy percent by CPU number
+    float cpu_pressure = -1.0f;       // /proc/pressure "some avg10", in percent;
+    float memory_pressure = -1.0f;    // -1 where the kernel has no PSI
+    float io_pressure = -1.0f;
+    std::vector<float> cpu_history; // Recent samples, oldest first
+    std::vector<float> mem_history;
 };
 
-// Existing function
+// One-off readers over a process-wide SystemCollector (system_collector.h),
+// serialized by a lock; a sampling loop should own its own collector.
 void GetMemoryInfo(long& total, long& free);
-
-// New parsing functions
 void GetDiskStats(std::vector<DiskStats>& disks);
 void GetNetworkStats(std::vector<NetworkStats>& network);
+// Returns the values cached by a background nvidia-smi reader (started on
+// the first call); never blocks on nvidia-smi.
 void GetNvidiaGpuStats(std::vector<GpuStats>& gpus);
+// How often that reader asks nvidia-smi for values. Call before the first
+// GetNvidiaGpuStats().
+void SetGpuQueryInterval(std::chrono::milliseconds interval);
 
 #endif // SYSTEM_STATS_H
 
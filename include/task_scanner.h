@@ -0,0 +1,41 @@
+#ifndef TASK_SCANNER_H
+#define TASK_SCANNER_H
+
+#include "proc_scanner.h"
+#include "process_parser.h"
+#include "rate_engine.h"
+#include <memory>
+#include <vector>
+
+// Threads of a single process, for the drill-down under an expanded row.
+// /proc/<pid>/task/<tid>/ has the same stat, status and io files as a PID,
+// so this is a ProcScanner rooted at the task directory, with its own small
+// fd cache and its own RateEngine for per-thread CPU% and I/O rates. The
+// scan is timed as a whole under Phase::THREADS rather than as PROC_WALK and
+// PROC_READ, and threads take the process's cgroup instead of each reading
+// their own cgroup file.
+// Nothing is opened until Follow() is called, and Stop() releases it all,
+// so collapsed processes cost no thread scanning at all.
+class TaskScanner {
+public:
+    // Starts scanning the threads of `pid` (a no-op if already following
+    // it), whose cgroup is `cgroup`.
+    void Follow(int pid, unsigned cgroup);
+    void Stop();
+    int Pid() const { return pid_; }
+
+    // Replaces `threads` with one entry per thread of the followed process;
+    // each entry's pid is the thread id. Empty once the process has exited.
+    void Scan(std::vector<ProcessData>& threads, long long system_total_time);
+
+    // Cached fds: the files of this many threads stay open between scans,
+    // the others are opened per read.
+    static constexpr size_t kCachedThreads = 64;
+
+private:
+    int pid_ = 0;
+    std::unique_ptr<ProcScanner> scanner_;
+    RateEngine rates_;
+};
+
+#endif // TASK_SCANNER_H
@@ -0,0 +1,43 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Lock-free single-producer/single-consumer handoff of the latest value.
+// The producer fills Back() and Publish()es it; the consumer calls Update()
+// to swap in the newest published value and then reads Front() for as long
+// as it likes. Neither side ever waits for the other, and each slot is
+// owned by exactly one side at a time, so values are reused, not copied.
+template <typename T>
+class TripleBuffer {
+public:
+    // --- Producer side ---
+    T& Back() { return slots_[back_]; }
+
+    void Publish() {
+        unsigned prev = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+        back_ = prev & kIndexMask;
+    }
+
+    // --- Consumer side ---
+    // Returns true if a newer value replaced Front().
+    bool Update() {
+        if (!(middle_.load(std::memory_order_acquire) & kFresh)) return false;
+        unsigned prev = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = prev & kIndexMask;
+        return true;
+    }
+
+    T& Front() { return slots_[front_]; }
+
+private:
+    static constexpr unsigned kIndexMask = 3;
+    static constexpr unsigned kFresh = 4; // Set on middle_ when it holds an unread value
+
+    T slots_[3];
+    alignas(64) unsigned back_ = 0;
+    alignas(64) unsigned front_ = 1;
+    alignas(64) std::atomic<unsigned> middle_{2};
+};
+
+#endif // TRIPLE_BUFFER_H
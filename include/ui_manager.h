@@ -1,15 +1,37 @@
 #ifndef UI_MANAGER_H
 #define UI_MANAGER_H
 
+#include "process_columns.h"
 #include "process_parser.h"
+#include "process_sort.h"
+#include "process_tree.h"
 #include "system_stats.h"
+#include <cstdint>
 #include <vector>
 #include <string>
 
 // Enum to manage which view is active
-enum class ViewMode { PROCESSES, PERFORMANCE };
+enum class ViewMode { PROCESSES, PERFORMANCE, CGROUPS };
 
 // The main draw function now takes the view mode
-void DrawUI(enum ViewMode view, const SystemStats& stats, const std::vector<ProcessData>& processes, const std::string& sort_key, size_t selected_row);
+// The Processes view lists rows order[0], order[1], ... of `columns`;
+// `order` only has to be sorted up to the window shown around
+// `selected_row`; see VisibleProcessRows(). A non-empty `status` replaces
+// the key hint in the header line (e.g. the replay position).
+// `show_timings` draws the per-phase timing overlay over the top right.
+// The cgroup view lists stats.cgroups, scrolled to `selected_row`.
+// With a `tree` built from the rows `columns` were assigned from, the
+// Processes view lists the tree's rows with subtree totals instead, and `selected_row` indexes those rows.
+// Otherwise `threads`, ordered already, are listed under the process
+// `expanded_pid`; they are not selectable.
+// A non-empty `footer` is shown on the bottom line (the filter prompt).
+void DrawUI(enum ViewMode view, const SystemStats& stats, const ProcessColumns& columns,
+            const std::vector<uint32_t>& order, SortKey sort_key, size_t selected_row,
+            const std::string& status = std::string(), bool show_timings = false, const ProcessTree* tree = nullptr,
+            int expanded_pid = 0, const std::vector<ProcessData>* threads = nullptr,
+            const std::string& footer = std::string());
+
+// Number of process rows that fit on screen.
+size_t VisibleProcessRows();
 
 #endif // UI_MANAGER_H
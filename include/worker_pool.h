@@ -0,0 +1,55 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool that runs a batch of numbered chunks on its threads plus
+// the calling thread. Every participant owns a contiguous range of chunks
+// and claims them from the front with an atomic counter; once its own range
+// is drained it steals from the other ranges the same way. No lock is taken
+// per chunk, only to start and finish a batch.
+class WorkStealingPool {
+public:
+    // `workers` counts the calling thread, so 1 means no extra threads.
+    explicit WorkStealingPool(unsigned workers);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned Workers() const { return workers_; }
+
+    // Calls fn(worker, chunk) once for every chunk in [0, chunks) and returns
+    // when all of them are done. `worker` is in [0, Workers()).
+    void Run(size_t chunks, const std::function<void(unsigned, size_t)>& fn);
+
+private:
+    struct alignas(64) Range {
+        std::atomic<size_t> next{0};
+        size_t end = 0;
+    };
+
+    void ThreadMain(unsigned worker);
+    void Drain(unsigned worker);
+
+    unsigned workers_;
+    std::unique_ptr<Range[]> ranges_;
+    std::vector<std::thread> threads_;
+    const std::function<void(unsigned, size_t)>* fn_ = nullptr;
+
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    unsigned long long batch_ = 0;
+    unsigned running_ = 0;
+    bool stop_ = false;
+};
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,191 @@
+#include "cgroup_stats.h"
+#include "instrumentation.h"
+#include "linux_dirent.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+// io.stat has one line per device; a few KB covers dozens of disks.
+constexpr size_t kReadBufSize = 8192;
+// Per level of recursion; a group directory lists a few dozen files.
+constexpr size_t kDirentBufSize = 4096;
+// Deeper groups are not listed (systemd nests a handful of levels).
+constexpr int kMaxDepth = 32;
+
+std::string DefaultRoot() {
+    if (access("/sys/fs/cgroup/cgroup.controllers", F_OK) == 0) return "/sys/fs/cgroup";
+    if (access("/sys/fs/cgroup/unified/cgroup.controllers", F_OK) == 0) return "/sys/fs/cgroup/unified";
+    return "/sys/fs/cgroup";
+}
+
+std::string& Root() {
+    static std::string root = DefaultRoot();
+    return root;
+}
+
+struct InternedPaths {
+    std::mutex mutex;
+    std::vector<std::string> paths{std::string()}; // Id 0: unknown
+    std::unordered_map<std::string, unsigned> ids;
+};
+
+InternedPaths& Interned() {
+    static InternedPaths interned;
+    return interned;
+}
+
+// Reads `name` in `dir_fd` into `buf` and NUL-terminates it. Returns the
+// length, or -1 when the file is missing (e.g. the controller is off).
+ssize_t ReadAt(int dir_fd, const char* name, char* buf, size_t size) {
+    int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+    PMON_TALLY_IO(1, 0);
+    if (fd < 0) return -1;
+    ssize_t len = pread(fd, buf, size - 1, 0);
+    close(fd);
+    PMON_TALLY_IO(2, len > 0 ? len : 0);
+    if (len < 0) return -1;
+    buf[len] = '\0';
+    return len;
+}
+
+// Sums the numbers after every occurrence of `key` (e.g. "rbytes=").
+long long SumAfter(const char* buf, const char* key) {
+    size_t key_len = std::strlen(key);
+    long long sum = 0;
+    for (const char* p = std::strstr(buf, key); p; p = std::strstr(p, key)) {
+        p += key_len;
+        sum += std::strtoll(p, nullptr, 10);
+    }
+    return sum;
+}
+
+} // namespace
+
+void SetCgroupRoot(const std::string& root) {
+    Root() = root;
+}
+
+const std::string& CgroupRoot() {
+    return Root();
+}
+
+unsigned InternCgroupPath(const char* path, size_t len) {
+    InternedPaths& interned = Interned();
+    std::lock_guard<std::mutex> lock(interned.mutex);
+    std::string key(path, len);
+    auto it = interned.ids.find(key);
+    if (it != interned.ids.end()) return it->second;
+    unsigned id = (unsigned)interned.paths.size();
+    interned.ids.emplace(key, id);
+    interned.paths.push_back(std::move(key));
+    return id;
+}
+
+std::string CgroupPath(unsigned id) {
+    InternedPaths& interned = Interned();
+    std::lock_guard<std::mutex> lock(interned.mutex);
+    return id < interned.paths.size() ? interned.paths[id] : std::string();
+}
+
+void CgroupCollector::Collect(std::vector<CgroupStats>& cgroups, long long system_total_time) {
+    samples_.clear();
+    int root_fd = open(CgroupRoot().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    struct stat st;
+    if (root_fd < 0 || fstat(root_fd, &st) != 0) {
+        if (root_fd >= 0) close(root_fd);
+        cgroups.clear();
+        return;
+    }
+    path_.clear();
+    size_t count = 0;
+    Walk(root_fd, st.st_ino, 0, cgroups, count);
+    close(root_fd);
+    cgroups.resize(count);
+
+    // cpu.stat counts microseconds; the system total is in clock ticks.
+    long ticks_per_second = sysconf(_SC_CLK_TCK);
+    rates_.Begin(count, system_total_time * (1000000 / (ticks_per_second > 0 ? ticks_per_second : 100)));
+    for (size_t i = 0; i < count; ++i) {
+        RateEngine::Rates rates = rates_.Next(samples_[i].inode, 0, samples_[i].counters);
+        cgroups[i].cpu_percent = rates.cpu_percent;
+        cgroups[i].io_read_rate_kb = rates.read_kb;
+        cgroups[i].io_write_rate_kb = rates.write_kb;
+    }
+    rates_.End();
+}
+
+void CgroupCollector::Walk(int dir_fd, unsigned long long inode, int depth, std::vector<CgroupStats>& cgroups,
+                           size_t& count) {
+    // Reuse the entries (and their path strings) of the previous sample.
+    if (count == cgroups.size()) cgroups.emplace_back();
+    CgroupStats& group = cgroups[count++];
+    if (path_.empty()) group.path.assign("/");
+    else group.path.assign(path_); // Not through a ?: with "/", which would copy path_ first
+    group.depth = depth;
+    ReadGroup(dir_fd, inode, group);
+    if (depth >= kMaxDepth) return;
+
+    // Walk() below may grow children_, so the list is indexed afresh.
+    if ((size_t)depth >= children_.size()) children_.resize(depth + 1);
+    size_t n = 0;
+    alignas(LinuxDirent64) char dirent_buf[kDirentBufSize];
+    while (true) {
+        long nread = syscall(SYS_getdents64, dir_fd, dirent_buf, sizeof(dirent_buf));
+        PMON_TALLY_IO(1, nread > 0 ? nread : 0);
+        if (nread <= 0) break;
+        for (long off = 0; off < nread;) {
+            auto* d = reinterpret_cast<LinuxDirent64*>(dirent_buf + off);
+            off += d->d_reclen;
+            if (d->d_type != DT_DIR || d->d_name[0] == '.') continue;
+            std::vector<Child>& children = children_[depth];
+            if (n == children.size()) children.emplace_back();
+            children[n].name.assign(d->d_name);
+            children[n].inode = d->d_ino;
+            ++n;
+        }
+    }
+    std::sort(children_[depth].begin(), children_[depth].begin() + n,
+              [](const Child& a, const Child& b) { return a.name < b.name; });
+
+    for (size_t i = 0; i < n; ++i) {
+        const Child& child = children_[depth][i];
+        int child_fd = openat(dir_fd, child.name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        PMON_TALLY_IO(1, 0);
+        if (child_fd < 0) continue; // Removed since the listing
+        size_t parent_len = path_.size();
+        path_ += '/';
+        path_ += child.name;
+        Walk(child_fd, child.inode, depth + 1, cgroups, count);
+        path_.resize(parent_len);
+        close(child_fd);
+        PMON_TALLY_IO(1, 0);
+    }
+}
+
+void CgroupCollector::ReadGroup(int dir_fd, unsigned long long inode, CgroupStats& group) {
+    char buf[kReadBufSize];
+    Sample sample = {inode, {0, 0, 0}};
+    if (ReadAt(dir_fd, "cpu.stat", buf, sizeof(buf)) > 0) sample.counters.cpu = SumAfter(buf, "usage_usec ");
+    group.memory_kb = 0;
+    if (ReadAt(dir_fd, "memory.current", buf, sizeof(buf)) > 0) group.memory_kb = (long)(std::atoll(buf) / 1024);
+    if (ReadAt(dir_fd, "io.stat", buf, sizeof(buf)) > 0) {
+        sample.counters.read_bytes = SumAfter(buf, "rbytes=");
+        sample.counters.write_bytes = SumAfter(buf, "wbytes=");
+    }
+    group.cpu_pressure = 0;
+    if (ReadAt(dir_fd, "cpu.pressure", buf, sizeof(buf)) > 0) {
+        const char* some = std::strstr(buf, "some avg10=");
+        if (some) group.cpu_pressure = std::strtof(some + 11, nullptr);
+    }
+    samples_.push_back(sample);
+}
@@ -0,0 +1,491 @@
+#include "exporter.h"
+#include "instrumentation.h"
+#include "metrics_server.h"
+#include "name_pool.h"
+#include "process_filter.h"
+#include "recording.h"
+#include <cerrno>
+#include <charconv>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+volatile std::sig_atomic_t g_stop = 0;
+
+void HandleStopSignal(int) {
+    g_stop = 1;
+}
+
+// The stat letter, '?' when unknown.
+char StateChar(char state) {
+    return state ? state : '?';
+}
+
+void AppendJsonString(OutputBuffer& out, std::string_view text) {
+    out.Append('"');
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out.Append('\\');
+            out.Append(c);
+        } else if ((unsigned char)c < 0x20) {
+            static const char kHex[] = "0123456789abcdef";
+            out.Append("\\u00");
+            out.Append(kHex[(c >> 4) & 0xf]);
+            out.Append(kHex[c & 0xf]);
+        } else {
+            out.Append(c);
+        }
+    }
+    out.Append('"');
+}
+
+void AppendCsvString(OutputBuffer& out, std::string_view text) {
+    if (text.find_first_of(",\"\n") == std::string_view::npos) {
+        out.Append(text);
+        return;
+    }
+    out.Append('"');
+    for (char c : text) {
+        if (c == '"') out.Append('"');
+        out.Append(c);
+    }
+    out.Append('"');
+}
+
+template <typename T>
+void AppendValue(OutputBuffer& out, T value) {
+    out.AppendRaw(&value, sizeof(value));
+}
+
+void AppendShortString(OutputBuffer& out, std::string_view text) {
+    uint8_t len = (uint8_t)std::min<size_t>(text.size(), 255);
+    AppendValue(out, len);
+    out.AppendRaw(text.data(), len);
+}
+
+size_t ShortStringBytes(std::string_view text) {
+    return 1 + std::min<size_t>(text.size(), 255);
+}
+
+// {"seq":N,"syscalls":N,"bytes":N,"phases":{"tick":{"last":ns,"p50":ns,...},...}}
+// Phases that have not run yet are left out.
+void WriteTimings(unsigned long long sequence) {
+    TickIo io = LastTickIo();
+    std::string line;
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "{\"seq\":%llu,\"syscalls\":%llu,\"bytes\":%llu,\"phases\":{", sequence,
+                  (unsigned long long)io.syscalls, (unsigned long long)io.bytes);
+    line += buf;
+    bool first = true;
+    for (int i = 0; i < (int)Phase::COUNT; ++i) {
+        PhaseSummary summary = SummarizePhase((Phase)i);
+        if (summary.count == 0) continue;
+        std::snprintf(buf, sizeof(buf), "%s\"%s\":{\"last\":%llu,\"p50\":%llu,\"p99\":%llu,\"max\":%llu}",
+                      first ? "" : ",", PhaseName((Phase)i), (unsigned long long)summary.last_ns,
+                      (unsigned long long)summary.p50_ns, (unsigned long long)summary.p99_ns,
+                      (unsigned long long)summary.max_ns);
+        line += buf;
+        first = false;
+    }
+    line += "}}\n";
+    std::fputs(line.c_str(), stderr);
+}
+
+} // namespace
+
+bool ParseExportFormat(const std::string& text, ExportFormat& format) {
+    if (text == "csv") format = ExportFormat::CSV;
+    else if (text == "jsonl") format = ExportFormat::JSONL;
+    else if (text == "binary") format = ExportFormat::BINARY;
+    else return false;
+    return true;
+}
+
+// --- OutputBuffer ---
+OutputBuffer::OutputBuffer(int fd) : fd_(fd), data_(new char[kCapacity]) {}
+
+char* OutputBuffer::Reserve(size_t size) {
+    if (len_ + size > kCapacity) Flush();
+    char* p = data_.get() + len_;
+    len_ += size;
+    return p;
+}
+
+void OutputBuffer::Append(std::string_view text) {
+    if (text.size() > kCapacity) {
+        Flush();
+        WriteAll(text.data(), text.size());
+        return;
+    }
+    std::memcpy(Reserve(text.size()), text.data(), text.size());
+}
+
+void OutputBuffer::Append(char c) {
+    *Reserve(1) = c;
+}
+
+void OutputBuffer::AppendInt(long long value) {
+    char* p = Reserve(24);
+    len_ -= 24;
+    auto result = std::to_chars(p, p + 24, value);
+    len_ += result.ptr - p;
+}
+
+void OutputBuffer::AppendFloat(float value) {
+    char* p = Reserve(48);
+    len_ -= 48;
+    auto result = std::to_chars(p, p + 48, value, std::chars_format::fixed, 2);
+    if (result.ec != std::errc()) {
+        *p = '0';
+        result.ptr = p + 1;
+    }
+    len_ += result.ptr - p;
+}
+
+void OutputBuffer::AppendRaw(const void* data, size_t size) {
+    std::memcpy(Reserve(size), data, size);
+}
+
+bool OutputBuffer::Flush() {
+    WriteAll(data_.get(), len_);
+    len_ = 0;
+    return !failed_;
+}
+
+void OutputBuffer::WriteAll(const char* data, size_t size) {
+    size_t written = 0;
+    while (!failed_ && written < size) {
+        ssize_t n = write(fd_, data + written, size - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            failed_ = true;
+            error_ = errno;
+            break;
+        }
+        written += (size_t)n;
+    }
+}
+
+// --- SnapshotWriter ---
+SnapshotWriter::SnapshotWriter(ExportFormat format, int fd) : format_(format), out_(fd) {}
+
+bool SnapshotWriter::Write(const Snapshot& snapshot) {
+    if (!header_written_) {
+        WriteHeader();
+        header_written_ = true;
+    }
+    switch (format_) {
+        case ExportFormat::CSV: WriteCsv(snapshot); break;
+        case ExportFormat::JSONL: WriteJsonl(snapshot); break;
+        case ExportFormat::BINARY: WriteBinary(snapshot); break;
+    }
+    return out_.Flush();
+}
+
+void SnapshotWriter::WriteHeader() {
+    if (format_ == ExportFormat::BINARY) {
+        out_.Append("PMONBIN1");
+    } else if (format_ == ExportFormat::CSV) {
+        out_.Append("#system,ts_ms,cpu_percent,mem_total_kb,mem_used_kb,mem_percent\n"
+                    "#disk,ts_ms,name,read_kbs,write_kbs\n"
+                    "#net,ts_ms,name,rx_kbs,tx_kbs\n"
+                    "#gpu,ts_ms,id,name,utilization,mem_used_mb,mem_total_mb\n"
+                    "#process,ts_ms,pid,ppid,name,state,mem_kb,cpu_percent,read_kbs,write_kbs\n");
+    }
+}
+
+void SnapshotWriter::WriteCsv(const Snapshot& snapshot) {
+    const SystemStats& stats = snapshot.stats;
+    long long ts = snapshot.timestamp_ms;
+
+    out_.Append("system,");
+    out_.AppendInt(ts);
+    out_.Append(',');
+    out_.AppendFloat(stats.cpu_percent);
+    out_.Append(',');
+    out_.AppendInt(stats.mem_total);
+    out_.Append(',');
+    out_.AppendInt(stats.mem_used);
+    out_.Append(',');
+    out_.AppendFloat(stats.mem_percent);
+    out_.Append('\n');
+
+    for (const auto& disk : stats.disks) {
+        out_.Append("disk,");
+        out_.AppendInt(ts);
+        out_.Append(',');
+        AppendCsvString(out_, disk.name);
+        out_.Append(',');
+        out_.AppendFloat(disk.read_rate_kb);
+        out_.Append(',');
+        out_.AppendFloat(disk.write_rate_kb);
+        out_.Append('\n');
+    }
+    for (const auto& net : stats.network) {
+        out_.Append("net,");
+        out_.AppendInt(ts);
+        out_.Append(',');
+        AppendCsvString(out_, net.interface_name);
+        out_.Append(',');
+        out_.AppendFloat(net.rx_rate_kb);
+        out_.Append(',');
+        out_.AppendFloat(net.tx_rate_kb);
+        out_.Append('\n');
+    }
+    for (const auto& gpu : stats.gpus) {
+        out_.Append("gpu,");
+        out_.AppendInt(ts);
+        out_.Append(',');
+        out_.AppendInt(gpu.id);
+        out_.Append(',');
+        AppendCsvString(out_, gpu.name);
+        out_.Append(',');
+        out_.AppendInt(gpu.utilization);
+        out_.Append(',');
+        out_.AppendInt(gpu.mem_used_mb);
+        out_.Append(',');
+        out_.AppendInt(gpu.mem_total_mb);
+        out_.Append('\n');
+    }
+    for (const auto& p : snapshot.processes) {
+        out_.Append("process,");
+        out_.AppendInt(ts);
+        out_.Append(',');
+        out_.AppendInt(p.pid);
+        out_.Append(',');
+        out_.AppendInt(p.ppid);
+        out_.Append(',');
+        AppendCsvString(out_, ProcessName(p.name));
+        out_.Append(',');
+        out_.Append(StateChar(p.state));
+        out_.Append(',');
+        out_.AppendInt(p.memory);
+        out_.Append(',');
+        out_.AppendFloat(p.cpu_usage);
+        out_.Append(',');
+        out_.AppendFloat(p.io_read_rate);
+        out_.Append(',');
+        out_.AppendFloat(p.io_write_rate);
+        out_.Append('\n');
+    }
+}
+
+void SnapshotWriter::WriteJsonl(const Snapshot& snapshot) {
+    const SystemStats& stats = snapshot.stats;
+    long long ts = snapshot.timestamp_ms;
+
+    out_.Append("{\"type\":\"system\",\"ts_ms\":");
+    out_.AppendInt(ts);
+    out_.Append(",\"cpu_percent\":");
+    out_.AppendFloat(stats.cpu_percent);
+    out_.Append(",\"mem_total_kb\":");
+    out_.AppendInt(stats.mem_total);
+    out_.Append(",\"mem_used_kb\":");
+    out_.AppendInt(stats.mem_used);
+    out_.Append(",\"mem_percent\":");
+    out_.AppendFloat(stats.mem_percent);
+    out_.Append("}\n");
+
+    for (const auto& disk : stats.disks) {
+        out_.Append("{\"type\":\"disk\",\"ts_ms\":");
+        out_.AppendInt(ts);
+        out_.Append(",\"name\":");
+        AppendJsonString(out_, disk.name);
+        out_.Append(",\"read_kbs\":");
+        out_.AppendFloat(disk.read_rate_kb);
+        out_.Append(",\"write_kbs\":");
+        out_.AppendFloat(disk.write_rate_kb);
+        out_.Append("}\n");
+    }
+    for (const auto& net : stats.network) {
+        out_.Append("{\"type\":\"net\",\"ts_ms\":");
+        out_.AppendInt(ts);
+        out_.Append(",\"name\":");
+        AppendJsonString(out_, net.interface_name);
+        out_.Append(",\"rx_kbs\":");
+        out_.AppendFloat(net.rx_rate_kb);
+        out_.Append(",\"tx_kbs\":");
+        out_.AppendFloat(net.tx_rate_kb);
+        out_.Append("}\n");
+    }
+    for (const auto& gpu : stats.gpus) {
+        out_.Append("{\"type\":\"gpu\",\"ts_ms\":");
+        out_.AppendInt(ts);
+        out_.Append(",\"id\":");
+        out_.AppendInt(gpu.id);
+        out_.Append(",\"name\":");
+        AppendJsonString(out_, gpu.name);
+        out_.Append(",\"utilization\":");
+        out_.AppendInt(gpu.utilization);
+        out_.Append(",\"mem_used_mb\":");
+        out_.AppendInt(gpu.mem_used_mb);
+        out_.Append(",\"mem_total_mb\":");
+        out_.AppendInt(gpu.mem_total_mb);
+        out_.Append("}\n");
+    }
+    for (const auto& p : snapshot.processes) {
+        out_.Append("{\"type\":\"process\",\"ts_ms\":");
+        out_.AppendInt(ts);
+        out_.Append(",\"pid\":");
+        out_.AppendInt(p.pid);
+        out_.Append(",\"ppid\":");
+        out_.AppendInt(p.ppid);
+        out_.Append(",\"name\":");
+        AppendJsonString(out_, ProcessName(p.name));
+        out_.Append(",\"state\":\"");
+        out_.Append(StateChar(p.state));
+        out_.Append("\",\"mem_kb\":");
+        out_.AppendInt(p.memory);
+        out_.Append(",\"cpu_percent\":");
+        out_.AppendFloat(p.cpu_usage);
+        out_.Append(",\"read_kbs\":");
+        out_.AppendFloat(p.io_read_rate);
+        out_.Append(",\"write_kbs\":");
+        out_.AppendFloat(p.io_write_rate);
+        out_.Append("}\n");
+    }
+}
+
+void SnapshotWriter::WriteBinary(const Snapshot& snapshot) {
+    const SystemStats& stats = snapshot.stats;
+
+    // Size the frame up front so its length prefix can be written first.
+    uint32_t frame_bytes = 8 + 4 + 4 + 8 + 8 + 4 + 2 + 2 + 2 + 2;
+    for (const auto& p : snapshot.processes) frame_bytes += 4 + 4 + 8 + 4 + 4 + 4 + 1 + ShortStringBytes(ProcessName(p.name));
+    for (const auto& disk : stats.disks) frame_bytes += ShortStringBytes(disk.name) + 8;
+    for (const auto& net : stats.network) frame_bytes += ShortStringBytes(net.interface_name) + 8;
+    for (const auto& gpu : stats.gpus) frame_bytes += 16 + ShortStringBytes(gpu.name);
+
+    AppendValue(out_, frame_bytes);
+    AppendValue(out_, (int64_t)snapshot.timestamp_ms);
+    AppendValue(out_, stats.cpu_percent);
+    AppendValue(out_, stats.mem_percent);
+    AppendValue(out_, (int64_t)stats.mem_total);
+    AppendValue(out_, (int64_t)stats.mem_used);
+    AppendValue(out_, (uint32_t)snapshot.processes.size());
+    AppendValue(out_, (uint16_t)stats.disks.size());
+    AppendValue(out_, (uint16_t)stats.network.size());
+    AppendValue(out_, (uint16_t)stats.gpus.size());
+    AppendValue(out_, (uint16_t)0);
+
+    for (const auto& p : snapshot.processes) {
+        AppendValue(out_, (int32_t)p.pid);
+        AppendValue(out_, (int32_t)p.ppid);
+        AppendValue(out_, (int64_t)p.memory);
+        AppendValue(out_, p.cpu_usage);
+        AppendValue(out_, p.io_read_rate);
+        AppendValue(out_, p.io_write_rate);
+        AppendValue(out_, (uint8_t)StateChar(p.state));
+        AppendShortString(out_, ProcessName(p.name));
+    }
+    for (const auto& disk : stats.disks) {
+        AppendShortString(out_, disk.name);
+        AppendValue(out_, disk.read_rate_kb);
+        AppendValue(out_, disk.write_rate_kb);
+    }
+    for (const auto& net : stats.network) {
+        AppendShortString(out_, net.interface_name);
+        AppendValue(out_, net.rx_rate_kb);
+        AppendValue(out_, net.tx_rate_kb);
+    }
+    for (const auto& gpu : stats.gpus) {
+        AppendValue(out_, (int32_t)gpu.id);
+        AppendValue(out_, (int32_t)gpu.utilization);
+        AppendValue(out_, (int32_t)gpu.mem_used_mb);
+        AppendValue(out_, (int32_t)gpu.mem_total_mb);
+        AppendShortString(out_, gpu.name);
+    }
+}
+
+// --- Headless Loop ---
+int RunHeadless(const HeadlessOptions& options) {
+    int fd = STDOUT_FILENO;
+    if (!options.output.empty()) {
+        fd = open(options.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            std::perror(options.output.c_str());
+            return 1;
+        }
+    }
+
+    // A closed pipe ends the stream instead of killing the process.
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, HandleStopSignal);
+    std::signal(SIGTERM, HandleStopSignal);
+
+    ProcessFilter filter;
+    if (!filter.Compile(options.filter)) {
+        std::fprintf(stderr, "invalid filter: %s\n", filter.Error().c_str());
+        if (fd != STDOUT_FILENO) close(fd);
+        return 1;
+    }
+
+    SnapshotCollector collector;
+    Snapshot snapshot;
+    auto writer = std::make_unique<SnapshotWriter>(options.format, fd);
+    RecordingWriter recorder;
+    if (!options.record.empty()) {
+        std::string error;
+        if (!recorder.Open(options.record, options.interval, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            if (fd != STDOUT_FILENO) close(fd);
+            return 1;
+        }
+    }
+
+    MetricsServer metrics;
+    if (!options.metrics.empty()) {
+        std::string error;
+        if (!metrics.Start(options.metrics, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            if (fd != STDOUT_FILENO) close(fd);
+            return 1;
+        }
+        metrics.SetTopProcesses(options.metrics_top);
+    }
+
+    // The first sample only primes the rate counters.
+    collector.Collect(snapshot, true, true);
+    if (!options.record.empty()) collector.SetRecorder(&recorder);
+    if (!options.metrics.empty()) collector.SetMetrics(&metrics);
+
+    auto next_tick = std::chrono::steady_clock::now();
+    long long written = 0;
+    int status = 0;
+    while (!g_stop && (options.count == 0 || written < options.count)) {
+        next_tick += options.interval;
+        std::this_thread::sleep_until(next_tick);
+        if (g_stop) break;
+
+        collector.Collect(snapshot, true, true);
+        if (!filter.Empty()) {
+            PMON_TIME_PHASE(Phase::FILTER);
+            filter.Apply(snapshot.columns, snapshot.processes);
+        }
+        if (!writer->Write(snapshot)) {
+            // The reader going away (EPIPE) is a normal way to stop.
+            status = writer->Error() == EPIPE ? 0 : 1;
+            break;
+        }
+        ++written;
+        if (options.timings) WriteTimings(snapshot.sequence);
+        if (recorder.Error() != 0) {
+            std::fprintf(stderr, "%s: %s\n", options.record.c_str(), std::strerror(recorder.Error()));
+            status = 1;
+            break;
+        }
+
+        // Fall behind rather than burst when a sample overruns the interval.
+        auto now = std::chrono::steady_clock::now();
+        if (next_tick < now) next_tick = now;
+    }
+
+    if (fd != STDOUT_FILENO) close(fd);
+    return status;
+}
@@ -0,0 +1,229 @@
+#include "gpu_collector.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace {
+
+// A child that lived this long was working; its exit starts the backoff over.
+constexpr std::chrono::seconds kHealthyRun{30};
+// Values older than this many query intervals are flagged stale.
+constexpr int kStaleIntervals = 3;
+// A line longer than this is garbage, not nvidia-smi output.
+constexpr size_t kMaxLineBytes = 4096;
+
+const char* SkipSpaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    return p;
+}
+
+// "[N/A]", "[Not Supported]" and other non-numbers read as 0.
+int ParseField(const char* begin, const char* end) {
+    begin = SkipSpaces(begin, end);
+    int value = 0;
+    for (; begin < end && *begin >= '0' && *begin <= '9'; ++begin) value = value * 10 + (*begin - '0');
+    return value;
+}
+
+} // namespace
+
+constexpr std::chrono::milliseconds GpuCollector::kInitialBackoff;
+constexpr std::chrono::milliseconds GpuCollector::kMaxBackoff;
+
+bool ParseNvidiaSmiLine(const char* line, size_t len, GpuStats& gpu) {
+    const char* end = line + len;
+    while (end > line && (end[-1] == '\r' || end[-1] == ' ')) --end;
+
+    // index, name, utilization, memory.used, memory.total. The name is
+    // whatever lies between the first and the last three commas.
+    const char* commas[4];
+    const char* first = std::find(line, end, ',');
+    if (first == end) return false;
+    commas[0] = first;
+    const char* p = end;
+    for (int i = 3; i >= 1; --i) {
+        while (p > first && p[-1] != ',') --p;
+        if (p == first) return false;
+        commas[i] = --p;
+    }
+    if (commas[1] == first) return false; // Only four fields
+
+    const char* digits = SkipSpaces(line, first);
+    if (digits == first || *digits < '0' || *digits > '9') return false;
+    gpu.id = ParseField(line, first);
+    const char* name = SkipSpaces(commas[0] + 1, commas[1]);
+    const char* name_end = commas[1];
+    while (name_end > name && name_end[-1] == ' ') --name_end;
+    gpu.name.assign(name, name_end);
+    gpu.utilization = ParseField(commas[1] + 1, commas[2]);
+    gpu.mem_used_mb = ParseField(commas[2] + 1, commas[3]);
+    gpu.mem_total_mb = ParseField(commas[3] + 1, end);
+    return true;
+}
+
+GpuCollector::~GpuCollector() {
+    Stop();
+}
+
+void GpuCollector::Start(std::chrono::milliseconds interval) {
+    if (thread_.joinable()) return;
+    if (pipe2(stop_pipe_, O_CLOEXEC) != 0) return;
+    interval_ = std::max(interval, std::chrono::milliseconds(100));
+    backoff_ = kInitialBackoff;
+    thread_ = std::thread(&GpuCollector::Run, this);
+}
+
+void GpuCollector::Stop() {
+    if (!thread_.joinable()) return;
+    char byte = 0;
+    while (write(stop_pipe_[1], &byte, 1) < 0 && errno == EINTR) {}
+    thread_.join();
+    if (child_ >= 0) Reap();
+    close(stop_pipe_[0]);
+    close(stop_pipe_[1]);
+    stop_pipe_[0] = stop_pipe_[1] = -1;
+}
+
+void GpuCollector::Copy(std::vector<GpuStats>& gpus) const {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    gpus.clear();
+    for (const auto& [index, entry] : gpus_) {
+        gpus.push_back(entry.stats);
+        GpuStats& gpu = gpus.back();
+        gpu.age_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(now - entry.updated).count();
+        gpu.stale = gpu.age_ms > kStaleIntervals * interval_.count();
+    }
+}
+
+unsigned GpuCollector::Spawns() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return spawns_;
+}
+
+bool GpuCollector::Spawn() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++spawns_;
+    }
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) return false;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    std::string lms = std::to_string(interval_.count());
+    char* argv[] = {
+        const_cast<char*>("nvidia-smi"),
+        const_cast<char*>("--query-gpu=index,name,utilization.gpu,memory.used,memory.total"),
+        const_cast<char*>("--format=csv,noheader,nounits"),
+        const_cast<char*>("-lms"),
+        const_cast<char*>(lms.c_str()),
+        nullptr,
+    };
+    pid_t pid = -1;
+    int rc = posix_spawnp(&pid, "nvidia-smi", &actions, nullptr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (rc != 0) {
+        close(fds[0]);
+        return false;
+    }
+    child_ = pid;
+    out_fd_ = fds[0];
+    pending_.clear();
+    started_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+void GpuCollector::Reap() {
+    kill(child_, SIGKILL); // A hung nvidia-smi must not hold up Stop()
+    while (waitpid(child_, nullptr, 0) < 0 && errno == EINTR) {}
+    close(out_fd_);
+    child_ = -1;
+    out_fd_ = -1;
+}
+
+bool GpuCollector::WaitUntil(std::chrono::steady_clock::time_point deadline) {
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        int timeout = now >= deadline ? 0
+            : (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+        pollfd stop = {stop_pipe_[0], POLLIN, 0};
+        int rc = poll(&stop, 1, timeout);
+        if (rc > 0) return false;
+        if (rc == 0) return true;
+        if (errno != EINTR) return true;
+    }
+}
+
+void GpuCollector::Run() {
+    auto retry_at = std::chrono::steady_clock::now();
+    while (true) {
+        if (child_ < 0) {
+            if (!WaitUntil(retry_at)) return;
+            if (!Spawn()) {
+                // Not installed (or not runnable): try again later, less often.
+                retry_at = std::chrono::steady_clock::now() + backoff_;
+                backoff_ = std::min(backoff_ * 2, kMaxBackoff);
+                continue;
+            }
+        }
+
+        pollfd fds[2] = {{out_fd_, POLLIN, 0}, {stop_pipe_[0], POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents) return;
+        if (fds[0].revents) {
+            ReadOutput();
+            if (out_fd_ < 0) {
+                // The child exited; restart it after the backoff.
+                auto now = std::chrono::steady_clock::now();
+                if (now - started_ >= kHealthyRun) backoff_ = kInitialBackoff;
+                retry_at = now + backoff_;
+                backoff_ = std::min(backoff_ * 2, kMaxBackoff);
+            }
+        }
+    }
+}
+
+void GpuCollector::ReadOutput() {
+    char buf[4096];
+    ssize_t n = read(out_fd_, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) return;
+    if (n <= 0) {
+        Reap();
+        return;
+    }
+    pending_.append(buf, (size_t)n);
+
+    // Parse every complete line; keep the tail for the next read.
+    auto now = std::chrono::steady_clock::now();
+    size_t start = 0, newline;
+    std::lock_guard<std::mutex> lock(mutex_);
+    while ((newline = pending_.find('\n', start)) != std::string::npos) {
+        GpuStats gpu;
+        if (ParseNvidiaSmiLine(pending_.data() + start, newline - start, gpu)) {
+            Entry& entry = gpus_[gpu.id];
+            entry.stats = gpu;
+            entry.updated = now;
+        }
+        start = newline + 1;
+    }
+    pending_.erase(0, start);
+    if (pending_.size() > kMaxLineBytes) pending_.clear();
+}
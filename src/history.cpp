@@ -0,0 +1,239 @@
+#include "history.h"
+#include "sampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+// Ring size a series starts with; it doubles from there as needed.
+constexpr uint32_t kInitialRingBytes = 16;
+
+constexpr int64_t kHistoryMs = 5 * 60 * 1000;
+constexpr int64_t kWindowMs = 60 * 1000;
+
+int64_t Quantize(float value, float scale) {
+    return (int64_t)std::llround((double)value * scale);
+}
+
+} // namespace
+
+// --- CompressedSeries ---
+void CompressedSeries::Append(int64_t value, size_t max_samples, size_t window, MemoryBudget& budget) {
+    if (count_ == 0) {
+        base_ = last_ = value;
+        sum_ = value;
+        count_ = 1;
+        win_count_ = 1;
+        win_cursor_ = 0;
+        win_value_ = value;
+        win_sum_ = value;
+        return;
+    }
+    while (count_ >= std::max<size_t>(max_samples, 2)) DropOldest();
+
+    int64_t delta = value - last_;
+    uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+    uint8_t bytes[10];
+    uint32_t n = 0;
+    do {
+        uint8_t b = zigzag & 0x7f;
+        zigzag >>= 7;
+        if (zigzag) b |= 0x80;
+        bytes[n++] = b;
+    } while (zigzag);
+
+    while (len_ + n > cap_) {
+        if (Grow(budget)) continue;
+        if (count_ < 2) return; // Not even one delta fits: drop the sample
+        DropOldest();
+    }
+    for (uint32_t i = 0; i < n; ++i) ring_[(head_ + len_ + i) % cap_] = bytes[i];
+    len_ += n;
+    ++count_;
+    sum_ += value;
+    last_ = value;
+
+    win_sum_ += value;
+    ++win_count_;
+    while (win_count_ > std::max<size_t>(window, 1)) {
+        int64_t step;
+        win_cursor_ += Decode(win_cursor_, step);
+        win_sum_ -= win_value_;
+        win_value_ += step;
+        --win_count_;
+    }
+    if (count_ > std::max<size_t>(max_samples, 1)) DropOldest(); // Room was kept for at least two
+}
+
+void CompressedSeries::Release(MemoryBudget& budget) {
+    budget.Release(cap_);
+    *this = CompressedSeries();
+}
+
+void CompressedSeries::Recent(size_t n, float scale, std::vector<float>& out) const {
+    out.clear();
+    size_t skip = count_ > n ? count_ - n : 0;
+    int64_t value = base_;
+    uint32_t offset = 0;
+    for (size_t i = 0; i < count_; ++i) {
+        if (i >= skip) out.push_back((float)value * scale);
+        if (i + 1 < count_) {
+            int64_t delta;
+            offset += Decode(offset, delta);
+            value += delta;
+        }
+    }
+}
+
+uint32_t CompressedSeries::Decode(uint32_t offset, int64_t& delta) const {
+    uint64_t zigzag = 0;
+    uint32_t n = 0;
+    int shift = 0;
+    uint8_t b;
+    do {
+        b = At(offset + n++);
+        zigzag |= (uint64_t)(b & 0x7f) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+    return n;
+}
+
+bool CompressedSeries::Grow(MemoryBudget& budget) {
+    uint32_t new_cap = cap_ ? cap_ * 2 : kInitialRingBytes;
+    if (!budget.TryCharge(new_cap - cap_)) return false;
+    std::unique_ptr<uint8_t[]> ring(new uint8_t[new_cap]);
+    for (uint32_t i = 0; i < len_; ++i) ring[i] = At(i);
+    ring_ = std::move(ring);
+    cap_ = new_cap;
+    head_ = 0;
+    return true;
+}
+
+void CompressedSeries::DropOldest() {
+    int64_t delta;
+    uint32_t n = Decode(0, delta);
+    bool window_is_everything = (win_count_ == count_);
+
+    int64_t dropped = base_;
+    sum_ -= dropped;
+    base_ += delta;
+    head_ = (head_ + n) % cap_;
+    len_ -= n;
+    --count_;
+
+    if (window_is_everything) {
+        win_sum_ -= dropped;
+        win_value_ = base_;
+        win_cursor_ = 0;
+        --win_count_;
+    } else {
+        win_cursor_ -= n;
+    }
+}
+
+// --- HistoryStore ---
+void HistoryStore::SampleTimes::Add(int64_t time_ms, size_t max_samples) {
+    if (!times.empty() && time_ms < times.back()) time_ms = times.back(); // The wall clock was stepped back
+    times.push_back(time_ms);
+    while (times.size() > max_samples || time_ms - times.front() >= kHistoryMs) {
+        times.pop_front();
+        if (window_start > 0) --window_start;
+    }
+    while (time_ms - times[window_start] >= kWindowMs) ++window_start;
+}
+
+HistoryStore::HistoryStore(std::chrono::milliseconds interval, size_t memory_cap_bytes)
+    : budget_(memory_cap_bytes) {
+    // Twice what five minutes hold on schedule, leaving room for the extra
+    // samples the UI asks for.
+    long long ms = std::max<long long>(interval.count(), 1);
+    max_samples_ = (size_t)std::max<long long>(2, 2 * kHistoryMs / ms);
+}
+
+void HistoryStore::Record(Snapshot& snapshot) {
+    ++generation_;
+    SystemStats& stats = snapshot.stats;
+
+    system_times_.Add(snapshot.timestamp_ms, max_samples_);
+    cpu_.Append(Quantize(stats.cpu_percent, 100.0f), system_times_.Samples(), system_times_.Window(), budget_);
+    mem_.Append(Quantize(stats.mem_percent, 100.0f), system_times_.Samples(), system_times_.Window(), budget_);
+    cpu_.Recent(kSparklinePoints, 0.01f, stats.cpu_history);
+    mem_.Recent(kSparklinePoints, 0.01f, stats.mem_history);
+
+    if (snapshot.has_devices) {
+        device_times_.Add(snapshot.timestamp_ms, max_samples_);
+        for (auto& disk : stats.disks) {
+            RecordDevice("disk:" + disk.name, disk.read_rate_kb + disk.write_rate_kb, disk.history);
+        }
+        for (auto& net : stats.network) {
+            RecordDevice("net:" + net.interface_name, net.rx_rate_kb + net.tx_rate_kb, net.history);
+        }
+        Reap(devices_, sizeof(std::pair<const std::string, DeviceHistory>) + 2 * sizeof(void*));
+    }
+
+    if (snapshot.has_processes) {
+        // Node overhead is charged too, so the cap covers the whole store.
+        const size_t entry_bytes = sizeof(std::pair<const uint64_t, ProcessHistory>) + 2 * sizeof(void*);
+        process_times_.Add(snapshot.timestamp_ms, max_samples_);
+        size_t samples = process_times_.Samples(), window = process_times_.Window();
+        for (auto& p : snapshot.processes) {
+            uint64_t key = ProcessKey(p.pid, p.starttime);
+            auto it = processes_.find(key);
+            if (it == processes_.end()) {
+                if (!budget_.TryCharge(entry_bytes)) {
+                    p.cpu_avg_1m = p.cpu_avg_5m = p.cpu_usage;
+                    continue;
+                }
+                it = processes_.emplace(key, ProcessHistory()).first;
+            }
+            ProcessHistory& h = it->second;
+            h.seen = generation_;
+            h.cpu.Append(Quantize(p.cpu_usage, 100.0f), samples, window, budget_);
+            p.cpu_avg_1m = (float)(h.cpu.WindowMean() / 100.0);
+            p.cpu_avg_5m = (float)(h.cpu.Mean() / 100.0);
+        }
+        Reap(processes_, entry_bytes);
+    }
+}
+
+uint64_t HistoryStore::ProcessKey(int pid, unsigned long long starttime) {
+    // starttime (clock ticks) fits in 42 bits for centuries; PIDs in 22.
+    return ((uint64_t)starttime << 22) | (uint64_t)(pid & 0x3fffff);
+}
+
+const CompressedSeries* HistoryStore::ProcessCpu(int pid, unsigned long long starttime) const {
+    auto it = processes_.find(ProcessKey(pid, starttime));
+    return it == processes_.end() ? nullptr : &it->second.cpu;
+}
+
+void HistoryStore::RecordDevice(const std::string& key, float rate, std::vector<float>& sparkline) {
+    auto it = devices_.find(key);
+    if (it == devices_.end()) {
+        if (!budget_.TryCharge(sizeof(std::pair<const std::string, DeviceHistory>) + 2 * sizeof(void*))) return;
+        it = devices_.emplace(key, DeviceHistory()).first;
+    }
+    it->second.seen = generation_;
+    it->second.rate.Append(Quantize(rate, 1.0f), device_times_.Samples(), device_times_.Window(), budget_);
+    it->second.rate.Recent(kSparklinePoints, 1.0f, sparkline);
+}
+
+// Drops the entries that were not part of this generation's sample.
+template <typename Map>
+void HistoryStore::Reap(Map& map, size_t entry_bytes) {
+    for (auto it = map.begin(); it != map.end();) {
+        if (it->second.seen == generation_) {
+            ++it;
+            continue;
+        }
+        if constexpr (std::is_same_v<typename Map::mapped_type, ProcessHistory>) {
+            it->second.cpu.Release(budget_);
+        } else {
+            it->second.rate.Release(budget_);
+        }
+        budget_.Release(entry_bytes);
+        it = map.erase(it);
+    }
+}
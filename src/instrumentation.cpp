@@ -0,0 +1,139 @@
+#include "instrumentation.h"
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+// Bucket b covers [2^(b/4) * (1 + (b%4)/4), the next bucket's start) ns.
+constexpr int kSubBuckets = 4;
+constexpr int kBuckets = 64 * kSubBuckets;
+
+struct Histogram {
+    std::atomic<uint64_t> buckets[kBuckets] = {};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> last{0};
+    std::atomic<uint64_t> max{0};
+};
+
+Histogram g_phases[(int)Phase::COUNT];
+std::atomic<uint64_t> g_syscalls{0};
+std::atomic<uint64_t> g_bytes{0};
+std::atomic<uint64_t> g_last_syscalls{0};
+std::atomic<uint64_t> g_last_bytes{0};
+uint64_t g_tick_syscalls = 0; // Totals at the previous tick end (collector thread only)
+uint64_t g_tick_bytes = 0;
+
+int BucketOf(uint64_t ns) {
+    if (ns < kSubBuckets) return (int)ns;
+    int msb = 63 - __builtin_clzll(ns);
+    int sub = (int)((ns >> (msb - 2)) & (kSubBuckets - 1));
+    return msb * kSubBuckets + sub;
+}
+
+// Upper bound of a bucket, used as the percentile value.
+uint64_t BucketLimit(int bucket) {
+    if (bucket < kSubBuckets) return (uint64_t)bucket;
+    int msb = bucket / kSubBuckets;
+    int sub = bucket % kSubBuckets;
+    return ((uint64_t)(kSubBuckets + sub + 1) << (msb - 2)) - 1;
+}
+
+uint64_t Percentile(const uint64_t* counts, uint64_t total, double fraction) {
+    uint64_t target = (uint64_t)(fraction * (double)total);
+    if (target >= total) target = total - 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < kBuckets; ++b) {
+        seen += counts[b];
+        if (seen > target) return BucketLimit(b);
+    }
+    return BucketLimit(kBuckets - 1);
+}
+
+} // namespace
+
+thread_local TickIo tl_tick_io;
+
+const char* PhaseName(Phase phase) {
+    switch (phase) {
+        case Phase::TICK: return "tick";
+        case Phase::PROC_WALK: return "proc.walk";
+        case Phase::PROC_READ: return "proc.read";
+        case Phase::RATES: return "rates";
+        case Phase::HISTORY: return "history";
+        case Phase::COLUMNS: return "columns";
+        case Phase::SYSTEM: return "system";
+        case Phase::DISKS: return "disks";
+        case Phase::NETWORK: return "network";
+        case Phase::GPU: return "gpu";
+        case Phase::CGROUPS: return "cgroups";
+        case Phase::THREADS: return "threads";
+        case Phase::RECORD: return "record";
+        case Phase::METRICS: return "metrics";
+        case Phase::FILTER: return "filter";
+        case Phase::SORT: return "sort";
+        case Phase::TREE: return "tree";
+        case Phase::DRAW: return "draw";
+        case Phase::COUNT: break;
+    }
+    return "?";
+}
+
+bool InstrumentationEnabled() {
+#ifdef PMON_NO_INSTRUMENTATION
+    return false;
+#else
+    return true;
+#endif
+}
+
+void RecordPhase(Phase phase, uint64_t ns) {
+    Histogram& h = g_phases[(int)phase];
+    h.buckets[BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    h.count.fetch_add(1, std::memory_order_relaxed);
+    h.last.store(ns, std::memory_order_relaxed);
+    uint64_t max = h.max.load(std::memory_order_relaxed);
+    while (ns > max && !h.max.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+}
+
+void FlushThreadIo() {
+    if (tl_tick_io.syscalls == 0 && tl_tick_io.bytes == 0) return;
+    g_syscalls.fetch_add(tl_tick_io.syscalls, std::memory_order_relaxed);
+    g_bytes.fetch_add(tl_tick_io.bytes, std::memory_order_relaxed);
+    tl_tick_io = {};
+}
+
+void EndInstrumentedTick() {
+    FlushThreadIo();
+    uint64_t syscalls = g_syscalls.load(std::memory_order_relaxed);
+    uint64_t bytes = g_bytes.load(std::memory_order_relaxed);
+    g_last_syscalls.store(syscalls - g_tick_syscalls, std::memory_order_relaxed);
+    g_last_bytes.store(bytes - g_tick_bytes, std::memory_order_relaxed);
+    g_tick_syscalls = syscalls;
+    g_tick_bytes = bytes;
+}
+
+PhaseSummary SummarizePhase(Phase phase) {
+    const Histogram& h = g_phases[(int)phase];
+    uint64_t counts[kBuckets];
+    uint64_t total = 0;
+    for (int b = 0; b < kBuckets; ++b) {
+        counts[b] = h.buckets[b].load(std::memory_order_relaxed);
+        total += counts[b];
+    }
+    PhaseSummary summary;
+    if (total == 0) return summary;
+    summary.count = total;
+    summary.last_ns = h.last.load(std::memory_order_relaxed);
+    summary.max_ns = h.max.load(std::memory_order_relaxed);
+    // Bucket limits can overshoot the largest sample actually seen.
+    summary.p50_ns = std::min(Percentile(counts, total, 0.50), summary.max_ns);
+    summary.p99_ns = std::min(Percentile(counts, total, 0.99), summary.max_ns);
+    return summary;
+}
+
+TickIo LastTickIo() {
+    TickIo io;
+    io.syscalls = g_last_syscalls.load(std::memory_order_relaxed);
+    io.bytes = g_last_bytes.load(std::memory_order_relaxed);
+    return io;
+}
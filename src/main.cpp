@@ -3,106 +3,391 @@
 #include <vector>
 #include <string>
 #include <algorithm>
-#include <map>
 #include <signal.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <memory>
+#include "cgroup_stats.h"
+#include "exporter.h"
+#include "instrumentation.h"
+#include "metrics_server.h"
+#include "process_filter.h"
 #include "process_parser.h"
+#include "process_tree.h"
+#include "recording.h"
+#include "replay.h"
+#include "sampler.h"
 #include "ui_manager.h"
 #include "system_stats.h"
 
-int main() {
+// How often the UI thread wakes up to check for input and new snapshots.
+static const int kInputPollMs = 50;
+
+// --- Command Line ---
+static void PrintUsage(const char* prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  --threads=N        read /proc with N threads (0 = one per core, default 1)\n");
+    fprintf(stderr, "  --proc-events      track PIDs with netlink proc events instead of walking /proc\n");
+    fprintf(stderr, "  --proc-root=DIR    read procfs from DIR instead of /proc\n");
+    fprintf(stderr, "  --idle-refresh=N   re-read name and I/O of idle processes every N samples (default %u)\n",
+            kDefaultIdleInterval);
+    fprintf(stderr, "  --cgroup-root=DIR  cgroup v2 hierarchy for the cgroup view (default /sys/fs/cgroup)\n");
+    fprintf(stderr, "  --interval=T       sampling interval, e.g. 250ms or 2s (default 1s)\n");
+    fprintf(stderr, "  --history-mb=N     memory cap for the in-memory history (default 64, 0 = off)\n");
+    fprintf(stderr, "  --headless         stream samples instead of starting the UI\n");
+    fprintf(stderr, "  --format=F         headless format: csv, jsonl or binary (default jsonl)\n");
+    fprintf(stderr, "  --output=FILE      headless output file (default stdout)\n");
+    fprintf(stderr, "  --count=N          stop after N headless samples\n");
+    fprintf(stderr, "  --timings          headless: write per-phase timings to stderr each sample\n");
+    fprintf(stderr, "  --filter=EXPR      only show (or export) matching processes, e.g. 'cpu>5 && name~nginx'\n");
+    fprintf(stderr, "  --record=FILE      append every sample to a recording\n");
+    fprintf(stderr, "  --replay=FILE      play a recording back in the UI\n");
+    fprintf(stderr, "  --metrics=ADDR     serve Prometheus metrics on unix:PATH or a loopback [HOST:]PORT\n");
+    fprintf(stderr, "  --metrics-top=N    processes in the metrics, busiest first (default 20)\n");
+}
+
+// Returns the text after `prefix` if `arg` starts with it, else nullptr.
+static const char* OptionValue(const char* arg, const char* prefix) {
+    size_t len = strlen(prefix);
+    return strncmp(arg, prefix, len) == 0 ? arg + len : nullptr;
+}
+
+// Accepts "250ms", "2s", "0.5s" or a bare number of milliseconds.
+static bool ParseInterval(const char* text, std::chrono::milliseconds& interval) {
+    char* end = nullptr;
+    double value = strtod(text, &end);
+    if (end == text || value <= 0) return false;
+    if (strcmp(end, "s") == 0) value *= 1000.0;
+    else if (*end != '\0' && strcmp(end, "ms") != 0) return false;
+    interval = std::chrono::milliseconds((long long)value);
+    return interval.count() > 0;
+}
+
+int main(int argc, char* argv[]) {
+    bool headless = false;
+    HeadlessOptions headless_options;
+    std::chrono::milliseconds interval(1000);
+    size_t history_mb = 64;
+    std::string record_path;
+    std::string replay_path;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* value = nullptr;
+        if ((value = OptionValue(argv[i], "--threads="))) {
+            SetCollectorThreads((unsigned)atoi(value));
+        } else if (strcmp(argv[i], "--proc-events") == 0) {
+            if (!SetCollectorEventDriven(true)) {
+                fprintf(stderr, "proc connector unavailable, falling back to /proc scans\n");
+            }
+        } else if ((value = OptionValue(argv[i], "--proc-root="))) {
+            SetProcRoot(value);
+        } else if ((value = OptionValue(argv[i], "--idle-refresh="))) {
+            SetCollectorIdleInterval((unsigned)atoi(value));
+        } else if ((value = OptionValue(argv[i], "--cgroup-root="))) {
+            SetCgroupRoot(value);
+        } else if ((value = OptionValue(argv[i], "--interval="))) {
+            if (!ParseInterval(value, interval)) {
+                fprintf(stderr, "invalid interval: %s\n", value);
+                return 1;
+            }
+        } else if ((value = OptionValue(argv[i], "--history-mb="))) {
+            history_mb = (size_t)atoll(value);
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if ((value = OptionValue(argv[i], "--format="))) {
+            if (!ParseExportFormat(value, headless_options.format)) {
+                fprintf(stderr, "unknown format: %s\n", value);
+                return 1;
+            }
+        } else if ((value = OptionValue(argv[i], "--output="))) {
+            headless_options.output = value;
+        } else if ((value = OptionValue(argv[i], "--count="))) {
+            headless_options.count = atoll(value);
+        } else if (strcmp(argv[i], "--timings") == 0) {
+            headless_options.timings = true;
+        } else if ((value = OptionValue(argv[i], "--filter="))) {
+            headless_options.filter = value;
+        } else if ((value = OptionValue(argv[i], "--record="))) {
+            record_path = value;
+        } else if ((value = OptionValue(argv[i], "--replay="))) {
+            replay_path = value;
+        } else if ((value = OptionValue(argv[i], "--metrics="))) {
+            headless_options.metrics = value;
+        } else if ((value = OptionValue(argv[i], "--metrics-top="))) {
+            headless_options.metrics_top = (size_t)atoll(value);
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    SetGpuQueryInterval(interval);
+
+    if (headless) {
+        headless_options.interval = interval;
+        headless_options.record = record_path;
+        return RunHeadless(headless_options);
+    }
+
+    ProcessFilter filter;
+    if (!filter.Compile(headless_options.filter)) {
+        fprintf(stderr, "invalid filter: %s\n", filter.Error().c_str());
+        return 1;
+    }
+
+    // --- Snapshot Source ---
+    // Either the background sampler (snapshots arrive once per tick
+    // regardless of input; the UI thread only reads the latest one) or a
+    // recording played back through the same Acquire()/Latest() contract.
+    MetricsServer metrics;
+    std::unique_ptr<Sampler> sampler;
+    std::unique_ptr<ReplayPlayer> player;
+    RecordingWriter recorder;
+    std::string error;
+    if (!replay_path.empty()) {
+        if (!headless_options.metrics.empty()) {
+            fprintf(stderr, "--metrics serves live samples and cannot be used with --replay\n");
+            return 1;
+        }
+        player = std::make_unique<ReplayPlayer>(history_mb << 20);
+        if (!player->Open(replay_path, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    } else {
+        sampler = std::make_unique<Sampler>(interval, history_mb << 20);
+        if (!record_path.empty()) {
+            if (!recorder.Open(record_path, interval, error)) {
+                fprintf(stderr, "%s\n", error.c_str());
+                return 1;
+            }
+            sampler->SetRecorder(&recorder);
+        }
+        if (!headless_options.metrics.empty()) {
+            if (!metrics.Start(headless_options.metrics, error)) {
+                fprintf(stderr, "%s\n", error.c_str());
+                return 1;
+            }
+            metrics.SetTopProcesses(headless_options.metrics_top);
+            sampler->SetMetrics(&metrics);
+        }
+        sampler->Start();
+    }
+
     initscr();
     noecho();
     cbreak();
     keypad(stdscr, TRUE);
     curs_set(0);
-    timeout(1000);
+    set_escdelay(25); // Esc closes the filter prompt; no escape sequences start with a lone Esc here
+    timeout(kInputPollMs);
 
     // --- Main State Variables ---
     ViewMode current_view = ViewMode::PROCESSES;
-    std::string sort_key = "cpu";
+    SortKey sort_key = SortKey::CPU;
     size_t selected_row = 0;
-    
-    // --- State for Process Calculations ---
-    std::vector<ProcessData> previous_processes;
-    long long prev_total_time = 0;
-    long long prev_idle_time = 0;
+    size_t cgroup_row = 0;  // Selection in the cgroup view
+    size_t sorted_rows = 0; // Length of the sorted prefix of order
+    bool show_timings = false;
+    bool tree_view = false;
+    ProcessTree tree; // Built from the latest snapshot while tree_view is on
+    int expanded_pid = 0; // Process whose threads are listed under it
+    std::vector<int> focus; // PIDs on screen, kept fresh by the sampler
+    std::vector<uint32_t> order; // The snapshot's (matching) rows, listed in this order
+    std::vector<ProcessData> filtered; // The matching rows the tree is built from while a filter is set
+    ProcessColumns filtered_columns;   // Of filtered
+    bool filter_prompt = false; // Keys go to the prompt on the bottom line
+    std::string filter_input;
+    std::string filter_error;
 
     while (true) {
-        int ch = getch(); 
+        int ch = getch();
+        bool resort = false;
+
+        // --- Filter Prompt ---
+        // Enter compiles and applies the input (empty clears the filter), Esc
+        // leaves the filter as it was. No other key acts while it is open.
+        if (filter_prompt && ch != ERR) {
+            if (ch == '\n' || ch == '\r' || ch == KEY_ENTER) {
+                if (filter.Compile(filter_input)) {
+                    filter_prompt = false;
+                    selected_row = 0;
+                    resort = true;
+                } else {
+                    filter_error = filter.Error();
+                }
+            } else if (ch == 27) {
+                filter_prompt = false;
+            } else if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
+                if (!filter_input.empty()) filter_input.pop_back();
+            } else if (ch >= 32 && ch < 127) {
+                filter_input += (char)ch;
+            }
+            ch = 0; // Handled; still redraws
+        }
         if (ch == 'q') break;
+        bool redraw = (ch != ERR);
 
         // --- Global Input Handling ---
+        if (ch == 't') show_timings = !show_timings;
         if (ch == 'v') {
-            current_view = (current_view == ViewMode::PROCESSES) ? ViewMode::PERFORMANCE : ViewMode::PROCESSES;
+            switch (current_view) {
+                case ViewMode::PROCESSES: current_view = ViewMode::PERFORMANCE; break;
+                case ViewMode::PERFORMANCE: current_view = ViewMode::CGROUPS; break;
+                case ViewMode::CGROUPS: current_view = ViewMode::PROCESSES; break;
+            }
+            if (sampler) {
+                sampler->SetCollectProcesses(current_view == ViewMode::PROCESSES);
+                sampler->SetCollectDevices(current_view == ViewMode::PERFORMANCE);
+                sampler->SetCollectCgroups(current_view == ViewMode::CGROUPS);
+            }
+        }
+        if (current_view == ViewMode::CGROUPS) {
+            if (ch == KEY_UP && cgroup_row > 0) cgroup_row--;
+            else if (ch == KEY_DOWN) cgroup_row++;
+        }
+
+        // --- Replay Transport ---
+        if (player) {
+            switch (ch) {
+                case ' ': player->TogglePause(); break;
+                case 'f': player->CycleSpeed(); break;
+                case KEY_LEFT: player->SeekBy(-10000); break;
+                case KEY_RIGHT: player->SeekBy(10000); break;
+                case KEY_HOME: player->SeekTo(0); break;
+            }
         }
 
         // --- View-Specific Input Handling ---
+        Snapshot& snapshot = player ? player->Latest() : sampler->Latest();
+        const ProcessColumns& shown = tree_view && !filter.Empty() ? filtered_columns : snapshot.columns;
         if (current_view == ViewMode::PROCESSES && ch != ERR) {
              switch (ch) {
+                case '/':
+                    filter_prompt = true;
+                    filter_input = filter.Expression();
+                    filter_error.clear();
+                    break;
+                case 'T': tree_view = !tree_view; selected_row = 0; resort = true; break;
+                case '\n':
+                case '\r':
+                case KEY_ENTER:
+                    // Threads are live only: a recording holds none.
+                    if (sampler && !tree_view && selected_row < order.size()) {
+                        int pid = shown.pid[order[selected_row]];
+                        expanded_pid = expanded_pid == pid ? 0 : pid;
+                        sampler->SetThreadsOf(expanded_pid);
+                    }
+                    break;
+                case '+': if (tree_view) tree.SetCollapsed(selected_row, false); break;
+                case '-': if (tree_view) tree.SetCollapsed(selected_row, true); break;
                 case KEY_UP: if (selected_row > 0) selected_row--; break;
                 case KEY_DOWN: selected_row++; break; // Boundary check later
-                case 'p': sort_key = "pid"; break;
-                case 'm': sort_key = "memory"; break;
-                case 'c': sort_key = "cpu"; break;
-                case 'i': sort_key = "io"; break;
+                case 'p': sort_key = SortKey::PID; resort = true; break;
+                case 'm': sort_key = SortKey::MEMORY; resort = true; break;
+                case 'c': sort_key = SortKey::CPU; resort = true; break;
+                case 'i': sort_key = SortKey::IO; resort = true; break;
                 case 'k':
-                    if (!previous_processes.empty() && selected_row < previous_processes.size()) {
-                        kill(previous_processes[selected_row].pid, SIGTERM);
+                    // Recorded PIDs may belong to anything by now.
+                    if (sampler && tree_view && selected_row < tree.Rows().size()) {
+                        kill(shown.pid[tree.Rows()[selected_row].index], SIGTERM);
+                    } else if (sampler && !tree_view && selected_row < order.size()) {
+                        kill(shown.pid[order[selected_row]], SIGTERM);
                     }
                     break;
             }
         }
 
-        // --- Data Gathering and Processing ---
-        SystemStats stats = {};
-        std::vector<ProcessData> current_processes;
-
-        // Gather system-wide stats for all views
-        long long current_total_time, current_idle_time;
-        GetSystemCpuTimes(current_total_time, current_idle_time);
-        long long total_time_delta = current_total_time - prev_total_time;
-        long long total_idle_time_delta = current_idle_time - prev_idle_time;
-        if (total_time_delta > 0) {
-            stats.cpu_percent = 100.0f * (float)(total_time_delta - total_idle_time_delta) / (float)total_time_delta;
+        // --- Snapshot Handoff ---
+        if (player ? player->Acquire() : sampler->Acquire()) {
+            redraw = true;
+            resort = true;
         }
-        GetMemoryInfo(stats.mem_total, stats.mem_free);
-        stats.mem_used = stats.mem_total - stats.mem_free;
-        if (stats.mem_total > 0) {
-            stats.mem_percent = 100.0f * (float)stats.mem_used / (float)stats.mem_total;
+        Snapshot& latest = player ? player->Latest() : sampler->Latest();
+        if (!redraw || latest.sequence == 0) continue;
+
+        // --- Processing (over the snapshot's columns) ---
+        // The list is an order of row indices into latest.columns: the
+        // filter selects the matching rows, so hidden rows are never sorted,
+        // and only the indices up to one screen past the selection are
+        // ordered; the prefix is extended when the selection moves beyond
+        // it. The snapshot itself is never reordered. The tree links rows, so
+        // under a filter it is built from a copy of the matching ones.
+        if (resort) {
+            PMON_TIME_PHASE_IF(!filter.Empty(), Phase::FILTER);
+            filter.Select(latest.columns, order);
+            if (tree_view && !filter.Empty()) {
+                filtered.clear();
+                for (uint32_t row : order) filtered.push_back(latest.processes[row]);
+                filtered_columns.Assign(filtered);
+            }
         }
-        
-        // Gather view-specific stats
-        if (current_view == ViewMode::PROCESSES) {
-            current_processes = GetAllProcesses();
-            std::map<int, ProcessData> prev_map;
-            for (const auto& p : previous_processes) prev_map[p.pid] = p;
-            for (auto& p : current_processes) {
-                if (prev_map.count(p.pid)) {
-                    // Process calculations...
-                }
+        const ProcessColumns& columns = tree_view && !filter.Empty() ? filtered_columns : latest.columns;
+        if (tree_view) {
+            if (resort) {
+                PMON_TIME_PHASE(Phase::TREE);
+                tree.Build(filter.Empty() ? latest.processes : filtered, sort_key);
+                sorted_rows = 0;
+            }
+            size_t rows = tree.Rows().size();
+            if (selected_row >= rows) selected_row = rows == 0 ? 0 : rows - 1;
+        } else {
+            if (selected_row >= order.size()) {
+                selected_row = order.empty() ? 0 : order.size() - 1;
+            }
+            size_t visible_rows = VisibleProcessRows();
+            size_t needed_rows = std::min(order.size(), std::max(selected_row + 1, visible_rows) + visible_rows);
+            if (resort || needed_rows > sorted_rows) {
+                PMON_TIME_PHASE(Phase::SORT);
+                SortTopK(columns, sort_key, needed_rows, order);
+                sorted_rows = needed_rows;
+            }
+            if (resort && latest.threads_of == expanded_pid) {
+                SortTopK(latest.threads, sort_key, latest.threads.size());
             }
-            if (sort_key == "pid") { std::sort(current_processes.begin(), current_processes.end(), [](const auto& a, const auto& b){ return a.pid < b.pid; }); }
-            else if (sort_key == "memory") { std::sort(current_processes.begin(), current_processes.end(), [](const auto& a, const auto& b){ return a.memory > b.memory; }); }
-            else if (sort_key == "cpu") { std::sort(current_processes.begin(), current_processes.end(), [](const auto& a, const auto& b){ return a.cpu_usage > b.cpu_usage; }); }
-            else if (sort_key == "io") { std::sort(current_processes.begin(), current_processes.end(), [](const auto& a, const auto& b){ return (a.io_read_rate + a.io_write_rate) > (b.io_read_rate + b.io_write_rate); }); }
-            if (selected_row >= current_processes.size()) {
-                selected_row = current_processes.empty() ? 0 : current_processes.size() - 1;
-            }
-        } else if (current_view == ViewMode::PERFORMANCE) {
-            GetDiskStats(stats.disks);
-            GetNetworkStats(stats.network);
-            GetNvidiaGpuStats(stats.gpus);
         }
+        bool show_threads = !tree_view && expanded_pid != 0 && latest.threads_of == expanded_pid;
 
-        DrawUI(current_view, stats, current_processes, sort_key, selected_row);
-        
-        if (current_view == ViewMode::PROCESSES) {
-            previous_processes = current_processes;
+        // Rows on screen (give or take the thread lines) and the expanded one.
+        if (sampler && current_view == ViewMode::PROCESSES) {
+            size_t visible_rows = VisibleProcessRows();
+            size_t first = selected_row >= visible_rows ? selected_row - visible_rows + 1 : 0;
+            size_t rows = tree_view ? tree.Rows().size() : order.size();
+            focus.clear();
+            for (size_t i = first; i < std::min(rows, first + visible_rows); ++i) {
+                focus.push_back(columns.pid[tree_view ? tree.Rows()[i].index : order[i]]);
+            }
+            if (expanded_pid != 0) focus.push_back(expanded_pid);
+            sampler->SetFocus(focus);
+        }
+
+        std::string footer;
+        if (current_view == ViewMode::PROCESSES && filter_prompt) {
+            footer = "Filter: " + filter_input + "_";
+            if (!filter_error.empty()) footer += "   (" + filter_error + ")";
+        } else if (current_view == ViewMode::PROCESSES && !filter.Empty()) {
+            footer = "Filter: " + filter.Expression() + "   [" + std::to_string(order.size()) + " of " +
+                     std::to_string(latest.processes.size()) + "]  '/' edits, empty clears";
         }
-        prev_total_time = current_total_time;
-        prev_idle_time = current_idle_time;
+
+        size_t cgroups = latest.stats.cgroups.size();
+        if (cgroup_row >= cgroups) cgroup_row = cgroups == 0 ? 0 : cgroups - 1;
+
+        PMON_TIME_PHASE(Phase::DRAW);
+        DrawUI(current_view, latest.stats, columns, order, sort_key,
+               current_view == ViewMode::CGROUPS ? cgroup_row : selected_row,
+               player ? player->Status() : std::string(), show_timings, tree_view ? &tree : nullptr,
+               show_threads ? expanded_pid : 0, show_threads ? &latest.threads : nullptr, footer);
     }
 
     endwin();
+    if (sampler) sampler->Stop();
+    recorder.Close();
+    if (recorder.Error() != 0) {
+        fprintf(stderr, "%s: %s\n", record_path.c_str(), strerror(recorder.Error()));
+        return 1;
+    }
     return 0;
 }
@@ -0,0 +1,557 @@
+#include "metrics_server.h"
+#include "name_pool.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <initializer_list>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// Requests are a request line and a few headers; anything longer is dropped.
+constexpr size_t kMaxRequestBytes = 8192;
+// Connections served at once; more wait in the listen backlog.
+constexpr size_t kMaxClients = 512;
+
+// --- Exposition format ---
+
+struct Label {
+    std::string_view key;
+    std::string_view value;
+};
+
+// Digits of an integer, for labels such as pid="42".
+class IntText {
+public:
+    explicit IntText(long long value) { len_ = std::to_chars(text_, text_ + sizeof(text_), value).ptr - text_; }
+    std::string_view View() const { return std::string_view(text_, len_); }
+
+private:
+    char text_[24];
+    size_t len_;
+};
+
+void AppendInt(std::string& out, long long value) {
+    IntText text(value);
+    out.append(text.View());
+}
+
+void AppendFloat(std::string& out, double value) {
+    char buf[48];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed, 2);
+    if (result.ec != std::errc()) {
+        out += '0';
+        return;
+    }
+    out.append(buf, result.ptr - buf);
+}
+
+// Label values escape backslash, double quote and newline.
+void AppendLabelValue(std::string& out, std::string_view text) {
+    for (char c : text) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+}
+
+void Family(std::string& out, const char* name, const char* help, const char* type = "gauge") {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void AppendName(std::string& out, const char* name, std::initializer_list<Label> labels) {
+    out += name;
+    if (labels.size() == 0) {
+        out += ' ';
+        return;
+    }
+    char separator = '{';
+    for (const Label& label : labels) {
+        out += separator;
+        out.append(label.key);
+        out += "=\"";
+        AppendLabelValue(out, label.value);
+        out += '"';
+        separator = ',';
+    }
+    out += "} ";
+}
+
+void Sample(std::string& out, const char* name, std::initializer_list<Label> labels, double value) {
+    AppendName(out, name, labels);
+    AppendFloat(out, value);
+    out += '\n';
+}
+
+void Sample(std::string& out, const char* name, std::initializer_list<Label> labels, long long value) {
+    AppendName(out, name, labels);
+    AppendInt(out, value);
+    out += '\n';
+}
+
+// --- HTTP ---
+
+bool ContainsNoCase(std::string_view text, std::string_view needle) {
+    if (needle.size() > text.size()) return false;
+    for (size_t i = 0; i + needle.size() <= text.size(); ++i) {
+        size_t j = 0;
+        while (j < needle.size() && std::tolower((unsigned char)text[i + j]) == needle[j]) ++j;
+        if (j == needle.size()) return true;
+    }
+    return false;
+}
+
+// "unix:PATH" or a path, else [HOST:]PORT with a loopback HOST.
+bool ParseAddress(const std::string& address, std::string& unix_path, bool& ipv6, int& port, std::string& error) {
+    if (address.compare(0, 5, "unix:") == 0 || address.find('/') != std::string::npos) {
+        unix_path = address.compare(0, 5, "unix:") == 0 ? address.substr(5) : address;
+        if (unix_path.empty() || unix_path.size() >= sizeof(sockaddr_un::sun_path)) {
+            error = "metrics: bad socket path: " + address;
+            return false;
+        }
+        return true;
+    }
+    std::string host = "127.0.0.1";
+    std::string port_text = address;
+    size_t colon = address.rfind(':');
+    if (colon != std::string::npos) {
+        host = address.substr(0, colon);
+        port_text = address.substr(colon + 1);
+    }
+    ipv6 = host == "[::1]" || host == "::1";
+    if (!ipv6 && host != "127.0.0.1" && host != "localhost") {
+        error = "metrics: only loopback addresses are served (127.0.0.1, localhost, [::1]), not " + host;
+        return false;
+    }
+    char* end = nullptr;
+    long value = std::strtol(port_text.c_str(), &end, 10);
+    if (port_text.empty() || *end != '\0' || value < 0 || value > 65535) {
+        error = "metrics: bad port: " + port_text;
+        return false;
+    }
+    port = (int)value;
+    return true;
+}
+
+} // namespace
+
+std::shared_ptr<const MetricsServer::Response> MetricsServer::MakeResponse(const char* status, const char* body) {
+    auto response = std::make_shared<MetricsServer::Response>();
+    response->bytes = std::string("HTTP/1.1 ") + status + "\r\nContent-Type: text/plain; charset=utf-8\r\nContent-Length: ";
+    AppendInt(response->bytes, (long long)std::strlen(body));
+    response->bytes += "\r\n\r\n";
+    response->header_bytes = response->bytes.size();
+    response->bytes += body;
+    return response;
+}
+
+MetricsServer::MetricsServer()
+    : unavailable_(MakeResponse("503 Service Unavailable", "no sample yet\n")),
+      not_found_(MakeResponse("404 Not Found", "metrics are at /metrics\n")),
+      bad_method_(MakeResponse("405 Method Not Allowed", "only GET and HEAD are served\n")) {}
+
+MetricsServer::~MetricsServer() {
+    Stop();
+}
+
+bool MetricsServer::Start(const std::string& address, std::string& error) {
+    if (thread_.joinable()) {
+        error = "metrics: already serving on " + address_;
+        return false;
+    }
+    std::string unix_path;
+    bool ipv6 = false;
+    int port = 0;
+    if (!ParseAddress(address, unix_path, ipv6, port, error)) return false;
+
+    int fd = -1;
+    if (!unix_path.empty()) {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, unix_path.c_str(), unix_path.size() + 1);
+        // A socket file nobody accepts on is left over from a previous run.
+        struct stat st;
+        if (lstat(unix_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+            int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            bool live = probe >= 0 && connect(probe, (const sockaddr*)&addr, sizeof(addr)) == 0;
+            if (probe >= 0) close(probe);
+            if (live) {
+                error = "metrics: " + unix_path + " is in use";
+                return false;
+            }
+            unlink(unix_path.c_str());
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && bind(fd, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+            error = "metrics: " + unix_path + ": " + std::strerror(errno);
+            close(fd);
+            return false;
+        }
+        address_ = "unix:" + unix_path;
+    } else {
+        fd = socket(ipv6 ? AF_INET6 : AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd >= 0) {
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            int rc;
+            if (ipv6) {
+                sockaddr_in6 addr = {};
+                addr.sin6_family = AF_INET6;
+                addr.sin6_addr = in6addr_loopback;
+                addr.sin6_port = htons((uint16_t)port);
+                rc = bind(fd, (const sockaddr*)&addr, sizeof(addr));
+            } else {
+                sockaddr_in addr = {};
+                addr.sin_family = AF_INET;
+                addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                addr.sin_port = htons((uint16_t)port);
+                rc = bind(fd, (const sockaddr*)&addr, sizeof(addr));
+            }
+            if (rc != 0) {
+                error = "metrics: " + address + ": " + std::strerror(errno);
+                close(fd);
+                return false;
+            }
+            sockaddr_storage bound = {};
+            socklen_t len = sizeof(bound);
+            getsockname(fd, (sockaddr*)&bound, &len);
+            port = ntohs(ipv6 ? ((sockaddr_in6*)&bound)->sin6_port : ((sockaddr_in*)&bound)->sin_port);
+            address_ = (ipv6 ? "[::1]:" : "127.0.0.1:") + std::to_string(port);
+        }
+        tcp_ = true;
+    }
+    if (fd < 0 || listen(fd, 128) != 0 || pipe2(wake_fds_, O_CLOEXEC | O_NONBLOCK) != 0) {
+        error = std::string("metrics: ") + std::strerror(errno);
+        if (fd >= 0) close(fd);
+        if (!unix_path.empty()) unlink(unix_path.c_str());
+        return false;
+    }
+    listen_fd_ = fd;
+    unix_path_ = unix_path;
+    thread_ = std::thread(&MetricsServer::Run, this);
+    return true;
+}
+
+void MetricsServer::Stop() {
+    if (thread_.joinable()) {
+        char byte = 0;
+        while (write(wake_fds_[1], &byte, 1) < 0 && errno == EINTR) {}
+        thread_.join();
+    }
+    for (Client& client : clients_) close(client.fd);
+    clients_.clear();
+    for (int& fd : wake_fds_) {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+    if (listen_fd_ >= 0) close(listen_fd_);
+    listen_fd_ = -1;
+    if (!unix_path_.empty()) unlink(unix_path_.c_str());
+    unix_path_.clear();
+}
+
+// --- Serving thread ---
+
+void MetricsServer::Run() {
+    std::vector<pollfd> fds;
+    while (true) {
+        // [0] wakeup, [1] listener (idle while full), then one per client.
+        fds.clear();
+        fds.push_back({wake_fds_[0], POLLIN, 0});
+        fds.push_back({clients_.size() < kMaxClients ? listen_fd_ : -1, POLLIN, 0});
+        for (const Client& client : clients_) {
+            fds.push_back({client.fd, (short)(client.response ? POLLOUT : POLLIN), 0});
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[0].revents) return;
+
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            Client& client = clients_[i];
+            short revents = fds[i + 2].revents;
+            if (!revents) continue;
+            bool keep;
+            if (client.response) {
+                keep = (revents & (POLLERR | POLLHUP)) == 0 && Send(client) &&
+                       (client.response || (!client.close_after && Answer(client)));
+            } else {
+                keep = Receive(client);
+            }
+            if (!keep) {
+                close(client.fd);
+                client.fd = -1;
+            }
+        }
+        clients_.erase(std::remove_if(clients_.begin(), clients_.end(), [](const Client& c) { return c.fd < 0; }),
+                       clients_.end());
+
+        if (fds[1].revents) {
+            while (clients_.size() < kMaxClients) {
+                int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) break; // EAGAIN, or out of descriptors until a client leaves
+                if (tcp_) {
+                    // Each response goes out in one write; don't hold its tail back.
+                    int one = 1;
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                }
+                clients_.push_back(Client{fd});
+            }
+        }
+    }
+}
+
+bool MetricsServer::Receive(Client& client) {
+    char buf[4096];
+    while (true) {
+        ssize_t n = recv(client.fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) {
+            client.request.append(buf, n);
+            if (client.request.size() > kMaxRequestBytes) return false;
+            if ((size_t)n < sizeof(buf)) break;
+        } else if (n == 0) {
+            client.eof = true; // Half-closed: still answer what was sent
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            return false;
+        }
+    }
+    return Answer(client);
+}
+
+bool MetricsServer::Answer(Client& client) {
+    while (true) {
+        size_t end = client.request.find("\r\n\r\n");
+        size_t terminator = 4;
+        if (end == std::string::npos) {
+            end = client.request.find("\n\n");
+            terminator = 2;
+        }
+        if (end == std::string::npos) return !client.eof;
+
+        // Request line: METHOD TARGET VERSION
+        std::string_view head(client.request.data(), end);
+        std::string_view line = head.substr(0, head.find_first_of("\r\n"));
+        size_t sp1 = line.find(' ');
+        size_t sp2 = sp1 == std::string_view::npos ? sp1 : line.find(' ', sp1 + 1);
+        if (sp2 == std::string_view::npos) return false;
+        std::string_view method = line.substr(0, sp1);
+        std::string_view target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+        std::string_view version = line.substr(sp2 + 1);
+        std::string_view path = target.substr(0, target.find('?'));
+
+        bool head_only = method == "HEAD";
+        std::shared_ptr<const Response> response;
+        if (method != "GET" && !head_only) {
+            response = bad_method_;
+        } else if (path == "/metrics" || path == "/") {
+            {
+                std::lock_guard<std::mutex> lock(current_mutex_);
+                response = current_;
+            }
+            if (response) scrapes_.fetch_add(1, std::memory_order_relaxed);
+            else response = unavailable_;
+        } else {
+            response = not_found_;
+        }
+        // HTTP/1.1 keeps the connection unless asked not to; 1.0 the reverse.
+        bool keep_alive = version == "HTTP/1.1" ? !ContainsNoCase(head, "connection: close")
+                                                : ContainsNoCase(head, "connection: keep-alive");
+        client.close_after = client.eof || !keep_alive;
+        client.request.erase(0, end + terminator);
+
+        client.response = std::move(response);
+        client.sent = 0;
+        client.length = head_only ? client.response->header_bytes : client.response->bytes.size();
+        if (!Send(client)) return false;
+        if (client.response) return true; // The rest when the socket drains
+        if (client.close_after) return false;
+    }
+}
+
+bool MetricsServer::Send(Client& client) {
+    const char* data = client.response->bytes.data();
+    while (client.sent < client.length) {
+        ssize_t n = send(client.fd, data + client.sent, client.length - client.sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            client.sent += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        } else {
+            return false;
+        }
+    }
+    client.response.reset();
+    return true;
+}
+
+// --- Collector thread ---
+
+void MetricsServer::Publish(const Snapshot& snapshot) {
+    RenderBody(snapshot);
+    auto response = std::make_shared<Response>();
+    response->bytes.reserve(body_.size() + 128);
+    response->bytes = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: ";
+    AppendInt(response->bytes, (long long)body_.size());
+    response->bytes += "\r\n\r\n";
+    response->header_bytes = response->bytes.size();
+    response->bytes += body_;
+
+    std::shared_ptr<const Response> previous = std::move(response);
+    {
+        std::lock_guard<std::mutex> lock(current_mutex_);
+        current_.swap(previous);
+    }
+    // The old response is freed here, or by the last scrape still sending it.
+}
+
+void MetricsServer::RenderBody(const Snapshot& snapshot) {
+    const SystemStats& stats = snapshot.stats;
+    std::string& out = body_;
+    out.clear();
+
+    Family(out, "pmon_cpu_usage_percent", "Busy share of all CPUs over the last sample interval.");
+    Sample(out, "pmon_cpu_usage_percent", {}, (double)stats.cpu_percent);
+    if (!stats.core_percent.empty()) {
+        Family(out, "pmon_cpu_core_usage_percent", "Busy share of each CPU over the last sample interval.");
+        for (size_t i = 0; i < stats.core_percent.size(); ++i) {
+            Sample(out, "pmon_cpu_core_usage_percent", {{"cpu", IntText((long long)i).View()}},
+                   (double)stats.core_percent[i]);
+        }
+    }
+    Family(out, "pmon_memory_total_bytes", "MemTotal.");
+    Sample(out, "pmon_memory_total_bytes", {}, (long long)stats.mem_total * 1024);
+    Family(out, "pmon_memory_used_bytes", "MemTotal minus MemAvailable.");
+    Sample(out, "pmon_memory_used_bytes", {}, (long long)stats.mem_used * 1024);
+
+    if (stats.cpu_pressure >= 0 || stats.memory_pressure >= 0 || stats.io_pressure >= 0) {
+        Family(out, "pmon_pressure_some_avg10_percent", "Share of the last 10 s some task stalled on the resource (PSI).");
+        const struct { const char* name; float value; } pressures[] = {
+            {"cpu", stats.cpu_pressure}, {"memory", stats.memory_pressure}, {"io", stats.io_pressure}};
+        for (const auto& pressure : pressures) {
+            if (pressure.value >= 0) {
+                Sample(out, "pmon_pressure_some_avg10_percent", {{"resource", pressure.name}}, (double)pressure.value);
+            }
+        }
+    }
+
+    if (!stats.disks.empty()) {
+        Family(out, "pmon_disk_read_bytes_per_second", "Bytes read from the disk per second.");
+        for (const DiskStats& disk : stats.disks) {
+            Sample(out, "pmon_disk_read_bytes_per_second", {{"device", disk.name}}, disk.read_rate_kb * 1024.0);
+        }
+        Family(out, "pmon_disk_write_bytes_per_second", "Bytes written to the disk per second.");
+        for (const DiskStats& disk : stats.disks) {
+            Sample(out, "pmon_disk_write_bytes_per_second", {{"device", disk.name}}, disk.write_rate_kb * 1024.0);
+        }
+    }
+    if (!stats.network.empty()) {
+        Family(out, "pmon_network_receive_bytes_per_second", "Bytes received on the interface per second.");
+        for (const NetworkStats& net : stats.network) {
+            Sample(out, "pmon_network_receive_bytes_per_second", {{"interface", net.interface_name}},
+                   net.rx_rate_kb * 1024.0);
+        }
+        Family(out, "pmon_network_transmit_bytes_per_second", "Bytes transmitted on the interface per second.");
+        for (const NetworkStats& net : stats.network) {
+            Sample(out, "pmon_network_transmit_bytes_per_second", {{"interface", net.interface_name}},
+                   net.tx_rate_kb * 1024.0);
+        }
+    }
+    if (!stats.gpus.empty()) {
+        Family(out, "pmon_gpu_utilization_percent", "GPU utilization reported by nvidia-smi.");
+        for (const GpuStats& gpu : stats.gpus) {
+            Sample(out, "pmon_gpu_utilization_percent", {{"gpu", IntText(gpu.id).View()}, {"name", gpu.name}},
+                   (long long)gpu.utilization);
+        }
+        Family(out, "pmon_gpu_memory_used_bytes", "GPU memory in use.");
+        for (const GpuStats& gpu : stats.gpus) {
+            Sample(out, "pmon_gpu_memory_used_bytes", {{"gpu", IntText(gpu.id).View()}, {"name", gpu.name}},
+                   (long long)gpu.mem_used_mb << 20);
+        }
+        Family(out, "pmon_gpu_memory_total_bytes", "GPU memory.");
+        for (const GpuStats& gpu : stats.gpus) {
+            Sample(out, "pmon_gpu_memory_total_bytes", {{"gpu", IntText(gpu.id).View()}, {"name", gpu.name}},
+                   (long long)gpu.mem_total_mb << 20);
+        }
+    }
+
+    if (snapshot.has_processes) {
+        Family(out, "pmon_processes", "Processes in the sample.");
+        Sample(out, "pmon_processes", {}, (long long)snapshot.processes.size());
+
+        top_.clear();
+        for (const ProcessData& p : snapshot.processes) top_.push_back(&p);
+        size_t count = std::min(top_processes_, top_.size());
+        std::partial_sort(top_.begin(), top_.begin() + count, top_.end(), [](const ProcessData* a, const ProcessData* b) {
+            return a->cpu_usage != b->cpu_usage ? a->cpu_usage > b->cpu_usage : a->pid < b->pid;
+        });
+        top_.resize(count);
+
+        Family(out, "pmon_process_cpu_usage_percent", "CPU of the busiest processes, as a share of all CPUs.");
+        for (const ProcessData* p : top_) {
+            Sample(out, "pmon_process_cpu_usage_percent", {{"pid", IntText(p->pid).View()}, {"name", ProcessName(p->name)}},
+                   (double)p->cpu_usage);
+        }
+        Family(out, "pmon_process_resident_memory_bytes", "Resident memory of the busiest processes.");
+        for (const ProcessData* p : top_) {
+            Sample(out, "pmon_process_resident_memory_bytes",
+                   {{"pid", IntText(p->pid).View()}, {"name", ProcessName(p->name)}}, (long long)p->memory * 1024);
+        }
+        Family(out, "pmon_process_read_bytes_per_second",
+               "Bytes the busiest processes read per second through read-like syscalls (rchar: files, "
+               "pipes and sockets, page-cache hits included).");
+        for (const ProcessData* p : top_) {
+            Sample(out, "pmon_process_read_bytes_per_second",
+                   {{"pid", IntText(p->pid).View()}, {"name", ProcessName(p->name)}}, p->io_read_rate * 1024.0);
+        }
+        Family(out, "pmon_process_write_bytes_per_second",
+               "Bytes the busiest processes wrote per second through write-like syscalls (wchar: files, "
+               "pipes and sockets, counted before any writeback).");
+        for (const ProcessData* p : top_) {
+            Sample(out, "pmon_process_write_bytes_per_second",
+                   {{"pid", IntText(p->pid).View()}, {"name", ProcessName(p->name)}}, p->io_write_rate * 1024.0);
+        }
+    }
+
+    Family(out, "pmon_sample_timestamp_seconds", "Wall-clock time the sample was taken.");
+    AppendName(out, "pmon_sample_timestamp_seconds", {});
+    AppendInt(out, snapshot.timestamp_ms / 1000);
+    char millis[5] = {'.', (char)('0' + snapshot.timestamp_ms / 100 % 10), (char)('0' + snapshot.timestamp_ms / 10 % 10),
+                      (char)('0' + snapshot.timestamp_ms % 10), '\n'};
+    out.append(millis, sizeof(millis));
+    Family(out, "pmon_samples_total", "Samples taken since start.", "counter");
+    Sample(out, "pmon_samples_total", {}, (long long)snapshot.sequence);
+    Family(out, "pmon_scrapes_total", "Scrapes answered before this sample.", "counter");
+    Sample(out, "pmon_scrapes_total", {}, (long long)Scrapes());
+}
@@ -0,0 +1,61 @@
+#include "name_pool.h"
+#include <cstring>
+
+constexpr size_t NamePool::kMaxLength;
+constexpr size_t NamePool::kBlockIds;
+constexpr size_t NamePool::kMaxBlocks;
+constexpr size_t NamePool::kChunkBytes;
+
+NamePool::NamePool() {
+    blocks_[0].reset(new const char*[kBlockIds]);
+    blocks_[0][0] = "";
+    count_.store(1, std::memory_order_release);
+    ids_.emplace(std::string_view(), 0);
+}
+
+unsigned NamePool::Intern(std::string_view text) {
+    if (text.empty() || text.size() > kMaxLength) return 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ids_.find(text);
+    if (it != ids_.end()) return it->second;
+
+    size_t id = count_.load(std::memory_order_relaxed);
+    if (id == kBlockIds * kMaxBlocks) return 0;
+    if (chunk_used_ + text.size() + 1 > kChunkBytes) {
+        chunks_.emplace_back(new char[kChunkBytes]);
+        chunk_used_ = 0;
+    }
+    char* stored = chunks_.back().get() + chunk_used_;
+    std::memcpy(stored, text.data(), text.size());
+    stored[text.size()] = '\0';
+    chunk_used_ += text.size() + 1;
+
+    if (id % kBlockIds == 0) blocks_[id / kBlockIds].reset(new const char*[kBlockIds]);
+    blocks_[id / kBlockIds][id % kBlockIds] = stored;
+    ids_.emplace(std::string_view(stored, text.size()), (unsigned)id);
+    count_.store(id + 1, std::memory_order_release);
+    return (unsigned)id;
+}
+
+size_t NamePool::Bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t blocks = (count_.load(std::memory_order_relaxed) + kBlockIds - 1) / kBlockIds;
+    return chunks_.size() * kChunkBytes + blocks * kBlockIds * sizeof(const char*);
+}
+
+namespace {
+
+NamePool& Pool() {
+    static NamePool pool;
+    return pool;
+}
+
+} // namespace
+
+unsigned InternProcessName(std::string_view name) {
+    return Pool().Intern(name);
+}
+
+const NamePool& ProcessNames() {
+    return Pool();
+}
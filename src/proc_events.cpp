@@ -0,0 +1,152 @@
+#include "proc_events.h"
+#include <cerrno>
+#include <cstring>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// How long Open() waits for the kernel to acknowledge the subscription.
+constexpr int kAckTimeoutMs = 250;
+constexpr int kReceiveBufferBytes = 4 << 20;
+
+} // namespace
+
+ProcEventListener::~ProcEventListener() {
+    Close();
+}
+
+bool ProcEventListener::Open() {
+    if (fd_ >= 0) return true;
+    fd_ = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (fd_ < 0) return false;
+
+    // A large buffer rides out fork storms between two ticks; the forced
+    // variant needs CAP_NET_ADMIN, which a successful subscription implies.
+    int rcvbuf = kReceiveBufferBytes;
+    if (setsockopt(fd_, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) != 0) {
+        setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+
+    sockaddr_nl addr = {};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = CN_IDX_PROC;
+    addr.nl_pid = 0;
+    if (bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        Close();
+        return false;
+    }
+
+    // nlmsghdr + cn_msg + the multicast op, as one datagram.
+    alignas(nlmsghdr) char request[NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_cn_mcast_op))] = {};
+    auto* header = reinterpret_cast<nlmsghdr*>(request);
+    header->nlmsg_len = sizeof(request);
+    header->nlmsg_type = NLMSG_DONE;
+    header->nlmsg_pid = 0;
+    auto* message = static_cast<cn_msg*>(NLMSG_DATA(header));
+    message->id.idx = CN_IDX_PROC;
+    message->id.val = CN_VAL_PROC;
+    message->len = sizeof(proc_cn_mcast_op);
+    proc_cn_mcast_op op = PROC_CN_MCAST_LISTEN;
+    std::memcpy(message->data, &op, sizeof(op));
+    if (send(fd_, &request, sizeof(request), 0) != (ssize_t)sizeof(request) || !WaitForAck()) {
+        Close();
+        return false;
+    }
+    lost_ = true; // Nothing is known until the first Reset()
+    return true;
+}
+
+void ProcEventListener::Close() {
+    if (fd_ >= 0) close(fd_);
+    fd_ = -1;
+    pids_.clear();
+}
+
+// The kernel answers PROC_CN_MCAST_LISTEN with a PROC_EVENT_NONE carrying
+// an errno (EPERM without CAP_NET_ADMIN), or not at all outside the initial
+// namespaces. Events that arrive first are dropped: the set is seeded by a
+// full walk right after Open() anyway.
+bool ProcEventListener::WaitForAck() {
+    alignas(nlmsghdr) char buf[4096];
+    pollfd pfd = {fd_, POLLIN, 0};
+    while (poll(&pfd, 1, kAckTimeoutMs) > 0) {
+        long len = recv(fd_, buf, sizeof(buf), 0);
+        if (len <= 0) continue;
+        for (auto* h = reinterpret_cast<nlmsghdr*>(buf); NLMSG_OK(h, (unsigned long)len);
+             h = NLMSG_NEXT(h, len)) {
+            auto* msg = static_cast<cn_msg*>(NLMSG_DATA(h));
+            if (msg->id.idx != CN_IDX_PROC || msg->id.val != CN_VAL_PROC) continue;
+            auto* ev = reinterpret_cast<proc_event*>(msg->data);
+            if (ev->what == proc_event::PROC_EVENT_NONE) return ev->event_data.ack.err == 0;
+        }
+    }
+    return false;
+}
+
+bool ProcEventListener::Poll() {
+    if (fd_ < 0) return false;
+    alignas(nlmsghdr) char buf[8192];
+    while (true) {
+        long len = recv(fd_, buf, sizeof(buf), 0);
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            if (errno == ENOBUFS) {
+                lost_ = true; // Overrun: keep draining, then ask for a rescan
+                continue;
+            }
+            break; // EAGAIN: queue drained
+        }
+        if (len == 0) break;
+        HandleMessage(buf, len);
+    }
+    return !lost_;
+}
+
+void ProcEventListener::HandleMessage(const char* buf, long len) {
+    auto* h = reinterpret_cast<const nlmsghdr*>(buf);
+    for (; NLMSG_OK(h, (unsigned long)len); h = NLMSG_NEXT(h, len)) {
+        if (h->nlmsg_type == NLMSG_ERROR || h->nlmsg_type == NLMSG_NOOP) continue;
+        auto* msg = static_cast<const cn_msg*>(NLMSG_DATA(h));
+        if (msg->id.idx != CN_IDX_PROC || msg->id.val != CN_VAL_PROC) continue;
+        auto* ev = reinterpret_cast<const proc_event*>(msg->data);
+
+        switch (ev->what) {
+            case proc_event::PROC_EVENT_FORK:
+                // Threads share the parent's tgid; only new processes count.
+                if (ev->event_data.fork.child_pid == ev->event_data.fork.child_tgid) {
+                    pids_.insert(ev->event_data.fork.child_tgid);
+                }
+                break;
+            case proc_event::PROC_EVENT_EXEC:
+                // exec() from a secondary thread makes it the thread group
+                // leader under the tgid, which is already tracked.
+                pids_.insert(ev->event_data.exec.process_tgid);
+                break;
+            case proc_event::PROC_EVENT_COMM:
+                // The name is re-read from status on the next scan anyway.
+                break;
+            case proc_event::PROC_EVENT_EXIT:
+                if (ev->event_data.exit.process_pid == ev->event_data.exit.process_tgid) {
+                    pids_.erase(ev->event_data.exit.process_tgid);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void ProcEventListener::Reset(const std::vector<int>& pids) {
+    pids_.clear();
+    pids_.insert(pids.begin(), pids.end());
+    lost_ = false;
+}
+
+void ProcEventListener::CopyPids(std::vector<int>& out) const {
+    out.assign(pids_.begin(), pids_.end());
+}
@@ -0,0 +1,485 @@
+#include "proc_scanner.h"
+#include "cgroup_stats.h"
+#include "instrumentation.h"
+#include "linux_dirent.h"
+#include "name_pool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iterator>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// Large enough for /proc/[pid]/status on current kernels (~1.5 KB).
+constexpr size_t kReadBufSize = 8192;
+constexpr size_t kDirentBufSize = 32768;
+// PIDs per unit of work handed to the pool.
+constexpr size_t kChunkSize = 256;
+// In event-driven mode, scans between two full directory walks.
+constexpr unsigned long long kEventRescanInterval = 30;
+
+thread_local char tl_read_buf[kReadBufSize];
+
+// --- Integer scanners ---
+const char* SkipSpaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    return p;
+}
+
+const char* SkipField(const char* p, const char* end) {
+    p = SkipSpaces(p, end);
+    while (p < end && *p != ' ' && *p != '\n') ++p;
+    return p;
+}
+
+// Parses an optionally signed decimal, skipping leading blanks.
+const char* ParseLong(const char* p, const char* end, long long& value) {
+    p = SkipSpaces(p, end);
+    bool negative = false;
+    if (p < end && *p == '-') {
+        negative = true;
+        ++p;
+    }
+    long long v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p - '0');
+        ++p;
+    }
+    value = negative ? -v : v;
+    return p;
+}
+
+// Returns true and the PID if `name` is all digits.
+bool ParsePidName(const char* name, int& pid) {
+    if (*name == '\0') return false;
+    int v = 0;
+    for (const char* c = name; *c; ++c) {
+        if (*c < '0' || *c > '9') return false;
+        v = v * 10 + (*c - '0');
+    }
+    pid = v;
+    return true;
+}
+
+long PageKb() {
+    static const long page_kb = std::max(1L, sysconf(_SC_PAGESIZE) / 1024);
+    return page_kb;
+}
+
+bool StartsWith(const char* p, const char* end, const char* prefix, size_t prefix_len) {
+    return (size_t)(end - p) >= prefix_len && std::memcmp(p, prefix, prefix_len) == 0;
+}
+
+// Marks a file that cannot be opened (EACCES, or absent like io without
+// task I/O accounting) so it is not retried every scan.
+constexpr int kDenied = -2;
+
+const char* const kFileNames[] = {"stat", "status", "io"};
+
+// Writes "<pid>/<file>" into `path`.
+void FormatPidPath(char* path, int pid, const char* file) {
+    char digits[16];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + pid % 10);
+        pid /= 10;
+    } while (pid > 0);
+    while (n > 0) *path++ = digits[--n];
+    *path++ = '/';
+    while (*file) *path++ = *file++;
+    *path = '\0';
+}
+
+size_t DefaultFdBudget() {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur == RLIM_INFINITY) return 3 * 1024;
+    // Leave a quarter of the limit (at least 64 fds) to the rest of the program.
+    size_t limit = rl.rlim_cur;
+    size_t reserve = std::max<size_t>(64, limit / 4);
+    return limit > reserve ? limit - reserve : 0;
+}
+
+} // namespace
+
+// --- Parsers ---
+bool ParseProcStat(const char* buf, size_t len, ProcessData& p) {
+    const char* end = buf + len;
+    // comm may contain anything, including ") ", so anchor on the last ')'.
+    const char* close_paren = nullptr;
+    for (const char* c = end; c > buf; --c) {
+        if (c[-1] == ')') {
+            close_paren = c - 1;
+            break;
+        }
+    }
+    if (!close_paren) return false;
+
+    // Fields after comm start at 3 (state) and 4 (ppid); utime and stime
+    // are 14 and 15, starttime is 22 and rss (in pages) 24.
+    const char* cur = SkipSpaces(close_paren + 1, end);
+    if (cur == end) return false;
+    p.state = *cur;
+    cur = SkipField(cur, end);
+    long long value;
+    cur = ParseLong(cur, end, value);
+    p.ppid = (int)value;
+    for (int field = 5; field < 14; ++field) cur = SkipField(cur, end);
+    cur = ParseLong(cur, end, value);
+    p.utime = (long)value;
+    cur = ParseLong(cur, end, value);
+    p.stime = (long)value;
+    for (int field = 16; field < 22; ++field) cur = SkipField(cur, end);
+    cur = ParseLong(cur, end, value);
+    p.starttime = (unsigned long long)value;
+    cur = SkipField(cur, end);
+    cur = ParseLong(cur, end, value);
+    p.memory = (long)value * PageKb();
+    return cur < end;
+}
+
+void ParseProcStatus(const char* buf, size_t len, ProcessData& p) {
+    const char* cur = buf;
+    const char* end = buf + len;
+    int remaining = 4;
+    while (cur < end && remaining > 0) {
+        const char* eol = static_cast<const char*>(std::memchr(cur, '\n', end - cur));
+        if (!eol) eol = end;
+        if (StartsWith(cur, eol, "Name:", 5)) {
+            // Interning takes a lock; a name that has not changed skips it.
+            const char* v = SkipSpaces(cur + 5, eol);
+            std::string_view name(v, eol - v);
+            if (name != ProcessName(p.name)) p.name = InternProcessName(name);
+            --remaining;
+        } else if (StartsWith(cur, eol, "State:", 6)) {
+            const char* v = SkipSpaces(cur + 6, eol);
+            p.state = v < eol ? *v : 0;
+            --remaining;
+        } else if (StartsWith(cur, eol, "PPid:", 5)) {
+            long long value;
+            ParseLong(cur + 5, eol, value);
+            p.ppid = (int)value;
+            --remaining;
+        } else if (StartsWith(cur, eol, "VmRSS:", 6)) {
+            long long value;
+            ParseLong(cur + 6, eol, value);
+            p.memory = (long)value;
+            --remaining;
+        }
+        cur = eol + 1;
+    }
+}
+
+void ParseProcIo(const char* buf, size_t len, ProcessData& p) {
+    const char* cur = buf;
+    const char* end = buf + len;
+    int remaining = 2;
+    while (cur < end && remaining > 0) {
+        const char* eol = static_cast<const char*>(std::memchr(cur, '\n', end - cur));
+        if (!eol) eol = end;
+        long long value;
+        if (StartsWith(cur, eol, "rchar:", 6)) {
+            ParseLong(cur + 6, eol, value);
+            p.read_bytes = value;
+            --remaining;
+        } else if (StartsWith(cur, eol, "wchar:", 6)) {
+            ParseLong(cur + 6, eol, value);
+            p.write_bytes = value;
+            --remaining;
+        }
+        cur = eol + 1;
+    }
+}
+
+// --- Scanner ---
+ProcScanner::ProcScanner(const std::string& proc_root, size_t fd_budget)
+    : root_fd_(open(proc_root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)),
+      fd_budget_(fd_budget ? fd_budget : DefaultFdBudget()) {}
+
+ProcScanner::~ProcScanner() {
+    for (auto& [pid, e] : table_) CloseFds(e, true);
+    if (root_fd_ >= 0) close(root_fd_);
+}
+
+void ProcScanner::SetWorkers(unsigned workers) {
+    if (workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+    if (workers == Workers()) return;
+    pool_.reset(workers > 1 ? new WorkStealingPool(workers) : nullptr);
+    worker_out_.resize(workers > 1 ? workers : 0);
+}
+
+void ProcScanner::Scan(std::vector<ProcessData>& out) {
+    out.clear();
+    if (root_fd_ < 0) return;
+    ++generation_;
+
+    {
+        PMON_TIME_PHASE_IF(phase_timing_, Phase::PROC_WALK);
+        CollectPids();
+    }
+
+    // Table and LRU bookkeeping happen here, on the calling thread, so the
+    // reads below only ever touch their own entry.
+    work_.clear();
+    for (int pid : pids_) {
+        PidEntry& e = table_[pid];
+        e.seen = generation_;
+        if (e.cached) lru_.splice(lru_.end(), lru_, e.lru_pos);
+        else AcquireCache(pid, e);
+        e.last_used = generation_;
+        work_.push_back({pid, &e});
+    }
+
+    PMON_TIME_PHASE_IF(phase_timing_, Phase::PROC_READ);
+    if (!pool_) {
+        ReadRange(0, work_.size(), out);
+    } else {
+        for (auto& buf : worker_out_) buf.clear();
+        size_t chunks = (work_.size() + kChunkSize - 1) / kChunkSize;
+        pool_->Run(chunks, [this](unsigned worker, size_t chunk) {
+            size_t begin = chunk * kChunkSize;
+            ReadRange(begin, std::min(begin + kChunkSize, work_.size()), worker_out_[worker]);
+        });
+
+        size_t total = 0;
+        for (const auto& buf : worker_out_) total += buf.size();
+        out.reserve(total);
+        for (auto& buf : worker_out_) {
+            std::move(buf.begin(), buf.end(), std::back_inserter(out));
+        }
+    }
+
+    // Reap PIDs that left the directory or whose reads returned ESRCH.
+    for (auto it = table_.begin(); it != table_.end();) {
+        if (it->second.seen != generation_) {
+            Release(it->first, it->second);
+            CloseFds(it->second, true);
+            it = table_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ProcScanner::ReadRange(size_t begin, size_t end, std::vector<ProcessData>& out) {
+    for (size_t i = begin; i < end; ++i) {
+        ProcessData p = {};
+        p.pid = work_[i].pid;
+        if (ReadProcess(p.pid, *work_[i].entry, p)) out.push_back(std::move(p));
+        else work_[i].entry->seen = 0; // Exited between the walk and the read
+    }
+    PMON_FLUSH_IO();
+}
+
+void ProcScanner::SetFocus(std::vector<int> pids) {
+    std::sort(pids.begin(), pids.end());
+    focus_ = std::move(pids);
+}
+
+bool ProcScanner::SetEventDriven(bool enabled) {
+    if (!enabled) events_.Close();
+    else events_.Open();
+    return events_.IsOpen();
+}
+
+void ProcScanner::CollectPids() {
+    if (events_.IsOpen()) {
+        // Drain before walking: anything that happens during the walk stays
+        // queued and is applied on top of the fresh set next time.
+        bool in_sync = events_.Poll();
+        if (in_sync && generation_ - last_walk_ < kEventRescanInterval) {
+            events_.CopyPids(pids_);
+            return;
+        }
+    }
+    WalkDirectory();
+    last_walk_ = generation_;
+    if (events_.IsOpen()) events_.Reset(pids_);
+}
+
+void ProcScanner::WalkDirectory() {
+    pids_.clear();
+    // Rewind so the same directory fd can be walked every tick.
+    lseek(root_fd_, 0, SEEK_SET);
+    PMON_TALLY_IO(1, 0);
+
+    alignas(LinuxDirent64) char dirent_buf[kDirentBufSize];
+    while (true) {
+        long nread = syscall(SYS_getdents64, root_fd_, dirent_buf, sizeof(dirent_buf));
+        PMON_TALLY_IO(1, nread > 0 ? nread : 0);
+        if (nread <= 0) break;
+
+        for (long off = 0; off < nread;) {
+            auto* d = reinterpret_cast<LinuxDirent64*>(dirent_buf + off);
+            off += d->d_reclen;
+
+            int pid;
+            if (d->d_type != DT_DIR && d->d_type != DT_UNKNOWN) continue;
+            if (ParsePidName(d->d_name, pid)) pids_.push_back(pid);
+        }
+    }
+}
+
+bool ProcScanner::ReadProcess(int pid, PidEntry& e, ProcessData& p) {
+    bool gone = false;
+    ssize_t len = ReadFile(pid, e, STAT, gone);
+    if (gone && e.fds[STAT] >= 0) {
+        // The cached fd belongs to a process that has exited, but the walk
+        // still listed the PID: it may have been reused. Retry with fresh fds.
+        CloseFds(e, true);
+        gone = false;
+        len = ReadFile(pid, e, STAT, gone);
+    }
+    if (gone || len <= 0 || !ParseProcStat(tl_read_buf, (size_t)len, p)) return false;
+
+    if (e.starttime != 0 && e.starttime != p.starttime) {
+        // Same PID, different process: drop whatever was opened for the old one.
+        int stat_fd = e.fds[STAT];
+        e.fds[STAT] = -1;
+        CloseFds(e, true);
+        e.fds[STAT] = stat_fd;
+        e.cgroup_read = false;
+        e.full_read = 0;
+        e.active_until = 0;
+    }
+    e.starttime = p.starttime;
+    if (has_fixed_cgroup_) {
+        e.cgroup = fixed_cgroup_;
+    } else if (!e.cgroup_read) {
+        // Moving a running process between cgroups is rare; its cgroup is
+        // read when it is first seen and kept for its lifetime.
+        e.cgroup = ReadCgroup(pid);
+        e.cgroup_read = true;
+    }
+    p.cgroup = e.cgroup;
+
+    long long cpu_ticks = (long long)p.utime + p.stime;
+    bool running = p.state == 'R' || p.state == 'D';
+    if (e.full_read != 0 && (cpu_ticks != e.cpu_ticks || running)) e.active_until = generation_ + idle_interval_;
+    e.cpu_ticks = cpu_ticks;
+    if (!NeedsFullRead(pid, e)) {
+        p.name = e.name;
+        p.read_bytes = e.read_bytes;
+        p.write_bytes = e.write_bytes;
+        p.io_carried = true;
+        return true;
+    }
+
+    p.name = e.name;
+    p.io_carried = false;
+    len = ReadFile(pid, e, STATUS, gone);
+    if (len > 0) ParseProcStatus(tl_read_buf, (size_t)len, p);
+    len = ReadFile(pid, e, IO, gone);
+    if (len > 0) ParseProcIo(tl_read_buf, (size_t)len, p);
+    if (e.full_read != 0 && (p.read_bytes != e.read_bytes || p.write_bytes != e.write_bytes)) {
+        e.active_until = generation_ + idle_interval_;
+    }
+    e.full_read = generation_;
+    e.name = p.name;
+    e.read_bytes = p.read_bytes;
+    e.write_bytes = p.write_bytes;
+    return true;
+}
+
+bool ProcScanner::NeedsFullRead(int pid, const PidEntry& e) const {
+    if (e.full_read == 0 || generation_ < e.active_until) return true;
+    if ((generation_ + (unsigned)pid) % idle_interval_ == 0) return true;
+    return !focus_.empty() && std::binary_search(focus_.begin(), focus_.end(), pid);
+}
+
+// Reads one file into the thread's buffer, through the cached fd when there
+// is one. Returns the byte count or -1; sets `gone` when the stat file says
+// the process no longer exists.
+ssize_t ProcScanner::ReadFile(int pid, PidEntry& e, FileKind kind, bool& gone) {
+    int& fd = e.fds[kind];
+    if (fd == kDenied) return -1;
+
+    int read_fd = fd;
+    if (read_fd < 0) {
+        char path[32];
+        FormatPidPath(path, pid, kFileNames[kind]);
+        read_fd = openat(root_fd_, path, O_RDONLY | O_CLOEXEC);
+        PMON_TALLY_IO(1, 0);
+        if (read_fd < 0) {
+            if (kind == STAT) gone = (errno == ENOENT || errno == ESRCH);
+            else if (errno == EACCES || errno == EPERM || errno == ENOENT) fd = kDenied;
+            return -1;
+        }
+        if (e.cached) fd = read_fd;
+    }
+
+    ssize_t len = pread(read_fd, tl_read_buf, kReadBufSize, 0);
+    int err = errno;
+    PMON_TALLY_IO(fd != read_fd ? 2 : 1, len > 0 ? len : 0);
+    if (fd != read_fd) close(read_fd);
+    if (len < 0) {
+        if (kind == STAT) {
+            gone = (err == ESRCH);
+        } else if (err == EACCES || err == EPERM) {
+            if (fd >= 0) close(fd);
+            fd = kDenied;
+        }
+    }
+    return len;
+}
+
+// Returns the interned cgroup v2 path from the "0::" line of
+// /proc/<pid>/cgroup, or 0 when there is none (cgroup v1 only, or gone).
+unsigned ProcScanner::ReadCgroup(int pid) {
+    char path[32];
+    FormatPidPath(path, pid, "cgroup");
+    int fd = openat(root_fd_, path, O_RDONLY | O_CLOEXEC);
+    PMON_TALLY_IO(1, 0);
+    if (fd < 0) return 0;
+    ssize_t len = pread(fd, tl_read_buf, kReadBufSize, 0);
+    close(fd);
+    PMON_TALLY_IO(2, len > 0 ? len : 0);
+    if (len <= 0) return 0;
+
+    const char* end = tl_read_buf + len;
+    for (const char* line = tl_read_buf; line < end;) {
+        const char* eol = std::find(line, end, '\n');
+        if (StartsWith(line, eol, "0::", 3)) return InternCgroupPath(line + 3, (size_t)(eol - line - 3));
+        line = eol + 1;
+    }
+    return 0;
+}
+
+// Gives `e` a share of the fd budget, evicting the least recently used PID
+// if needed. When every cached PID was already read this scan, `e` is left
+// uncached and read with transient fds instead of thrashing the cache.
+bool ProcScanner::AcquireCache(int pid, PidEntry& e) {
+    if (open_fds_ + FILE_KINDS > fd_budget_) {
+        if (lru_.empty()) return false;
+        auto victim = table_.find(lru_.front());
+        if (victim->second.last_used == generation_) return false;
+        Release(victim->first, victim->second);
+    }
+    e.cached = true;
+    e.lru_pos = lru_.insert(lru_.end(), pid);
+    open_fds_ += FILE_KINDS;
+    return true;
+}
+
+void ProcScanner::Release(int pid, PidEntry& e) {
+    if (!e.cached) return;
+    CloseFds(e, false);
+    lru_.erase(e.lru_pos);
+    e.cached = false;
+    open_fds_ -= FILE_KINDS;
+}
+
+void ProcScanner::CloseFds(PidEntry& e, bool forget_denied) {
+    for (int& fd : e.fds) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        } else if (forget_denied) {
+            fd = -1;
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#include "process_columns.h"
+
+void ProcessColumns::Assign(const std::vector<ProcessData>& processes) {
+    size_t n = processes.size();
+    pid.resize(n);
+    ppid.resize(n);
+    name.resize(n);
+    state.resize(n);
+    memory.resize(n);
+    cpu_usage.resize(n);
+    cpu_avg_1m.resize(n);
+    cpu_avg_5m.resize(n);
+    io_read_rate.resize(n);
+    io_write_rate.resize(n);
+    cgroup.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const ProcessData& p = processes[i];
+        pid[i] = p.pid;
+        ppid[i] = p.ppid;
+        name[i] = p.name;
+        state[i] = p.state;
+        memory[i] = p.memory;
+        cpu_usage[i] = p.cpu_usage;
+        cpu_avg_1m[i] = p.cpu_avg_1m;
+        cpu_avg_5m[i] = p.cpu_avg_5m;
+        io_read_rate[i] = p.io_read_rate;
+        io_write_rate[i] = p.io_write_rate;
+        cgroup[i] = p.cgroup;
+    }
+}
@@ -0,0 +1,369 @@
+#include "process_filter.h"
+#include "cgroup_stats.h"
+#include "name_pool.h"
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+using Field = ProcessFilter::Field;
+using Op = ProcessFilter::Op;
+using Term = ProcessFilter::Term;
+
+namespace {
+
+// --- Lexer ---
+enum class Tok { END, WORD, STRING, AND, OR, NOT, LPAREN, RPAREN, OP, BAD };
+
+struct Token {
+    Tok kind = Tok::END;
+    Op op = Op::EQ;
+    std::string text;
+    size_t column = 0; // 1-based, for error messages
+};
+
+bool IsWordChar(char c) {
+    return c != '\0' && !std::strchr(" \t&|!()=<>~\"", c);
+}
+
+class Lexer {
+public:
+    explicit Lexer(const std::string& text) : text_(text) {}
+
+    Token Next() {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t')) ++pos_;
+        Token t;
+        t.column = pos_ + 1;
+        if (pos_ >= text_.size()) return t;
+        char c = text_[pos_];
+        char next = pos_ + 1 < text_.size() ? text_[pos_ + 1] : '\0';
+        auto single = [&](Tok kind, size_t len) {
+            t.kind = kind;
+            pos_ += len;
+            return t;
+        };
+        auto op = [&](Op o, size_t len) {
+            t.op = o;
+            return single(Tok::OP, len);
+        };
+        switch (c) {
+            case '&': return single(Tok::AND, next == '&' ? 2 : 1);
+            case '|': return single(Tok::OR, next == '|' ? 2 : 1);
+            case '(': return single(Tok::LPAREN, 1);
+            case ')': return single(Tok::RPAREN, 1);
+            case '~': return op(Op::CONTAINS, 1);
+            case '=': return op(Op::EQ, next == '=' ? 2 : 1);
+            case '<': return next == '=' ? op(Op::LE, 2) : op(Op::LT, 1);
+            case '>': return next == '=' ? op(Op::GE, 2) : op(Op::GT, 1);
+            case '!':
+                if (next == '=') return op(Op::NE, 2);
+                if (next == '~') return op(Op::EXCLUDES, 2);
+                return single(Tok::NOT, 1);
+            case '"':
+                for (++pos_; pos_ < text_.size() && text_[pos_] != '"'; ++pos_) {
+                    if (text_[pos_] == '\\' && pos_ + 1 < text_.size()) ++pos_;
+                    t.text += text_[pos_];
+                }
+                if (pos_ >= text_.size()) return single(Tok::BAD, 0);
+                return single(Tok::STRING, 1);
+        }
+        while (pos_ < text_.size() && IsWordChar(text_[pos_])) t.text += text_[pos_++];
+        t.kind = Tok::WORD;
+        return t;
+    }
+
+private:
+    const std::string& text_;
+    size_t pos_ = 0;
+};
+
+// --- Parser ---
+struct FieldName {
+    const char* name;
+    Field field;
+};
+
+const FieldName kFields[] = {
+    {"pid", Field::PID},     {"ppid", Field::PPID},   {"cpu", Field::CPU},       {"cpu1m", Field::CPU_1M},
+    {"cpu5m", Field::CPU_5M}, {"mem", Field::MEM},    {"read", Field::READ},     {"write", Field::WRITE},
+    {"io", Field::IO},       {"state", Field::STATE}, {"name", Field::NAME},     {"cgroup", Field::CGROUP},
+};
+
+bool IsText(Field field) {
+    return field == Field::NAME || field == Field::CGROUP;
+}
+
+// "R", or the word in "R (running)"; 0 for anything StateName() does not
+// know.
+char ParseState(const std::string& text) {
+    for (char c : std::string_view("RSDTtXZPI")) {
+        const char* name = StateName(c);
+        if (text == std::string_view(name, 1) || text == std::string_view(name + 3, std::strlen(name) - 4)) return c;
+    }
+    return 0;
+}
+
+} // namespace
+
+// Recursive descent over the lexer's tokens, emitting the postfix program.
+class ProcessFilter::Parser {
+public:
+    Parser(const std::string& text, std::vector<Term>& terms, std::vector<Instr>& program)
+        : lexer_(text), terms_(terms), program_(program) {
+        tok_ = lexer_.Next();
+    }
+
+    bool Parse(std::string& error) {
+        if (!ParseOr()) {
+            error = error_;
+            return false;
+        }
+        if (tok_.kind != Tok::END) {
+            error = "unexpected input at column " + std::to_string(tok_.column);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool Fail(const std::string& message) {
+        error_ = message + " at column " + std::to_string(tok_.column);
+        return false;
+    }
+
+    bool ParseOr() {
+        if (!ParseAnd()) return false;
+        while (tok_.kind == Tok::OR) {
+            tok_ = lexer_.Next();
+            if (!ParseAnd()) return false;
+            program_.push_back({Instr::OR, 0});
+        }
+        return true;
+    }
+
+    bool ParseAnd() {
+        if (!ParseUnary()) return false;
+        while (tok_.kind == Tok::AND) {
+            tok_ = lexer_.Next();
+            if (!ParseUnary()) return false;
+            program_.push_back({Instr::AND, 0});
+        }
+        return true;
+    }
+
+    bool ParseUnary() {
+        if (tok_.kind == Tok::NOT) {
+            tok_ = lexer_.Next();
+            if (!ParseUnary()) return false;
+            program_.push_back({Instr::NOT, 0});
+            return true;
+        }
+        if (tok_.kind == Tok::LPAREN) {
+            tok_ = lexer_.Next();
+            if (!ParseOr()) return false;
+            if (tok_.kind != Tok::RPAREN) return Fail("expected ')'");
+            tok_ = lexer_.Next();
+            return true;
+        }
+        return ParseComparison();
+    }
+
+    bool ParseComparison() {
+        if (tok_.kind != Tok::WORD) return Fail("expected a field");
+        const FieldName* found = nullptr;
+        for (const FieldName& f : kFields) {
+            if (tok_.text == f.name) found = &f;
+        }
+        if (!found) return Fail("unknown field '" + tok_.text + "'");
+        Term term;
+        term.field = found->field;
+        tok_ = lexer_.Next();
+
+        if (tok_.kind != Tok::OP) return Fail("expected an operator");
+        term.op = tok_.op;
+        bool text_op = term.op == Op::CONTAINS || term.op == Op::EXCLUDES;
+        bool equality = term.op == Op::EQ || term.op == Op::NE;
+        if (text_op && !IsText(term.field)) return Fail("'~' needs name or cgroup");
+        if (!equality && !text_op && (IsText(term.field) || term.field == Field::STATE)) {
+            return Fail(std::string("'") + found->name + "' only compares with == != ~ !~");
+        }
+        tok_ = lexer_.Next();
+
+        if (tok_.kind != Tok::WORD && tok_.kind != Tok::STRING) return Fail("expected a value");
+        if (IsText(term.field)) {
+            term.text = tok_.text;
+        } else if (term.field == Field::STATE) {
+            term.state = ParseState(tok_.text);
+            if (!term.state) return Fail("unknown state '" + tok_.text + "'");
+        } else {
+            char* end = nullptr;
+            term.number = std::strtod(tok_.text.c_str(), &end);
+            if (tok_.text.empty() || *end != '\0') return Fail("expected a number");
+        }
+        tok_ = lexer_.Next();
+
+        program_.push_back({Instr::TERM, (int)terms_.size()});
+        terms_.push_back(std::move(term));
+        return true;
+    }
+
+    Lexer lexer_;
+    Token tok_;
+    std::string error_;
+    std::vector<Term>& terms_;
+    std::vector<Instr>& program_;
+};
+
+namespace {
+
+// --- Column evaluators ---
+template <typename Get>
+void CompareColumn(size_t n, Get get, Op op, double value, uint8_t* mask) {
+    switch (op) {
+        case Op::EQ: for (size_t i = 0; i < n; ++i) mask[i] = get(i) == value; break;
+        case Op::NE: for (size_t i = 0; i < n; ++i) mask[i] = get(i) != value; break;
+        case Op::LT: for (size_t i = 0; i < n; ++i) mask[i] = get(i) < value; break;
+        case Op::LE: for (size_t i = 0; i < n; ++i) mask[i] = get(i) <= value; break;
+        case Op::GT: for (size_t i = 0; i < n; ++i) mask[i] = get(i) > value; break;
+        case Op::GE: for (size_t i = 0; i < n; ++i) mask[i] = get(i) >= value; break;
+        default: break;
+    }
+}
+
+template <typename T>
+void CompareColumn(const std::vector<T>& column, Op op, double value, uint8_t* mask) {
+    const T* v = column.data();
+    CompareColumn(column.size(), [v](size_t i) { return (double)v[i]; }, op, value, mask);
+}
+
+void NumberColumn(const ProcessColumns& c, const Term& t, uint8_t* mask) {
+    switch (t.field) {
+        case Field::PID: CompareColumn(c.pid, t.op, t.number, mask); break;
+        case Field::PPID: CompareColumn(c.ppid, t.op, t.number, mask); break;
+        case Field::CPU: CompareColumn(c.cpu_usage, t.op, t.number, mask); break;
+        case Field::CPU_1M: CompareColumn(c.cpu_avg_1m, t.op, t.number, mask); break;
+        case Field::CPU_5M: CompareColumn(c.cpu_avg_5m, t.op, t.number, mask); break;
+        case Field::MEM: CompareColumn(c.memory, t.op, t.number, mask); break;
+        case Field::READ: CompareColumn(c.io_read_rate, t.op, t.number, mask); break;
+        case Field::WRITE: CompareColumn(c.io_write_rate, t.op, t.number, mask); break;
+        case Field::IO: {
+            const float* read = c.io_read_rate.data();
+            const float* write = c.io_write_rate.data();
+            CompareColumn(c.Size(), [read, write](size_t i) { return (double)read[i] + write[i]; }, t.op, t.number,
+                          mask);
+            break;
+        }
+        default: break;
+    }
+}
+
+// Decides each distinct id once; `text_of` is only called for new ids.
+template <typename Text>
+void TextColumn(const std::vector<unsigned>& ids, Term& t, Text text_of, uint8_t* mask) {
+    bool contains = t.op == Op::CONTAINS || t.op == Op::EXCLUDES;
+    uint8_t negate = t.op == Op::NE || t.op == Op::EXCLUDES;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        unsigned id = ids[i];
+        if (id >= t.memo.size()) t.memo.resize(id + 1 + id / 2, -1);
+        int8_t& known = t.memo[id];
+        if (known < 0) {
+            std::string_view text = text_of(id);
+            known = contains ? text.find(t.text) != std::string_view::npos : text == t.text;
+        }
+        mask[i] = (uint8_t)known ^ negate;
+    }
+}
+
+} // namespace
+
+bool ProcessFilter::Compile(const std::string& expression) {
+    if (expression.find_first_not_of(" \t") == std::string::npos) {
+        Clear();
+        return true;
+    }
+    std::vector<Term> terms;
+    std::vector<Instr> program;
+    Parser parser(expression, terms, program);
+    if (!parser.Parse(error_)) return false;
+    expression_ = expression;
+    error_.clear();
+    terms_ = std::move(terms);
+    program_ = std::move(program);
+    return true;
+}
+
+void ProcessFilter::Clear() {
+    expression_.clear();
+    error_.clear();
+    terms_.clear();
+    program_.clear();
+}
+
+void ProcessFilter::Evaluate(const ProcessColumns& columns) {
+    size_t n = columns.Size();
+    size_t depth = 0;
+    for (const Instr& instr : program_) {
+        if (instr.kind == Instr::TERM) {
+            if (masks_.size() <= depth) masks_.emplace_back();
+            std::vector<uint8_t>& mask = masks_[depth++];
+            mask.resize(n);
+            Term& t = terms_[instr.term];
+            switch (t.field) {
+                case Field::STATE: {
+                    uint8_t negate = t.op == Op::NE;
+                    const char* state = columns.state.data();
+                    for (size_t i = 0; i < n; ++i) mask[i] = (uint8_t)(state[i] == t.state) ^ negate;
+                    break;
+                }
+                case Field::NAME:
+                    TextColumn(columns.name, t, [](unsigned id) { return std::string_view(ProcessName(id)); },
+                               mask.data());
+                    break;
+                case Field::CGROUP: {
+                    std::string path;
+                    TextColumn(columns.cgroup, t,
+                               [&path](unsigned id) { return std::string_view(path = CgroupPath(id)); }, mask.data());
+                    break;
+                }
+                default:
+                    NumberColumn(columns, t, mask.data());
+                    break;
+            }
+            continue;
+        }
+        uint8_t* top = masks_[depth - 1].data();
+        if (instr.kind == Instr::NOT) {
+            for (size_t i = 0; i < n; ++i) top[i] ^= 1;
+            continue;
+        }
+        uint8_t* below = masks_[depth - 2].data();
+        if (instr.kind == Instr::AND) for (size_t i = 0; i < n; ++i) below[i] &= top[i];
+        else for (size_t i = 0; i < n; ++i) below[i] |= top[i];
+        --depth;
+    }
+}
+
+void ProcessFilter::Select(const ProcessColumns& columns, std::vector<uint32_t>& rows) {
+    size_t n = columns.Size();
+    rows.clear();
+    if (Empty()) {
+        for (size_t i = 0; i < n; ++i) rows.push_back((uint32_t)i);
+        return;
+    }
+    Evaluate(columns);
+    const uint8_t* mask = masks_[0].data();
+    for (size_t i = 0; i < n; ++i) {
+        if (mask[i]) rows.push_back((uint32_t)i);
+    }
+}
+
+void ProcessFilter::Apply(const ProcessColumns& columns, std::vector<ProcessData>& processes) {
+    if (Empty()) return;
+    Evaluate(columns);
+    const uint8_t* mask = masks_[0].data();
+    size_t kept = 0;
+    for (size_t i = 0; i < processes.size(); ++i) {
+        if (mask[i]) processes[kept++] = processes[i];
+    }
+    processes.resize(kept);
+}
@@ -1,27 +1,78 @@
 #include "process_parser.h"
-#include <algorithm>
-#include <filesystem>
+#include "proc_scanner.h"
 #include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
-#include <sstream>
-
-namespace fs = std::filesystem;
-
-// Helper function to parse a single line from /proc/[pid]/status
-std::string GetValueFromStatus(const std::string& line) {
-    size_t colon_pos = line.find(":");
-    if (colon_pos != std::string::npos) {
-        // Trim leading whitespace
-        size_t value_start = line.find_first_not_of(" \t", colon_pos + 1);
-        if (value_start != std::string::npos)
-            return line.substr(value_start);
+
+namespace {
+
+// Settings the scanner is (re)built with when the root changes.
+struct CollectorConfig {
+    std::string proc_root = "/proc";
+    unsigned threads = 1;
+    bool event_driven = false;
+    unsigned idle_interval = kDefaultIdleInterval;
+};
+
+CollectorConfig& Config() {
+    static CollectorConfig config;
+    return config;
+}
+
+std::unique_ptr<ProcScanner>& ScannerSlot() {
+    static std::unique_ptr<ProcScanner> scanner;
+    return scanner;
+}
+
+ProcScanner& Scanner() {
+    std::unique_ptr<ProcScanner>& scanner = ScannerSlot();
+    if (!scanner) {
+        const CollectorConfig& config = Config();
+        scanner = std::make_unique<ProcScanner>(config.proc_root);
+        scanner->SetWorkers(config.threads);
+        scanner->SetIdleInterval(config.idle_interval);
+        if (config.event_driven) scanner->SetEventDriven(true);
+    }
+    return *scanner;
+}
+
+} // namespace
+
+const char* StateName(char state) {
+    switch (state) {
+        case 'R': return "R (running)";
+        case 'S': return "S (sleeping)";
+        case 'D': return "D (disk sleep)";
+        case 'T': return "T (stopped)";
+        case 't': return "t (tracing stop)";
+        case 'X': return "X (dead)";
+        case 'Z': return "Z (zombie)";
+        case 'P': return "P (parked)";
+        case 'I': return "I (idle)";
+        case 0: return "";
     }
-    return "";
+    // Any other letter, as a string of its own.
+    static const struct Letters {
+        char text[256][2];
+        Letters() {
+            for (int c = 0; c < 256; ++c) text[c][0] = (char)c, text[c][1] = '\0';
+        }
+    } letters;
+    return letters.text[(unsigned char)state];
+}
+
+void SetProcRoot(const std::string& root) {
+    Config().proc_root = root;
+    ScannerSlot().reset();
+}
+
+const std::string& ProcRoot() {
+    return Config().proc_root;
 }
 
 long GetSystemUptime() {
-    std::ifstream uptime_file("/proc/uptime");
+    std::ifstream uptime_file(ProcRoot() + "/uptime");
     long uptime = 0;
     if (uptime_file.is_open()) {
         uptime_file >> uptime;
@@ -29,77 +80,35 @@ long GetSystemUptime() {
     return uptime;
 }
 
-std::vector<ProcessData> GetAllProcesses() {
-    std::vector<ProcessData> processes;
-    const std::string proc_path = "/proc";
-
-    for (const auto& entry : fs::directory_iterator(proc_path)) {
-        if (entry.is_directory()) {
-            std::string dir_name = entry.path().filename().string();
-            if (std::all_of(dir_name.begin(), dir_name.end(), ::isdigit)) {
-                ProcessData p = {}; // Initialize to zero/empty
-                p.pid = std::stoi(dir_name);
-
-                // --- Read from /proc/[pid]/status ---
-                std::ifstream status_file(entry.path().string() + "/status");
-                if (status_file.is_open()) {
-                    std::string line;
-                    while (std::getline(status_file, line)) {
-                        if (line.rfind("Name:", 0) == 0) p.name = GetValueFromStatus(line);
-                        else if (line.rfind("State:", 0) == 0) p.state = GetValueFromStatus(line);
-                        else if (line.rfind("VmRSS:", 0) == 0) p.memory = std::stol(GetValueFromStatus(line));
-                        else if (line.rfind("PPid:", 0) == 0) p.ppid = std::stoi(GetValueFromStatus(line));
-                    }
-                }
-
-                // --- Read from /proc/[pid]/stat ---
-                std::ifstream stat_file(entry.path().string() + "/stat");
-                if (stat_file.is_open()) {
-                    std::string line;
-                    std::getline(stat_file, line);
-                    std::stringstream ss(line);
-                    std::string token;
-                    for (int i = 0; i < 13; ++i) ss >> token; // Skip first 13 fields
-                    ss >> p.utime >> p.stime; // Read 14th (utime) and 15th (stime)
-                }
-
-                // --- Read from /proc/[pid]/io ---
-                std::ifstream io_file(entry.path().string() + "/io");
-                if (io_file.is_open()) {
-                    std::string line;
-                    while(std::getline(io_file, line)) {
-                        std::stringstream ss(line);
-                        std::string key;
-                        ss >> key;
-                        if (key == "rchar:") ss >> p.read_bytes;
-                        else if (key == "wchar:") ss >> p.write_bytes;
-                    }
-                }
-                processes.push_back(p);
-            }
-        }
-    }
-    return processes;
+void SetCollectorThreads(unsigned threads) {
+    Config().threads = threads;
+    Scanner().SetWorkers(threads);
+}
 
+bool SetCollectorEventDriven(bool enabled) {
+    Config().event_driven = Scanner().SetEventDriven(enabled);
+    return Config().event_driven;
+}
 
+void SetCollectorIdleInterval(unsigned samples) {
+    Config().idle_interval = samples > 0 ? samples : 1;
+    Scanner().SetIdleInterval(samples);
+}
 
+void SetCollectorFocus(const std::vector<int>& pids) {
+    Scanner().SetFocus(pids);
 }
 
-// ... existing code at the top ...
-
-// Add this entire new function at the end of the file
-void GetSystemCpuTimes(long long& total_time, long long& idle_time) {
-    std::ifstream stat_file("/proc/stat");
-    if (stat_file.is_open()) {
-        std::string line;
-        std::getline(stat_file, line);
-        std::stringstream ss(line);
-        std::string cpu_label;
-        long long user, nice, system, idle, iowait, irq, softirq, steal;
-        
-        ss >> cpu_label >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal;
-        
-        idle_time = idle + iowait;
-        total_time = user + nice + system + idle + iowait + irq + softirq + steal;
-    }
+std::vector<ProcessData> GetAllProcesses() {
+    static size_t last_count = 0;
+
+    std::vector<ProcessData> processes;
+    processes.reserve(last_count + last_count / 8);
+    Scanner().Scan(processes);
+    last_count = processes.size();
+    return processes;
+}
+
+void GetAllProcesses(std::vector<ProcessData>& processes) {
+    Scanner().Scan(processes);
 }
@@ -0,0 +1,110 @@
+#include "process_sort.h"
+#include <algorithm>
+
+namespace {
+
+// One comparator per key, picked at compile time so the sort loops inline
+// the comparison instead of branching on the key for every pair.
+template <SortKey K> struct Compare;
+
+template <> struct Compare<SortKey::PID> {
+    bool operator()(const ProcessData& a, const ProcessData& b) const { return a.pid < b.pid; }
+};
+
+template <> struct Compare<SortKey::MEMORY> {
+    bool operator()(const ProcessData& a, const ProcessData& b) const {
+        if (a.memory != b.memory) return a.memory > b.memory;
+        return a.pid < b.pid;
+    }
+};
+
+template <> struct Compare<SortKey::CPU> {
+    bool operator()(const ProcessData& a, const ProcessData& b) const {
+        if (a.cpu_usage != b.cpu_usage) return a.cpu_usage > b.cpu_usage;
+        return a.pid < b.pid;
+    }
+};
+
+template <> struct Compare<SortKey::IO> {
+    bool operator()(const ProcessData& a, const ProcessData& b) const {
+        float io_a = a.io_read_rate + a.io_write_rate;
+        float io_b = b.io_read_rate + b.io_write_rate;
+        if (io_a != io_b) return io_a > io_b;
+        return a.pid < b.pid;
+    }
+};
+
+// The same orders over row indices, reading the columns.
+template <SortKey K> struct CompareRows;
+
+template <> struct CompareRows<SortKey::PID> {
+    const ProcessColumns& c;
+    bool operator()(uint32_t a, uint32_t b) const { return c.pid[a] < c.pid[b]; }
+};
+
+template <> struct CompareRows<SortKey::MEMORY> {
+    const ProcessColumns& c;
+    bool operator()(uint32_t a, uint32_t b) const {
+        if (c.memory[a] != c.memory[b]) return c.memory[a] > c.memory[b];
+        return c.pid[a] < c.pid[b];
+    }
+};
+
+template <> struct CompareRows<SortKey::CPU> {
+    const ProcessColumns& c;
+    bool operator()(uint32_t a, uint32_t b) const {
+        if (c.cpu_usage[a] != c.cpu_usage[b]) return c.cpu_usage[a] > c.cpu_usage[b];
+        return c.pid[a] < c.pid[b];
+    }
+};
+
+template <> struct CompareRows<SortKey::IO> {
+    const ProcessColumns& c;
+    bool operator()(uint32_t a, uint32_t b) const {
+        float io_a = c.io_read_rate[a] + c.io_write_rate[a];
+        float io_b = c.io_read_rate[b] + c.io_write_rate[b];
+        if (io_a != io_b) return io_a > io_b;
+        return c.pid[a] < c.pid[b];
+    }
+};
+
+template <typename T, typename C>
+void PartialSort(std::vector<T>& items, size_t k, C compare) {
+    if (k >= items.size()) {
+        std::sort(items.begin(), items.end(), compare);
+        return;
+    }
+    auto kth = items.begin() + k;
+    std::nth_element(items.begin(), kth, items.end(), compare);
+    std::sort(items.begin(), kth, compare);
+}
+
+} // namespace
+
+const char* SortKeyName(SortKey key) {
+    switch (key) {
+        case SortKey::PID: return "pid";
+        case SortKey::MEMORY: return "memory";
+        case SortKey::CPU: return "cpu";
+        case SortKey::IO: return "io";
+    }
+    return "";
+}
+
+void SortTopK(std::vector<ProcessData>& processes, SortKey key, size_t k) {
+    switch (key) {
+        case SortKey::PID: PartialSort(processes, k, Compare<SortKey::PID>()); break;
+        case SortKey::MEMORY: PartialSort(processes, k, Compare<SortKey::MEMORY>()); break;
+        case SortKey::CPU: PartialSort(processes, k, Compare<SortKey::CPU>()); break;
+        case SortKey::IO: PartialSort(processes, k, Compare<SortKey::IO>()); break;
+    }
+}
+
+void SortTopK(const ProcessColumns& columns, SortKey key, size_t k, std::vector<uint32_t>& rows) {
+    switch (key) {
+        case SortKey::PID: PartialSort(rows, k, CompareRows<SortKey::PID>{columns}); break;
+        case SortKey::MEMORY: PartialSort(rows, k, CompareRows<SortKey::MEMORY>{columns}); break;
+        case SortKey::CPU: PartialSort(rows, k, CompareRows<SortKey::CPU>{columns}); break;
+        case SortKey::IO: PartialSort(rows, k, CompareRows<SortKey::IO>{columns}); break;
+    }
+}
@@ -0,0 +1,204 @@
+#include "process_tree.h"
+#include <algorithm>
+
+namespace {
+
+size_t HashPid(int pid) {
+    return (size_t)pid * 0x9E3779B97F4A7C15ull;
+}
+
+// Orders siblings by their subtree totals, largest first; ties by PID.
+template <SortKey K> struct CompareRollup;
+
+template <> struct CompareRollup<SortKey::PID> {
+    const std::vector<ProcessTree::Rollup>& rollups;
+    bool operator()(int a, int b) const { return rollups[a].pid < rollups[b].pid; }
+};
+
+template <> struct CompareRollup<SortKey::MEMORY> {
+    const std::vector<ProcessTree::Rollup>& rollups;
+    bool operator()(int a, int b) const {
+        if (rollups[a].memory != rollups[b].memory) return rollups[a].memory > rollups[b].memory;
+        return rollups[a].pid < rollups[b].pid;
+    }
+};
+
+template <> struct CompareRollup<SortKey::CPU> {
+    const std::vector<ProcessTree::Rollup>& rollups;
+    bool operator()(int a, int b) const {
+        if (rollups[a].cpu_usage != rollups[b].cpu_usage) return rollups[a].cpu_usage > rollups[b].cpu_usage;
+        return rollups[a].pid < rollups[b].pid;
+    }
+};
+
+template <> struct CompareRollup<SortKey::IO> {
+    const std::vector<ProcessTree::Rollup>& rollups;
+    bool operator()(int a, int b) const {
+        float io_a = rollups[a].io_read_rate + rollups[a].io_write_rate;
+        float io_b = rollups[b].io_read_rate + rollups[b].io_write_rate;
+        if (io_a != io_b) return io_a > io_b;
+        return rollups[a].pid < rollups[b].pid;
+    }
+};
+
+template <SortKey K>
+void SortGroups(const std::vector<ProcessTree::Rollup>& rollups, const std::vector<int>& child_begin,
+                std::vector<int>& children) {
+    CompareRollup<K> compare{rollups};
+    for (size_t group = 0; group + 1 < child_begin.size(); ++group) {
+        int begin = child_begin[group], end = child_begin[group + 1];
+        if (end - begin > 1) std::sort(children.begin() + begin, children.begin() + end, compare);
+    }
+}
+
+// Fills `child_begin` and `children` from `parent` by counting sort. Group
+// i < n holds the children of node i; group n holds the roots.
+void Link(const std::vector<int>& parent, std::vector<int>& child_begin, std::vector<int>& children) {
+    size_t n = parent.size();
+    child_begin.assign(n + 2, 0);
+    for (size_t i = 0; i < n; ++i) ++child_begin[(parent[i] < 0 ? n : (size_t)parent[i]) + 1];
+    for (size_t g = 1; g < n + 2; ++g) child_begin[g] += child_begin[g - 1];
+    children.resize(n);
+    // child_begin[g + 1] is now the end of group g. Placing nodes back to
+    // front moves it down to the group's start, keeping index order within
+    // each group; then every entry is shifted down by one.
+    for (size_t i = n; i-- > 0;) {
+        size_t group = parent[i] < 0 ? n : (size_t)parent[i];
+        children[--child_begin[group + 1]] = (int)i;
+    }
+    for (size_t g = 0; g < n + 1; ++g) child_begin[g] = child_begin[g + 1];
+    child_begin[n + 1] = (int)n;
+}
+
+} // namespace
+
+int ProcessTree::Find(int pid) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t i = HashPid(pid) & mask;; i = (i + 1) & mask) {
+        const Slot& slot = slots_[i];
+        if (slot.index < 0 || slot.pid == pid) return slot.index;
+    }
+}
+
+void ProcessTree::Build(const std::vector<ProcessData>& processes, SortKey key) {
+    processes_ = &processes;
+    size_t n = processes.size();
+
+    // --- pid -> index ---
+    size_t capacity = 16;
+    while (capacity < 2 * n) capacity <<= 1;
+    slots_.assign(capacity, Slot{0, -1});
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i < n; ++i) {
+        int pid = processes[i].pid;
+        size_t s = HashPid(pid) & mask;
+        while (slots_[s].index >= 0 && slots_[s].pid != pid) s = (s + 1) & mask;
+        if (slots_[s].index < 0) slots_[s] = {pid, (int)i}; // A duplicate PID keeps the first entry
+    }
+
+    // --- Links, own values and breadth-first order ---
+    parent_.resize(n);
+    rollups_.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const ProcessData& p = processes[i];
+        parent_[i] = p.ppid == p.pid ? -1 : Find(p.ppid);
+        Rollup& r = rollups_[i];
+        r.pid = p.pid;
+        r.cpu_usage = p.cpu_usage;
+        r.memory = p.memory;
+        r.io_read_rate = p.io_read_rate;
+        r.io_write_rate = p.io_write_rate;
+        r.descendants = 0;
+    }
+    while (true) {
+        Link(parent_, child_begin_, children_);
+        order_.reserve(n);
+        order_.assign(children_.begin() + child_begin_[n], children_.end());
+        for (size_t head = 0; head < order_.size(); ++head) {
+            int node = order_[head];
+            order_.insert(order_.end(), children_.begin() + child_begin_[node],
+                          children_.begin() + child_begin_[node + 1]);
+        }
+        if (order_.size() == n) break;
+
+        // Some nodes are unreachable from any root: their ppids form a loop,
+        // which only a PID reused mid-scan can produce. Cut each loop once.
+        std::vector<int> mark(n, -1);
+        for (int node : order_) mark[node] = (int)n;
+        for (size_t start = 0; start < n; ++start) {
+            int node = (int)start;
+            while (mark[node] == -1) {
+                mark[node] = (int)start;
+                node = parent_[node];
+            }
+            if (mark[node] == (int)start) parent_[node] = -1;
+        }
+    }
+
+    // --- Subtree totals: children come after parents in order_ ---
+    for (size_t k = n; k-- > 0;) {
+        int node = order_[k];
+        int parent = parent_[node];
+        if (parent < 0) continue;
+        const Rollup& r = rollups_[node];
+        Rollup& up = rollups_[parent];
+        up.cpu_usage += r.cpu_usage;
+        up.memory += r.memory;
+        up.io_read_rate += r.io_read_rate;
+        up.io_write_rate += r.io_write_rate;
+        up.descendants += 1 + r.descendants;
+    }
+
+    SortSiblings(key);
+
+    // Forget collapsed subtrees whose process has gone.
+    for (auto it = collapsed_.begin(); it != collapsed_.end();) {
+        int index = Find(it->first);
+        if (index < 0 || processes[index].starttime != it->second) it = collapsed_.erase(it);
+        else ++it;
+    }
+    Flatten();
+}
+
+void ProcessTree::SortSiblings(SortKey key) {
+    switch (key) {
+        case SortKey::PID: SortGroups<SortKey::PID>(rollups_, child_begin_, children_); break;
+        case SortKey::MEMORY: SortGroups<SortKey::MEMORY>(rollups_, child_begin_, children_); break;
+        case SortKey::CPU: SortGroups<SortKey::CPU>(rollups_, child_begin_, children_); break;
+        case SortKey::IO: SortGroups<SortKey::IO>(rollups_, child_begin_, children_); break;
+    }
+}
+
+// Depth-first, pre-order, skipping what is under a collapsed node.
+void ProcessTree::Flatten() {
+    const std::vector<ProcessData>& processes = *processes_;
+    size_t n = processes.size();
+    rows_.clear();
+    stack_.clear();
+    for (int k = child_begin_[n + 1]; k-- > child_begin_[n];) stack_.push_back({children_[k], 0});
+    while (!stack_.empty()) {
+        auto [node, depth] = stack_.back();
+        stack_.pop_back();
+        int begin = child_begin_[node], end = child_begin_[node + 1];
+        bool has_children = end > begin;
+        bool collapsed = has_children && !collapsed_.empty() &&
+            collapsed_.count({processes[node].pid, processes[node].starttime}) != 0;
+        rows_.push_back({node, depth, has_children, collapsed});
+        if (collapsed) continue;
+        for (int k = end; k-- > begin;) stack_.push_back({children_[k], depth + 1});
+    }
+}
+
+bool ProcessTree::SetCollapsed(size_t row, bool collapsed) {
+    if (row >= rows_.size() || !rows_[row].has_children) return false;
+    const ProcessData& p = (*processes_)[rows_[row].index];
+    if (collapsed) collapsed_.insert({p.pid, p.starttime});
+    else collapsed_.erase({p.pid, p.starttime});
+    Flatten();
+    return true;
+}
+
+bool ProcessTree::Toggle(size_t row) {
+    if (row >= rows_.size()) return false;
+    return SetCollapsed(row, !rows_[row].collapsed);
+}
@@ -0,0 +1,100 @@
+#include "rate_engine.h"
+#include <algorithm>
+
+size_t RateEngine::Hash(unsigned long long id, unsigned long long generation) {
+    unsigned long long h = id * 0x9e3779b97f4a7c15ULL ^ generation;
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 32;
+    return (size_t)h;
+}
+
+const RateEngine::Slot* RateEngine::Find(unsigned long long id, unsigned long long generation) const {
+    if (prev_.empty()) return nullptr;
+    size_t mask = prev_.size() - 1;
+    for (size_t i = Hash(id, generation) & mask;; i = (i + 1) & mask) {
+        const Slot& s = prev_[i];
+        if (s.id == 0) return nullptr;
+        if (s.id == id && s.generation == generation) return &s;
+    }
+}
+
+void RateEngine::Insert(const Slot& slot) {
+    size_t mask = cur_.size() - 1;
+    size_t i = Hash(slot.id, slot.generation) & mask;
+    while (cur_[i].id != 0) i = (i + 1) & mask;
+    cur_[i] = slot;
+}
+
+// Empties the table being filled, growing it to keep the load factor <= 1/2.
+void RateEngine::Reset(size_t item_count) {
+    size_t capacity = std::max<size_t>(cur_.size(), 64);
+    while (capacity < item_count * 2) capacity *= 2;
+    if (capacity != cur_.size()) cur_.assign(capacity, Slot{});
+    else std::fill(cur_.begin(), cur_.end(), Slot{});
+}
+
+void RateEngine::Begin(size_t items, long long system_total) {
+    now_ = std::chrono::steady_clock::now();
+    system_total_ = system_total;
+    system_delta_ = system_total - prev_system_total_;
+    Reset(items);
+}
+
+RateEngine::Rates RateEngine::Next(unsigned long long id, unsigned long long generation, const Counters& counters) {
+    Rates rates;
+    Slot slot = {id, generation, counters, now_, 0.0f, 0.0f};
+    const Slot* prev = has_prev_ ? Find(id, generation) : nullptr;
+    if (prev) {
+        long long cpu_delta = counters.cpu - prev->counters.cpu;
+        if (system_delta_ > 0 && cpu_delta > 0) {
+            rates.cpu_percent = 100.0f * (float)cpu_delta / (float)system_delta_;
+        }
+        if (counters.io_carried) {
+            // Nothing new is known: keep the counters, their time and the
+            // rates of the last read until the next one.
+            slot.counters.read_bytes = prev->counters.read_bytes;
+            slot.counters.write_bytes = prev->counters.write_bytes;
+            slot.io_time = prev->io_time;
+            slot.read_kb = prev->read_kb;
+            slot.write_kb = prev->write_kb;
+        } else {
+            // Everything since the last read, however many samples ago.
+            double seconds = std::chrono::duration<double>(now_ - prev->io_time).count();
+            long long read_delta = counters.read_bytes - prev->counters.read_bytes;
+            long long write_delta = counters.write_bytes - prev->counters.write_bytes;
+            if (seconds > 0.0) {
+                if (read_delta > 0) slot.read_kb = (float)(read_delta / 1024.0 / seconds);
+                if (write_delta > 0) slot.write_kb = (float)(write_delta / 1024.0 / seconds);
+            }
+        }
+        rates.read_kb = slot.read_kb;
+        rates.write_kb = slot.write_kb;
+    }
+    slot.counters.io_carried = false;
+    Insert(slot);
+    return rates;
+}
+
+void RateEngine::End() {
+    prev_.swap(cur_);
+    prev_system_total_ = system_total_;
+    has_prev_ = true;
+}
+
+void RateEngine::Update(std::vector<ProcessData>& processes, long long system_total_time) {
+    Begin(processes.size(), system_total_time);
+    for (auto& p : processes) {
+        p.cpu_usage = 0.0f;
+        p.io_read_rate = 0.0f;
+        p.io_write_rate = 0.0f;
+        if (p.pid == 0) continue;
+
+        Rates rates = Next((unsigned)p.pid, p.starttime,
+                           {(long long)p.utime + p.stime, p.read_bytes, p.write_bytes, p.io_carried});
+        p.cpu_usage = rates.cpu_percent;
+        p.io_read_rate = rates.read_kb;
+        p.io_write_rate = rates.write_kb;
+    }
+    End();
+}
@@ -0,0 +1,732 @@
+#include "recording.h"
+#include "name_pool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kFileMagic[8] = {'P', 'M', 'O', 'N', 'R', 'E', 'C', '1'};
+constexpr char kSegmentMagic[4] = {'S', 'E', 'G', 'M'};
+constexpr char kIndexMagic[8] = {'P', 'M', 'O', 'N', 'I', 'D', 'X', '1'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kFileHeaderBytes = 32;
+constexpr size_t kSegmentHeaderBytes = 32;
+constexpr size_t kIndexEntryBytes = 32;
+constexpr size_t kTrailerBytes = 24;
+
+// A segment is closed after this many frames or payload bytes, whichever
+// comes first. Seeking decodes at most one segment, so this bounds its cost;
+// each segment starts with a self-contained (larger) frame.
+constexpr uint32_t kSegmentFrames = 32;
+constexpr uint64_t kSegmentBytes = 8 << 20;
+
+constexpr uint8_t kHasProcesses = 1;
+constexpr uint8_t kHasDevices = 2;
+
+// --- Encoding helpers ---
+template <typename T>
+void Put(std::vector<char>& buf, T value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    buf.insert(buf.end(), bytes, bytes + sizeof(value));
+}
+
+void PutVarint(std::vector<char>& buf, uint64_t value) {
+    while (value >= 0x80) {
+        buf.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    buf.push_back((char)value);
+}
+
+void PutZigzag(std::vector<char>& buf, int64_t value) {
+    PutVarint(buf, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+void PutFloatXor(std::vector<char>& buf, float value, float reference) {
+    uint32_t a, b;
+    std::memcpy(&a, &value, sizeof(a));
+    std::memcpy(&b, &reference, sizeof(b));
+    PutVarint(buf, a ^ b);
+}
+
+void PutShortString(std::vector<char>& buf, const std::string& text) {
+    uint8_t len = (uint8_t)std::min<size_t>(text.size(), 255);
+    Put(buf, len);
+    buf.insert(buf.end(), text.data(), text.data() + len);
+}
+
+// 0 when `text` equals `reference`, else len + 1 and the bytes.
+void PutChangedString(std::vector<char>& buf, std::string_view text, std::string_view reference) {
+    if (text == reference) {
+        PutVarint(buf, 0);
+        return;
+    }
+    PutVarint(buf, text.size() + 1);
+    buf.insert(buf.end(), text.begin(), text.end());
+}
+
+// --- Decoding helpers (bounds-checked; `p` only advances on success) ---
+template <typename T>
+bool Get(const char*& p, const char* end, T& value) {
+    if ((size_t)(end - p) < sizeof(value)) return false;
+    std::memcpy(&value, p, sizeof(value));
+    p += sizeof(value);
+    return true;
+}
+
+bool GetVarint(const char*& p, const char* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = (uint8_t)*p++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool GetZigzag(const char*& p, const char* end, int64_t& value) {
+    uint64_t raw;
+    if (!GetVarint(p, end, raw)) return false;
+    value = (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1);
+    return true;
+}
+
+bool GetFloatXor(const char*& p, const char* end, float reference, float& value) {
+    uint64_t x;
+    if (!GetVarint(p, end, x)) return false;
+    uint32_t bits;
+    std::memcpy(&bits, &reference, sizeof(bits));
+    bits ^= (uint32_t)x;
+    std::memcpy(&value, &bits, sizeof(value));
+    return true;
+}
+
+bool GetShortString(const char*& p, const char* end, std::string& text) {
+    uint8_t len;
+    if (!Get(p, end, len) || end - p < len) return false;
+    text.assign(p, len);
+    p += len;
+    return true;
+}
+
+// Sets `changed` and `text` (a view into the frame) unless the string is
+// the reference's.
+bool GetChangedString(const char*& p, const char* end, bool& changed, std::string_view& text) {
+    uint64_t len;
+    if (!GetVarint(p, end, len)) return false;
+    changed = len != 0;
+    if (!changed) return true;
+    if ((uint64_t)(end - p) < len - 1) return false;
+    text = std::string_view(p, len - 1);
+    p += len - 1;
+    return true;
+}
+
+// Index into `reference` of the row for each PID of `rows`, or -1. Both are
+// in ascending PID order.
+template <typename GetPid>
+void MatchPids(const std::vector<ProcessData>& reference, size_t rows, GetPid pid_of, std::vector<int32_t>& refs) {
+    refs.resize(rows);
+    size_t j = 0;
+    for (size_t i = 0; i < rows; ++i) {
+        int pid = pid_of(i);
+        while (j < reference.size() && reference[j].pid < pid) ++j;
+        refs[i] = (j < reference.size() && reference[j].pid == pid) ? (int32_t)j : -1;
+    }
+}
+
+// Equal in every recorded column but pid and starttime.
+bool SameRow(const ProcessData& a, const ProcessData& b) {
+    return a.ppid == b.ppid && a.memory == b.memory && a.utime == b.utime && a.stime == b.stime &&
+           a.read_bytes == b.read_bytes && a.write_bytes == b.write_bytes &&
+           std::memcmp(&a.cpu_usage, &b.cpu_usage, sizeof(float)) == 0 &&
+           std::memcmp(&a.io_read_rate, &b.io_read_rate, sizeof(float)) == 0 &&
+           std::memcmp(&a.io_write_rate, &b.io_write_rate, sizeof(float)) == 0 &&
+           a.name == b.name && a.state == b.state;
+}
+
+const ProcessData& EmptyRow() {
+    static const ProcessData empty = {};
+    return empty;
+}
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;
+    int64_t interval_ms;
+    int64_t created_ms;
+};
+static_assert(sizeof(FileHeader) == kFileHeaderBytes, "file header layout");
+
+struct SegmentHeader {
+    char magic[4];
+    uint32_t frames;
+    uint64_t payload_bytes;
+    int64_t first_ms;
+    int64_t last_ms;
+};
+static_assert(sizeof(SegmentHeader) == kSegmentHeaderBytes, "segment header layout");
+
+struct IndexEntry {
+    int64_t first_ms;
+    int64_t last_ms;
+    uint64_t offset;
+    uint32_t frames;
+    uint32_t reserved;
+};
+static_assert(sizeof(IndexEntry) == kIndexEntryBytes, "index entry layout");
+
+// Reads the segment index of a mapped recording: from the trailing index if
+// the recorder closed cleanly, else by walking the segment headers. `end` is
+// where the next segment would go.
+bool LoadIndex(const char* data, size_t size, std::chrono::milliseconds& interval,
+               std::vector<RecordingSegment>& segments, bool& recovered, uint64_t& end,
+               std::string& error) {
+    FileHeader header;
+    if (size < kFileHeaderBytes) {
+        error = "not a recording (too short)";
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0) {
+        error = "not a recording";
+        return false;
+    }
+    if (header.version != kVersion || header.header_bytes < kFileHeaderBytes) {
+        error = "unsupported recording version";
+        return false;
+    }
+    interval = std::chrono::milliseconds(header.interval_ms > 0 ? header.interval_ms : 1000);
+    segments.clear();
+
+    uint64_t index_offset = 0, count = 0;
+    if (size >= header.header_bytes + kTrailerBytes &&
+        std::memcmp(data + size - sizeof(kIndexMagic), kIndexMagic, sizeof(kIndexMagic)) == 0) {
+        std::memcpy(&index_offset, data + size - kTrailerBytes, sizeof(index_offset));
+        std::memcpy(&count, data + size - kTrailerBytes + 8, sizeof(count));
+    }
+    if (index_offset >= header.header_bytes && count <= size / kIndexEntryBytes &&
+        index_offset + count * kIndexEntryBytes + kTrailerBytes == size) {
+        recovered = false;
+        end = index_offset;
+        for (uint64_t i = 0; i < count; ++i) {
+            IndexEntry entry;
+            std::memcpy(&entry, data + index_offset + i * kIndexEntryBytes, sizeof(entry));
+            if (entry.offset + kSegmentHeaderBytes > index_offset || entry.frames == 0) break;
+            segments.push_back({entry.first_ms, entry.last_ms, entry.offset, entry.frames});
+        }
+    } else {
+        recovered = true;
+        uint64_t offset = header.header_bytes;
+        while (offset + kSegmentHeaderBytes <= size) {
+            SegmentHeader segment;
+            std::memcpy(&segment, data + offset, sizeof(segment));
+            if (std::memcmp(segment.magic, kSegmentMagic, sizeof(kSegmentMagic)) != 0 || segment.frames == 0 ||
+                segment.payload_bytes > size - offset - kSegmentHeaderBytes) {
+                break;
+            }
+            segments.push_back({segment.first_ms, segment.last_ms, offset, segment.frames});
+            offset += kSegmentHeaderBytes + segment.payload_bytes;
+        }
+        end = offset;
+    }
+
+    unsigned long long frames = 0;
+    for (RecordingSegment& segment : segments) {
+        segment.first_frame = frames;
+        frames += segment.frames;
+    }
+    return true;
+}
+
+} // namespace
+
+// --- RecordingWriter ---
+RecordingWriter::~RecordingWriter() {
+    Close();
+}
+
+bool RecordingWriter::Open(const std::string& path, std::chrono::milliseconds interval, std::string& error) {
+    Close();
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    struct stat st;
+    if (fd_ < 0 || fstat(fd_, &st) != 0) {
+        error = path + ": " + std::strerror(errno);
+        Close();
+        return false;
+    }
+
+    index_.clear();
+    segment_open_ = false;
+    error_ = 0;
+    if (st.st_size == 0) {
+        FileHeader header = {};
+        std::memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+        header.version = kVersion;
+        header.header_bytes = kFileHeaderBytes;
+        header.interval_ms = interval.count();
+        header.created_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        file_bytes_ = 0;
+        if (!WriteAt(&header, sizeof(header), 0)) {
+            error = path + ": " + std::strerror(error_);
+            Close();
+            return false;
+        }
+        file_bytes_ = sizeof(header);
+        return true;
+    }
+
+    // Continue an existing recording: drop its index (or torn tail) and
+    // append new segments after the last complete one.
+    void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (map == MAP_FAILED) {
+        error = path + ": " + std::strerror(errno);
+        Close();
+        return false;
+    }
+    std::chrono::milliseconds existing_interval;
+    bool recovered = false;
+    uint64_t end = 0;
+    bool ok = LoadIndex(static_cast<const char*>(map), (size_t)st.st_size, existing_interval, index_, recovered, end, error);
+    munmap(map, (size_t)st.st_size);
+    if (!ok) {
+        error = path + ": " + error;
+        Close();
+        return false;
+    }
+    if (ftruncate(fd_, (off_t)end) != 0) {
+        error = path + ": " + std::strerror(errno);
+        Close();
+        return false;
+    }
+    file_bytes_ = end;
+    return true;
+}
+
+bool RecordingWriter::WriteAt(const void* data, size_t size, uint64_t offset) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = pwrite(fd_, p, size, (off_t)offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            error_ = errno;
+            return false;
+        }
+        p += n;
+        offset += (uint64_t)n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+bool RecordingWriter::Append(const Snapshot& snapshot) {
+    if (fd_ < 0 || error_ != 0) return false;
+
+    // Timestamps only move forward so the index stays sorted, even if the
+    // wall clock is stepped back.
+    long long timestamp = snapshot.timestamp_ms;
+    if (!index_.empty() && timestamp < index_.back().last_ms) timestamp = index_.back().last_ms;
+
+    bool new_segment = !segment_open_ || index_.back().frames >= kSegmentFrames || segment_bytes_ >= kSegmentBytes;
+    if (new_segment) {
+        RecordingSegment segment = {timestamp, timestamp, file_bytes_, 0};
+        if (!index_.empty()) segment.first_frame = index_.back().first_frame + index_.back().frames;
+        index_.push_back(segment);
+        segment_bytes_ = 0;
+        segment_open_ = true;
+        reference_.clear();
+    }
+
+    // buf_ = segment header, then the frame.
+    buf_.assign(kSegmentHeaderBytes, 0);
+    Put<uint32_t>(buf_, 0);
+    Put<int64_t>(buf_, timestamp);
+    EncodeFrame(snapshot);
+    uint32_t frame_bytes = (uint32_t)(buf_.size() - kSegmentHeaderBytes - sizeof(uint32_t));
+    std::memcpy(buf_.data() + kSegmentHeaderBytes, &frame_bytes, sizeof(frame_bytes));
+
+    RecordingSegment& segment = index_.back();
+    uint64_t frame_offset = segment.offset + kSegmentHeaderBytes + segment_bytes_;
+    segment.frames++;
+    segment.last_ms = timestamp;
+    segment_bytes_ += buf_.size() - kSegmentHeaderBytes;
+
+    SegmentHeader header;
+    std::memcpy(header.magic, kSegmentMagic, sizeof(kSegmentMagic));
+    header.frames = segment.frames;
+    header.payload_bytes = segment_bytes_;
+    header.first_ms = segment.first_ms;
+    header.last_ms = segment.last_ms;
+    std::memcpy(buf_.data(), &header, sizeof(header));
+
+    // The frame lands before the header that counts it.
+    bool ok = new_segment
+        ? WriteAt(buf_.data(), buf_.size(), segment.offset)
+        : WriteAt(buf_.data() + kSegmentHeaderBytes, buf_.size() - kSegmentHeaderBytes, frame_offset) &&
+          WriteAt(&header, sizeof(header), segment.offset);
+    if (!ok) return false;
+    file_bytes_ = segment.offset + kSegmentHeaderBytes + segment_bytes_;
+    return true;
+}
+
+void RecordingWriter::EncodeFrame(const Snapshot& snapshot) {
+    const SystemStats& stats = snapshot.stats;
+    uint8_t flags = (snapshot.has_processes ? kHasProcesses : 0) | (snapshot.has_devices ? kHasDevices : 0);
+    Put(buf_, flags);
+    Put(buf_, stats.cpu_percent);
+    Put(buf_, stats.mem_percent);
+    Put<int64_t>(buf_, stats.mem_total);
+    Put<int64_t>(buf_, stats.mem_free);
+    Put<int64_t>(buf_, stats.mem_used);
+
+    if (snapshot.has_devices) {
+        Put<uint16_t>(buf_, (uint16_t)std::min<size_t>(stats.disks.size(), 0xffff));
+        Put<uint16_t>(buf_, (uint16_t)std::min<size_t>(stats.network.size(), 0xffff));
+        Put<uint16_t>(buf_, (uint16_t)std::min<size_t>(stats.gpus.size(), 0xffff));
+        for (size_t i = 0; i < stats.disks.size() && i < 0xffff; ++i) {
+            PutShortString(buf_, stats.disks[i].name);
+            Put(buf_, stats.disks[i].read_rate_kb);
+            Put(buf_, stats.disks[i].write_rate_kb);
+        }
+        for (size_t i = 0; i < stats.network.size() && i < 0xffff; ++i) {
+            PutShortString(buf_, stats.network[i].interface_name);
+            Put(buf_, stats.network[i].rx_rate_kb);
+            Put(buf_, stats.network[i].tx_rate_kb);
+        }
+        for (size_t i = 0; i < stats.gpus.size() && i < 0xffff; ++i) {
+            const GpuStats& gpu = stats.gpus[i];
+            Put<int32_t>(buf_, gpu.id);
+            Put<int32_t>(buf_, gpu.utilization);
+            Put<int32_t>(buf_, gpu.mem_used_mb);
+            Put<int32_t>(buf_, gpu.mem_total_mb);
+            PutShortString(buf_, gpu.name);
+        }
+    }
+
+    // A frame without processes leaves the reference as it is.
+    if (snapshot.has_processes) EncodeProcesses(snapshot.processes);
+}
+
+void RecordingWriter::EncodeProcesses(const std::vector<ProcessData>& processes) {
+    size_t n = processes.size();
+    order_.resize(n);
+    for (size_t i = 0; i < n; ++i) order_[i] = &processes[i];
+    std::sort(order_.begin(), order_.end(), [](const ProcessData* a, const ProcessData* b) { return a->pid < b->pid; });
+
+    PutVarint(buf_, n);
+    int prev_pid = 0;
+    for (const ProcessData* p : order_) {
+        PutVarint(buf_, (uint64_t)(p->pid - prev_pid));
+        prev_pid = p->pid;
+    }
+
+    // starttime decides whether the PID's previous row is the same process.
+    MatchPids(reference_, n, [this](size_t i) { return order_[i]->pid; }, refs_);
+    for (size_t i = 0; i < n; ++i) {
+        unsigned long long ref = refs_[i] >= 0 ? reference_[refs_[i]].starttime : 0;
+        PutZigzag(buf_, (int64_t)(order_[i]->starttime - ref));
+        if (refs_[i] >= 0 && reference_[refs_[i]].starttime != order_[i]->starttime) refs_[i] = -1;
+    }
+
+    auto ref = [this](size_t i) -> const ProcessData& { return refs_[i] >= 0 ? reference_[refs_[i]] : EmptyRow(); };
+
+    // Rows identical to their reference (idle processes) are one bit in
+    // this bitmap; the remaining columns only carry the other rows.
+    changed_.clear();
+    size_t bitmap = buf_.size();
+    buf_.resize(bitmap + (n + 7) / 8, 0);
+    for (size_t i = 0; i < n; ++i) {
+        if (SameRow(*order_[i], ref(i)) && refs_[i] >= 0) buf_[bitmap + i / 8] |= (char)(1 << (i % 8));
+        else changed_.push_back((uint32_t)i);
+    }
+    for (uint32_t i : changed_) PutZigzag(buf_, (int64_t)order_[i]->ppid - ref(i).ppid);
+    for (uint32_t i : changed_) PutZigzag(buf_, (int64_t)order_[i]->memory - ref(i).memory);
+    for (uint32_t i : changed_) PutZigzag(buf_, (int64_t)order_[i]->utime - ref(i).utime);
+    for (uint32_t i : changed_) PutZigzag(buf_, (int64_t)order_[i]->stime - ref(i).stime);
+    for (uint32_t i : changed_) PutZigzag(buf_, order_[i]->read_bytes - ref(i).read_bytes);
+    for (uint32_t i : changed_) PutZigzag(buf_, order_[i]->write_bytes - ref(i).write_bytes);
+    for (uint32_t i : changed_) PutFloatXor(buf_, order_[i]->cpu_usage, ref(i).cpu_usage);
+    for (uint32_t i : changed_) PutFloatXor(buf_, order_[i]->io_read_rate, ref(i).io_read_rate);
+    for (uint32_t i : changed_) PutFloatXor(buf_, order_[i]->io_write_rate, ref(i).io_write_rate);
+    // Names and states are written out as text, as they were before
+    // ProcessData interned them.
+    for (uint32_t i : changed_) PutChangedString(buf_, ProcessName(order_[i]->name), ProcessName(ref(i).name));
+    for (uint32_t i : changed_) PutChangedString(buf_, StateName(order_[i]->state), StateName(ref(i).state));
+
+    rows_.resize(n);
+    for (size_t i = 0; i < n; ++i) rows_[i] = *order_[i];
+    reference_.swap(rows_);
+}
+
+void RecordingWriter::Close() {
+    if (fd_ < 0) return;
+    if (error_ == 0 && !index_.empty()) {
+        buf_.clear();
+        for (const RecordingSegment& segment : index_) {
+            IndexEntry entry = {segment.first_ms, segment.last_ms, segment.offset, segment.frames, 0};
+            Put(buf_, entry);
+        }
+        Put<uint64_t>(buf_, file_bytes_);
+        Put<uint64_t>(buf_, index_.size());
+        buf_.insert(buf_.end(), kIndexMagic, kIndexMagic + sizeof(kIndexMagic));
+        WriteAt(buf_.data(), buf_.size(), file_bytes_);
+    }
+    close(fd_);
+    fd_ = -1;
+    segment_open_ = false;
+}
+
+// --- RecordingReader ---
+RecordingReader::~RecordingReader() {
+    if (data_) munmap(const_cast<char*>(data_), size_);
+}
+
+bool RecordingReader::Open(const std::string& path, std::string& error) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        error = path + ": " + std::strerror(errno);
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    size_ = (size_t)st.st_size;
+    void* map = size_ > 0 ? mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) {
+        error = path + ": " + (size_ > 0 ? std::strerror(errno) : "empty file");
+        return false;
+    }
+    data_ = static_cast<const char*>(map);
+
+    uint64_t end = 0;
+    if (!LoadIndex(data_, size_, interval_, segments_, recovered_, end, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    if (segments_.empty()) {
+        error = path + ": recording has no frames";
+        return false;
+    }
+    return true;
+}
+
+unsigned long long RecordingReader::Frames() const {
+    return segments_.empty() ? 0 : segments_.back().first_frame + segments_.back().frames;
+}
+
+size_t RecordingReader::FindSegment(long long timestamp_ms) const {
+    auto it = std::upper_bound(segments_.begin(), segments_.end(), timestamp_ms,
+                               [](long long t, const RecordingSegment& s) { return t < s.first_ms; });
+    return it == segments_.begin() ? 0 : (size_t)(it - segments_.begin() - 1);
+}
+
+// --- RecordingCursor ---
+void RecordingCursor::Restart(size_t segment) {
+    const auto& segments = reader_.Segments();
+    segment_ = std::min(segment, segments.size());
+    frame_ = 0;
+    reference_.clear();
+    if (segment_ < segments.size()) {
+        offset_ = segments[segment_].offset + kSegmentHeaderBytes;
+        position_ = segments[segment_].first_frame;
+    } else {
+        position_ = reader_.Frames();
+    }
+}
+
+long long RecordingCursor::PeekTimestamp() const {
+    const auto& segments = reader_.Segments();
+    if (segment_ >= segments.size()) return -1;
+    if (frame_ < segments[segment_].frames) {
+        int64_t timestamp;
+        std::memcpy(&timestamp, reader_.Data() + offset_ + sizeof(uint32_t), sizeof(timestamp));
+        return timestamp;
+    }
+    return segment_ + 1 < segments.size() ? segments[segment_ + 1].first_ms : -1;
+}
+
+bool RecordingCursor::Next(Snapshot& snapshot) {
+    if (!Decode(snapshot)) return false;
+    CopyProcesses(snapshot);
+    return true;
+}
+
+bool RecordingCursor::Seek(long long timestamp_ms, Snapshot& snapshot) {
+    Restart(reader_.FindSegment(timestamp_ms));
+    if (!Decode(snapshot)) return false;
+    // Frames in between only update the reference rows.
+    long long next = PeekTimestamp();
+    while (next >= 0 && next <= timestamp_ms && Decode(snapshot)) next = PeekTimestamp();
+    CopyProcesses(snapshot);
+    return true;
+}
+
+void RecordingCursor::CopyProcesses(Snapshot& snapshot) const {
+    if (snapshot.has_processes) snapshot.processes = reference_;
+    else snapshot.processes.clear();
+}
+
+bool RecordingCursor::Decode(Snapshot& snapshot) {
+    const auto& segments = reader_.Segments();
+    if (segment_ < segments.size() && frame_ >= segments[segment_].frames) Restart(segment_ + 1);
+    if (segment_ >= segments.size()) return false;
+
+    const char* p = reader_.Data() + offset_;
+    const char* segment_end = reader_.Data() + segments[segment_].offset + kSegmentHeaderBytes;
+    {
+        SegmentHeader header;
+        std::memcpy(&header, reader_.Data() + segments[segment_].offset, sizeof(header));
+        segment_end += header.payload_bytes;
+    }
+    uint32_t frame_bytes;
+    if (!Get(p, segment_end, frame_bytes) || (size_t)(segment_end - p) < frame_bytes) return false;
+    const char* end = p + frame_bytes;
+
+    SystemStats& stats = snapshot.stats;
+    stats = {};
+    int64_t timestamp, mem_total, mem_free, mem_used;
+    uint8_t flags;
+    if (!Get(p, end, timestamp) || !Get(p, end, flags) || !Get(p, end, stats.cpu_percent) ||
+        !Get(p, end, stats.mem_percent) || !Get(p, end, mem_total) || !Get(p, end, mem_free) ||
+        !Get(p, end, mem_used)) {
+        return false;
+    }
+    stats.mem_total = mem_total;
+    stats.mem_free = mem_free;
+    stats.mem_used = mem_used;
+
+    snapshot.has_devices = flags & kHasDevices;
+    if (snapshot.has_devices) {
+        uint16_t disks, interfaces, gpus;
+        if (!Get(p, end, disks) || !Get(p, end, interfaces) || !Get(p, end, gpus)) return false;
+        stats.disks.resize(disks);
+        for (DiskStats& disk : stats.disks) {
+            if (!GetShortString(p, end, disk.name) || !Get(p, end, disk.read_rate_kb) ||
+                !Get(p, end, disk.write_rate_kb)) {
+                return false;
+            }
+        }
+        stats.network.resize(interfaces);
+        for (NetworkStats& net : stats.network) {
+            if (!GetShortString(p, end, net.interface_name) || !Get(p, end, net.rx_rate_kb) ||
+                !Get(p, end, net.tx_rate_kb)) {
+                return false;
+            }
+        }
+        stats.gpus.resize(gpus);
+        for (GpuStats& gpu : stats.gpus) {
+            int32_t id, utilization, used, total;
+            if (!Get(p, end, id) || !Get(p, end, utilization) || !Get(p, end, used) || !Get(p, end, total) ||
+                !GetShortString(p, end, gpu.name)) {
+                return false;
+            }
+            gpu.id = id;
+            gpu.utilization = utilization;
+            gpu.mem_used_mb = used;
+            gpu.mem_total_mb = total;
+        }
+    }
+
+    snapshot.has_processes = flags & kHasProcesses;
+    if (snapshot.has_processes && !DecodeProcesses(p, end)) return false;
+
+    offset_ = (uint64_t)(end - reader_.Data());
+    ++frame_;
+    ++position_;
+    snapshot.sequence = position_;
+    snapshot.timestamp_ms = timestamp;
+    return true;
+}
+
+bool RecordingCursor::DecodeProcesses(const char*& p, const char* end) {
+    uint64_t n;
+    if (!GetVarint(p, end, n) || n > (uint64_t)(end - p)) return false;
+    rows_.resize(n);
+
+    uint64_t pid = 0;
+    for (ProcessData& row : rows_) {
+        uint64_t delta;
+        if (!GetVarint(p, end, delta)) return false;
+        pid += delta;
+        row.pid = (int)pid;
+        row.cpu_avg_1m = row.cpu_avg_5m = 0.0f; // Not recorded; the history store fills them
+    }
+
+    MatchPids(reference_, n, [this](size_t i) { return rows_[i].pid; }, refs_);
+    for (size_t i = 0; i < n; ++i) {
+        int64_t delta;
+        if (!GetZigzag(p, end, delta)) return false;
+        unsigned long long ref = refs_[i] >= 0 ? reference_[refs_[i]].starttime : 0;
+        rows_[i].starttime = ref + (unsigned long long)delta;
+        if (refs_[i] >= 0 && reference_[refs_[i]].starttime != rows_[i].starttime) refs_[i] = -1;
+    }
+
+    auto ref = [this](size_t i) -> const ProcessData& { return refs_[i] >= 0 ? reference_[refs_[i]] : EmptyRow(); };
+
+    size_t bitmap_bytes = (n + 7) / 8;
+    if ((size_t)(end - p) < bitmap_bytes) return false;
+    changed_.clear();
+    for (size_t i = 0; i < n; ++i) {
+        if ((p[i / 8] >> (i % 8)) & 1) {
+            if (refs_[i] < 0) return false;
+            rows_[i] = reference_[refs_[i]];
+        } else {
+            changed_.push_back((uint32_t)i);
+        }
+    }
+    p += bitmap_bytes;
+    int64_t delta;
+    for (uint32_t i : changed_) {
+        if (!GetZigzag(p, end, delta)) return false;
+        rows_[i].ppid = (int)(ref(i).ppid + delta);
+    }
+    for (uint32_t i : changed_) {
+        if (!GetZigzag(p, end, delta)) return false;
+        rows_[i].memory = (long)(ref(i).memory + delta);
+    }
+    for (uint32_t i : changed_) {
+        if (!GetZigzag(p, end, delta)) return false;
+        rows_[i].utime = (long)(ref(i).utime + delta);
+    }
+    for (uint32_t i : changed_) {
+        if (!GetZigzag(p, end, delta)) return false;
+        rows_[i].stime = (long)(ref(i).stime + delta);
+    }
+    for (uint32_t i : changed_) {
+        if (!GetZigzag(p, end, delta)) return false;
+        rows_[i].read_bytes = ref(i).read_bytes + delta;
+    }
+    for (uint32_t i : changed_) {
+        if (!GetZigzag(p, end, delta)) return false;
+        rows_[i].write_bytes = ref(i).write_bytes + delta;
+    }
+    for (uint32_t i : changed_) {
+        if (!GetFloatXor(p, end, ref(i).cpu_usage, rows_[i].cpu_usage)) return false;
+    }
+    for (uint32_t i : changed_) {
+        if (!GetFloatXor(p, end, ref(i).io_read_rate, rows_[i].io_read_rate)) return false;
+    }
+    for (uint32_t i : changed_) {
+        if (!GetFloatXor(p, end, ref(i).io_write_rate, rows_[i].io_write_rate)) return false;
+    }
+    bool changed;
+    std::string_view text;
+    for (uint32_t i : changed_) {
+        if (!GetChangedString(p, end, changed, text)) return false;
+        rows_[i].name = changed ? InternProcessName(text) : ref(i).name;
+    }
+    for (uint32_t i : changed_) {
+        if (!GetChangedString(p, end, changed, text)) return false;
+        rows_[i].state = !changed ? ref(i).state : text.empty() ? 0 : text[0];
+    }
+
+    reference_.swap(rows_);
+    return true;
+}
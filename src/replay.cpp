@@ -0,0 +1,83 @@
+#include "replay.h"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+namespace {
+
+constexpr int kMaxSpeed = 64;
+
+} // namespace
+
+ReplayPlayer::ReplayPlayer(size_t history_bytes) : history_bytes_(history_bytes) {}
+
+bool ReplayPlayer::Open(const std::string& path, std::string& error) {
+    if (!reader_.Open(path, error)) return false;
+    clock_ms_ = reader_.FirstTimestamp();
+    seek_pending_ = true;
+    last_tick_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool ReplayPlayer::Acquire() {
+    auto now = std::chrono::steady_clock::now();
+    if (!paused_) {
+        clock_ms_ += std::chrono::duration_cast<std::chrono::milliseconds>(now - last_tick_).count() * speed_;
+    }
+    last_tick_ = now;
+    if (clock_ms_ >= reader_.LastTimestamp()) {
+        clock_ms_ = reader_.LastTimestamp();
+        paused_ = true;
+    }
+
+    // Jumps go through the time index; anything past the next segment is
+    // a seek instead of decoding every frame in between.
+    bool changed = false;
+    if (seek_pending_ || reader_.FindSegment(clock_ms_) > cursor_.Segment() + 1) {
+        seek_pending_ = false;
+        // Averages and sparklines start over after a jump.
+        if (history_bytes_ > 0) history_ = std::make_unique<HistoryStore>(reader_.Interval(), history_bytes_);
+        if (!cursor_.Seek(clock_ms_, frame_)) return false;
+        if (history_) history_->Record(frame_);
+        changed = true;
+    }
+
+    long long next = cursor_.PeekTimestamp();
+    while (next >= 0 && next <= clock_ms_) {
+        if (!cursor_.Next(frame_)) break;
+        if (history_) history_->Record(frame_);
+        changed = true;
+        next = cursor_.PeekTimestamp();
+    }
+    if (changed) frame_.columns.Assign(frame_.processes);
+    return changed;
+}
+
+void ReplayPlayer::TogglePause() {
+    paused_ = !paused_;
+    if (!paused_ && clock_ms_ >= reader_.LastTimestamp()) SeekTo(reader_.FirstTimestamp());
+}
+
+void ReplayPlayer::SeekBy(long long delta_ms) {
+    SeekTo(clock_ms_ + delta_ms);
+}
+
+void ReplayPlayer::SeekTo(long long timestamp_ms) {
+    clock_ms_ = std::max(reader_.FirstTimestamp(), std::min(timestamp_ms, reader_.LastTimestamp()));
+    seek_pending_ = true;
+}
+
+void ReplayPlayer::CycleSpeed() {
+    speed_ = speed_ >= kMaxSpeed ? 1 : speed_ * 2;
+}
+
+std::string ReplayPlayer::Status() const {
+    char when[32] = "";
+    time_t seconds = (time_t)(frame_.timestamp_ms / 1000);
+    struct tm tm;
+    if (localtime_r(&seconds, &tm)) strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+    char line[160];
+    snprintf(line, sizeof(line), "REPLAY %s  frame %llu/%llu  %dx%s | Space:Pause 'f':Speed Left/Right:-/+10s",
+             when, cursor_.Position(), reader_.Frames(), speed_, paused_ ? " (paused)" : "");
+    return line;
+}
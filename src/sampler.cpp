@@ -0,0 +1,183 @@
+#include "sampler.h"
+#include "instrumentation.h"
+#include "metrics_server.h"
+#include "recording.h"
+
+Sampler::Sampler(std::chrono::milliseconds interval, size_t history_bytes) : interval_(interval) {
+    if (history_bytes > 0) collector_.EnableHistory(interval, history_bytes);
+}
+
+Sampler::~Sampler() {
+    Stop();
+}
+
+void Sampler::Start() {
+    if (thread_.joinable()) return;
+    stop_ = false;
+    thread_ = std::thread(&Sampler::Run, this);
+}
+
+void Sampler::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_cv_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+void Sampler::SetCollectProcesses(bool enabled) {
+    if (collect_processes_.exchange(enabled) != enabled) RequestSample();
+}
+
+void Sampler::SetCollectDevices(bool enabled) {
+    if (collect_devices_.exchange(enabled) != enabled) RequestSample();
+}
+
+void Sampler::SetCollectCgroups(bool enabled) {
+    if (collect_cgroups_.exchange(enabled) != enabled) RequestSample();
+}
+
+void Sampler::SetThreadsOf(int pid) {
+    if (threads_of_.exchange(pid) != pid) RequestSample();
+}
+
+void Sampler::SetFocus(std::vector<int> pids) {
+    std::lock_guard<std::mutex> lock(focus_mutex_);
+    if (pids == focus_) return;
+    focus_ = std::move(pids);
+    focus_changed_ = true;
+}
+
+void Sampler::RequestSample() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wake_ = true;
+    }
+    wake_cv_.notify_one();
+}
+
+void Sampler::Run() {
+    auto next_tick = std::chrono::steady_clock::now();
+    while (true) {
+        bool all = collector_.Recording() || collector_.Publishing();
+        collector_.SetThreadsOf(threads_of_.load());
+        {
+            std::lock_guard<std::mutex> lock(focus_mutex_);
+            if (focus_changed_) collector_.SetFocus(focus_);
+            focus_changed_ = false;
+        }
+        collector_.Collect(buffer_.Back(), all || collect_processes_.load(), all || collect_devices_.load(),
+                           collect_cgroups_.load());
+        buffer_.Publish();
+
+        // Fixed cadence: the next tick is scheduled from the previous one,
+        // not from when collection finished.
+        next_tick += interval_;
+        auto now = std::chrono::steady_clock::now();
+        if (next_tick < now) next_tick = now;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_cv_.wait_until(lock, next_tick, [this] { return stop_ || wake_; });
+        if (stop_) return;
+        if (wake_) next_tick = std::chrono::steady_clock::now();
+        wake_ = false;
+    }
+}
+
+void SnapshotCollector::Collect(Snapshot& snapshot, bool processes, bool devices, bool cgroups) {
+    {
+        PMON_TIME_PHASE(Phase::TICK);
+        CollectTick(snapshot, processes, devices, cgroups);
+    }
+    PMON_END_TICK();
+}
+
+void SnapshotCollector::CollectTick(Snapshot& snapshot, bool processes, bool devices, bool cgroups) {
+    SystemStats& stats = snapshot.stats;
+    stats = {};
+
+    // Gather system-wide stats for all views
+    long long current_total_time = 0, current_idle_time = 0;
+    {
+        PMON_TIME_PHASE(Phase::SYSTEM);
+        system_.CollectCpu(stats, current_total_time, current_idle_time);
+        system_.CollectMemory(stats);
+        system_.CollectPressure(stats);
+    }
+
+    // Gather the stats the active view needs
+    snapshot.has_processes = processes;
+    if (processes) {
+        GetAllProcesses(snapshot.processes);
+        PMON_TIME_PHASE(Phase::RATES);
+        rates_.Update(snapshot.processes, current_total_time);
+    } else {
+        snapshot.processes.clear();
+    }
+    if (processes && threads_of_ != 0) {
+        PMON_TIME_PHASE(Phase::THREADS);
+        unsigned cgroup = 0;
+        for (const ProcessData& p : snapshot.processes) {
+            if (p.pid == threads_of_) {
+                cgroup = p.cgroup;
+                break;
+            }
+        }
+        tasks_.Follow(threads_of_, cgroup);
+        tasks_.Scan(snapshot.threads, current_total_time);
+        snapshot.threads_of = threads_of_;
+    } else {
+        tasks_.Stop();
+        snapshot.threads.clear();
+        snapshot.threads_of = 0;
+    }
+    snapshot.has_devices = devices;
+    if (devices) {
+        {
+            PMON_TIME_PHASE(Phase::DISKS);
+            system_.CollectDisks(stats.disks);
+        }
+        {
+            PMON_TIME_PHASE(Phase::NETWORK);
+            system_.CollectNetwork(stats.network);
+        }
+        PMON_TIME_PHASE(Phase::GPU);
+        GetNvidiaGpuStats(stats.gpus);
+    }
+    snapshot.has_cgroups = cgroups;
+    if (cgroups) {
+        PMON_TIME_PHASE(Phase::CGROUPS);
+        cgroups_.Collect(stats.cgroups, current_total_time);
+    }
+    snapshot.sequence = ++sequence_;
+    snapshot.timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // Raw samples only: the history is rebuilt when the recording is replayed.
+    if (recorder_) {
+        PMON_TIME_PHASE(Phase::RECORD);
+        recorder_->Append(snapshot);
+    }
+
+    if (history_) {
+        PMON_TIME_PHASE(Phase::HISTORY);
+        history_->Record(snapshot);
+    }
+
+    // After the history, which fills the averages in.
+    {
+        PMON_TIME_PHASE_IF(processes, Phase::COLUMNS);
+        snapshot.columns.Assign(snapshot.processes);
+    }
+
+    // Last, so a scrape only ever sees a finished sample.
+    if (metrics_) {
+        PMON_TIME_PHASE(Phase::METRICS);
+        metrics_->Publish(snapshot);
+    }
+}
+
+void SnapshotCollector::EnableHistory(std::chrono::milliseconds interval, size_t memory_cap_bytes) {
+    history_ = std::make_unique<HistoryStore>(interval, memory_cap_bytes);
+}
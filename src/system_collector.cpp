@@ -0,0 +1,302 @@
+#include "system_collector.h"
+#include "instrumentation.h"
+#include "process_parser.h"
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string_view>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+// /proc/stat is the largest file read: a line per CPU, then an "intr" line
+// with a counter per IRQ. The buffer doubles whenever a read fills it.
+constexpr size_t kInitialReadBufSize = 64 * 1024;
+constexpr size_t kMaxReadBufSize = 4 * 1024 * 1024;
+
+constexpr const char* kFileNames[] = {
+    "/stat", "/meminfo", "/diskstats", "/net/dev", "/pressure/cpu", "/pressure/memory", "/pressure/io",
+};
+
+const char* SkipSpaces(const char* p) {
+    while (*p == ' ' || *p == '\t') ++p;
+    return p;
+}
+
+const char* NextLine(const char* p) {
+    const char* end = std::strchr(p, '\n');
+    return end ? end + 1 : p + std::strlen(p);
+}
+
+unsigned long long ParseCounter(const char*& p) {
+    char* end;
+    unsigned long long value = std::strtoull(p, &end, 10);
+    p = end;
+    return value;
+}
+
+// Growth of a counter from `prev` to `cur`. Going backwards from the top
+// quarter of the 32-bit range to its bottom quarter is a 32-bit counter
+// wrapping; any other step back is a reset, after which nothing is known.
+unsigned long long CounterDelta(unsigned long long prev, unsigned long long cur) {
+    if (cur >= prev) return cur - prev;
+    if (prev > 0xc0000000ULL && prev <= 0xffffffffULL && cur < 0x40000000ULL) return cur + (1ULL << 32) - prev;
+    return 0;
+}
+
+// Busy share of the jiffies between two samples. Deltas are signed: iowait
+// is known to step backwards on tickless kernels.
+float BusyPercent(unsigned long long total, unsigned long long idle, unsigned long long prev_total,
+                  unsigned long long prev_idle) {
+    long long total_delta = (long long)(total - prev_total);
+    long long idle_delta = (long long)(idle - prev_idle);
+    if (total_delta <= 0) return 0.0f;
+    long long busy = total_delta - idle_delta;
+    if (busy < 0) busy = 0;
+    if (busy > total_delta) busy = total_delta;
+    return 100.0f * (float)busy / (float)total_delta;
+}
+
+// A partition of `disk` is named after it plus its number, with a 'p'
+// between them when the disk name ends in a digit (sda1, nvme0n1p1).
+bool IsPartitionOf(std::string_view name, std::string_view disk) {
+    if (disk.empty() || name.size() <= disk.size() || name.compare(0, disk.size(), disk) != 0) return false;
+    std::string_view rest = name.substr(disk.size());
+    if (disk.back() >= '0' && disk.back() <= '9') {
+        if (rest[0] != 'p') return false;
+        rest.remove_prefix(1);
+    }
+    if (rest.empty()) return false;
+    for (char c : rest) {
+        if (c < '0' || c > '9') return false;
+    }
+    return true;
+}
+
+bool StartsWith(std::string_view text, std::string_view prefix) {
+    return text.compare(0, prefix.size(), prefix) == 0;
+}
+
+float PressureAvg10(const char* buf) {
+    const char* some = std::strstr(buf, "some avg10=");
+    return some ? std::strtof(some + 11, nullptr) : -1.0f;
+}
+
+} // namespace
+
+SystemCollector::~SystemCollector() {
+    for (int fd : fds_) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+void SystemCollector::Reopen() {
+    for (int& fd : fds_) {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+    root_ = ProcRoot();
+    for (int i = 0; i < FILE_COUNT; ++i) {
+        fds_[i] = open((root_ + kFileNames[i]).c_str(), O_RDONLY | O_CLOEXEC);
+        PMON_TALLY_IO(1, 0);
+    }
+    if (buf_.empty()) buf_.resize(kInitialReadBufSize);
+    opened_ = true;
+}
+
+long SystemCollector::Read(File file) {
+    if (!opened_ || root_ != ProcRoot()) Reopen();
+    int fd = fds_[file];
+    if (fd < 0) return -1;
+    for (;;) {
+        ssize_t len = pread(fd, buf_.data(), buf_.size() - 1, 0);
+        PMON_TALLY_IO(1, len > 0 ? len : 0);
+        if (len < 0) return -1;
+        if ((size_t)len == buf_.size() - 1 && buf_.size() < kMaxReadBufSize) {
+            buf_.resize(buf_.size() * 2);
+            continue;
+        }
+        buf_[len] = '\0';
+        read_time_ = std::chrono::steady_clock::now();
+        return (long)len;
+    }
+}
+
+// --- CPU ---
+
+void SystemCollector::CollectCpu(SystemStats& stats, long long& total_time, long long& idle_time) {
+    stats.cpu_percent = 0.0f;
+    stats.core_percent.clear();
+    if (Read(STAT) < 0) return;
+
+    CpuTimes total = {0, 0};
+    cores_.clear();
+    for (const char* p = buf_.data(); std::strncmp(p, "cpu", 3) == 0; p = NextLine(p)) {
+        p += 3;
+        bool aggregate = *p == ' ';
+        size_t core = aggregate ? 0 : (size_t)ParseCounter(p);
+        // user nice system idle iowait irq softirq steal; guest time is
+        // already counted in user.
+        unsigned long long fields[8] = {};
+        for (unsigned long long& field : fields) field = ParseCounter(p);
+        CpuTimes times;
+        times.idle = fields[3] + fields[4];
+        times.total = 0;
+        for (unsigned long long field : fields) times.total += field;
+        if (aggregate) {
+            total = times;
+        } else if (core < 65536) {
+            // Offline CPUs have no line; their slot stays zero.
+            if (core >= cores_.size()) cores_.resize(core + 1, CpuTimes{0, 0});
+            cores_[core] = times;
+        }
+    }
+
+    stats.cpu_percent = BusyPercent(total.total, total.idle, total_prev_.total, total_prev_.idle);
+    stats.core_percent.resize(cores_.size());
+    for (size_t i = 0; i < cores_.size(); ++i) {
+        CpuTimes prev = i < cores_prev_.size() ? cores_prev_[i] : CpuTimes{0, 0};
+        stats.core_percent[i] = BusyPercent(cores_[i].total, cores_[i].idle, prev.total, prev.idle);
+    }
+    total_prev_ = total;
+    cores_prev_.swap(cores_);
+    total_time = (long long)total.total;
+    idle_time = (long long)total.idle;
+}
+
+// --- Memory and pressure ---
+
+void SystemCollector::CollectMemory(SystemStats& stats) {
+    if (Read(MEMINFO) < 0) return;
+    const char* total = std::strstr(buf_.data(), "MemTotal:");
+    if (total) stats.mem_total = std::strtol(total + 9, nullptr, 10);
+    // MemAvailable is a more realistic "free" than MemFree.
+    const char* available = std::strstr(buf_.data(), "MemAvailable:");
+    if (available) stats.mem_free = std::strtol(available + 13, nullptr, 10);
+    stats.mem_used = stats.mem_total - stats.mem_free;
+    stats.mem_percent = stats.mem_total > 0 ? 100.0f * (float)stats.mem_used / (float)stats.mem_total : 0.0f;
+}
+
+void SystemCollector::CollectPressure(SystemStats& stats) {
+    stats.cpu_pressure = Read(PRESSURE_CPU) > 0 ? PressureAvg10(buf_.data()) : -1.0f;
+    stats.memory_pressure = Read(PRESSURE_MEMORY) > 0 ? PressureAvg10(buf_.data()) : -1.0f;
+    stats.io_pressure = Read(PRESSURE_IO) > 0 ? PressureAvg10(buf_.data()) : -1.0f;
+}
+
+// --- Disks and network ---
+
+void SystemCollector::Rates(std::vector<Counters>& current, std::vector<Counters>& previous, double seconds,
+                            double scale, std::vector<float>& first_rates, std::vector<float>& second_rates) {
+    first_rates.assign(current.size(), 0.0f);
+    second_rates.assign(current.size(), 0.0f);
+    if (seconds > 0.0) {
+        double kb_per_unit = scale / 1024.0 / seconds;
+        for (size_t i = 0; i < current.size(); ++i) {
+            // Devices keep their order, so the match is almost always at i.
+            const Counters* prev = nullptr;
+            if (i < previous.size() && previous[i].name == current[i].name) {
+                prev = &previous[i];
+            } else {
+                for (const Counters& candidate : previous) {
+                    if (candidate.name == current[i].name) {
+                        prev = &candidate;
+                        break;
+                    }
+                }
+            }
+            if (!prev) continue; // New device: no rate until the next sample
+            first_rates[i] = (float)(CounterDelta(prev->first, current[i].first) * kb_per_unit);
+            second_rates[i] = (float)(CounterDelta(prev->second, current[i].second) * kb_per_unit);
+        }
+    }
+    previous.swap(current);
+}
+
+void SystemCollector::CollectDisks(std::vector<DiskStats>& disks) {
+    size_t count = 0;
+    if (Read(DISKSTATS) >= 0) {
+        std::string_view last_disk;
+        for (const char* p = buf_.data(); *p; p = NextLine(p)) {
+            // major minor name reads merged sectors_read ms writes merged sectors_written
+            const char* q = p;
+            ParseCounter(q);
+            ParseCounter(q);
+            q = SkipSpaces(q);
+            const char* name_end = q;
+            while (*name_end && *name_end != ' ' && *name_end != '\n') ++name_end;
+            std::string_view name(q, name_end - q);
+            q = name_end;
+            unsigned long long fields[7] = {};
+            for (unsigned long long& field : fields) field = ParseCounter(q);
+            if (name.empty()) continue;
+
+            if (IsPartitionOf(name, last_disk)) continue;
+            last_disk = name;
+            if (StartsWith(name, "loop") || StartsWith(name, "ram")) continue;
+            unsigned long long sectors_read = fields[2], sectors_written = fields[6];
+            if (sectors_read == 0 && sectors_written == 0) continue;
+
+            if (count == disks_.size()) disks_.emplace_back();
+            Counters& disk = disks_[count++];
+            disk.name.assign(name.data(), name.size());
+            disk.first = sectors_read;
+            disk.second = sectors_written;
+        }
+    }
+    disks_.resize(count);
+
+    auto now = read_time_;
+    double seconds = disks_time_.time_since_epoch().count() == 0
+        ? 0.0 : std::chrono::duration<double>(now - disks_time_).count();
+    disks_time_ = now;
+    // Sectors are 512 bytes whatever the device's block size.
+    Rates(disks_, disks_prev_, seconds, 512.0, first_rates_, second_rates_);
+
+    disks.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        disks[i].name = disks_prev_[i].name;
+        disks[i].read_rate_kb = first_rates_[i];
+        disks[i].write_rate_kb = second_rates_[i];
+        disks[i].history.clear();
+    }
+}
+
+void SystemCollector::CollectNetwork(std::vector<NetworkStats>& network) {
+    size_t count = 0;
+    if (Read(NETDEV) >= 0) {
+        const char* p = NextLine(NextLine(buf_.data())); // Two header lines
+        for (; *p; p = NextLine(p)) {
+            // The name is padded on the left and ends at the colon, which a
+            // large byte count may follow without a space.
+            const char* colon = std::strchr(p, ':');
+            const char* eol = std::strchr(p, '\n');
+            if (!colon || (eol && colon > eol)) continue;
+            const char* name = SkipSpaces(p);
+            const char* q = colon + 1;
+            unsigned long long fields[9] = {};
+            for (unsigned long long& field : fields) field = ParseCounter(q);
+
+            if (count == net_.size()) net_.emplace_back();
+            Counters& iface = net_[count++];
+            iface.name.assign(name, colon - name);
+            iface.first = fields[0];  // Received bytes
+            iface.second = fields[8]; // Transmitted bytes
+        }
+    }
+    net_.resize(count);
+
+    auto now = read_time_;
+    double seconds = net_time_.time_since_epoch().count() == 0
+        ? 0.0 : std::chrono::duration<double>(now - net_time_).count();
+    net_time_ = now;
+    Rates(net_, net_prev_, seconds, 1.0, first_rates_, second_rates_);
+
+    network.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        network[i].interface_name = net_prev_[i].name;
+        network[i].rx_rate_kb = first_rates_[i];
+        network[i].tx_rate_kb = second_rates_[i];
+        network[i].history.clear();
+    }
+}
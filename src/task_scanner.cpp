@@ -0,0 +1,28 @@
+#include "task_scanner.h"
+
+constexpr size_t TaskScanner::kCachedThreads;
+
+void TaskScanner::Follow(int pid, unsigned cgroup) {
+    if (pid != pid_ || !scanner_) {
+        pid_ = pid;
+        // Three fds (stat, status, io) per cached thread.
+        scanner_ = std::make_unique<ProcScanner>(ProcRoot() + "/" + std::to_string(pid) + "/task", 3 * kCachedThreads);
+        scanner_->SetPhaseTiming(false);
+        rates_ = RateEngine();
+    }
+    scanner_->SetFixedCgroup(cgroup);
+}
+
+void TaskScanner::Stop() {
+    pid_ = 0;
+    scanner_.reset();
+}
+
+void TaskScanner::Scan(std::vector<ProcessData>& threads, long long system_total_time) {
+    if (!scanner_) {
+        threads.clear();
+        return;
+    }
+    scanner_->Scan(threads);
+    rates_.Update(threads, system_total_time);
+}
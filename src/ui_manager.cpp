@@ -1,9 +1,64 @@
 #include "ui_manager.h"
+#include "instrumentation.h"
+#include "name_pool.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <ncurses.h>
 
+// Widest meter bar drawn, in cells.
+static const int kMaxMeterWidth = 512;
+
 // --- Helper Functions and Color Initialization (from before) ---
 void DrawMeter(int y, int x, int width, const char* label, float percent);
+void DrawSparkline(int y, int x, int width, const std::vector<float>& values, float max_value);
 void InitializeColors();
+void DrawTimingsOverlay();
+
+// PSI "some avg10" of CPU, memory and I/O: the share of the last 10 s some
+// task spent stalled waiting for each.
+static void DrawPressure(int y, int x, const SystemStats& stats) {
+    if (stats.cpu_pressure < 0 && stats.memory_pressure < 0 && stats.io_pressure < 0) {
+        mvprintw(y, x, "PSI: n/a");
+        return;
+    }
+    mvprintw(y, x, "PSI some avg10: cpu %.1f%%  mem %.1f%%  io %.1f%%", stats.cpu_pressure > 0 ? stats.cpu_pressure : 0.0f,
+             stats.memory_pressure > 0 ? stats.memory_pressure : 0.0f, stats.io_pressure > 0 ? stats.io_pressure : 0.0f);
+}
+
+// One cell per CPU, colored by how busy it was: numbered cells while they
+// fit on two rows, one column of shade each beyond that (so 128 cores still
+// fit in a few rows). Returns the rows drawn, at most `max_rows`.
+static int DrawCoreHeatmap(int y, int x, int width, int max_rows, const std::vector<float>& cores) {
+    static const char kLevels[] = " .:-=+*#%@";
+    const int levels = (int)sizeof(kLevels) - 2;
+    const int label_width = 6;
+    width -= label_width;
+    if (cores.empty() || width < 4 || max_rows <= 0) return 0;
+
+    int cell = (int)cores.size() <= 2 * (width / 4) ? 4 : 1;
+    int per_row = width / cell;
+    int rows = ((int)cores.size() + per_row - 1) / per_row;
+    if (rows > max_rows) rows = max_rows;
+
+    mvprintw(y, x, "Cores");
+    for (int i = 0; i < rows * per_row && i < (int)cores.size(); ++i) {
+        float v = cores[i];
+        int pair = v >= 90.0f ? 5 : v >= 60.0f ? 4 : v >= 25.0f ? 2 : 3;
+        attr_t attrs = COLOR_PAIR(pair) | (cell > 1 && v >= 60.0f ? A_REVERSE : 0);
+        attron(attrs);
+        if (cell > 1) {
+            mvprintw(y + i / per_row, x + label_width + i % per_row * cell, "%3.0f", v);
+        } else {
+            int level = (int)(v / 100.0f * levels + 0.5f);
+            if (level < 0) level = 0;
+            if (level > levels) level = levels;
+            mvaddch(y + i / per_row, x + label_width + i % per_row, kLevels[level]);
+        }
+        attroff(attrs);
+    }
+    return rows;
+}
 
 // --- NEW: The UI for the Performance Tab ---
 void DrawPerformanceUI(const SystemStats& stats) {
@@ -12,10 +67,21 @@ void DrawPerformanceUI(const SystemStats& stats) {
     int row = 0;
 
     // --- CPU and Memory ---
-    DrawMeter(row++, 1, term_width / 2 - 2, "CPU", stats.cpu_percent);
-    DrawMeter(row++, 1, term_width / 2 - 2, "MEM", stats.mem_percent);
+    // Meters on the left half, their recent history on the right. A meter
+    // at 100% ends at term_width / 2 + 1, so the label starts past that.
+    int label_x = term_width / 2 + 3;
+    int spark_x = label_x + 5;
+    int spark_width = term_width - spark_x - 1;
+    DrawMeter(row, 1, term_width / 2 - 2, "CPU", stats.cpu_percent);
+    mvprintw(row, label_x, "hist");
+    DrawSparkline(row++, spark_x, spark_width, stats.cpu_history, 100.0f);
+    DrawMeter(row, 1, term_width / 2 - 2, "MEM", stats.mem_percent);
+    mvprintw(row, label_x, "hist");
+    DrawSparkline(row++, spark_x, spark_width, stats.mem_history, 100.0f);
     mvprintw(row, 1, "MEM Used: %ld / %ld KB", stats.mem_used, stats.mem_total);
-    row += 2;
+    DrawPressure(row++, term_width / 2, stats);
+    row += DrawCoreHeatmap(row, 1, term_width - 2, 4, stats.core_percent);
+    row += 1;
 
     // --- GPUs ---
     attron(A_BOLD);
@@ -25,7 +91,8 @@ void DrawPerformanceUI(const SystemStats& stats) {
         mvprintw(row++, 1, "No NVIDIA GPU detected.");
     } else {
         for (const auto& gpu : stats.gpus) {
-            mvprintw(row, 1, "%s (GPU %d)", gpu.name.c_str(), gpu.id);
+            if (gpu.stale) mvprintw(row, 1, "%s (GPU %d) - stale, %d s old", gpu.name.c_str(), gpu.id, gpu.age_ms / 1000);
+            else mvprintw(row, 1, "%s (GPU %d)", gpu.name.c_str(), gpu.id);
             DrawMeter(row + 1, 2, term_width - 4, "Util", gpu.utilization);
             mvprintw(row + 2, 2, "VRAM: %d / %d MiB", gpu.mem_used_mb, gpu.mem_total_mb);
             row += 4;
@@ -41,88 +108,317 @@ void DrawPerformanceUI(const SystemStats& stats) {
     mvprintw(net_row++, col_width, "Network:");
     attroff(A_BOLD);
 
+    // Each device line is ~42 columns; any room left shows its history.
+    const int device_text_width = 43;
+    int device_spark_width = col_width - device_text_width - 2;
     for (const auto& disk : stats.disks) {
-        if(disk_row < term_height -1)
+        if(disk_row < term_height -1) {
+            DrawSparkline(disk_row, 1 + device_text_width, device_spark_width, disk.history, 0.0f);
             mvprintw(disk_row++, 1, "%-8s R: %7.1f KB/s, W: %7.1f KB/s", disk.name.c_str(), disk.read_rate_kb, disk.write_rate_kb);
+        }
     }
     for (const auto& net : stats.network) {
-         if(net_row < term_height -1)
+         if(net_row < term_height -1) {
+            DrawSparkline(net_row, col_width + 1 + device_text_width, device_spark_width, net.history, 0.0f);
             mvprintw(net_row++, col_width + 1, "%-8s RX: %7.1f KB/s, TX: %7.1f KB/s", net.interface_name.c_str(), net.rx_rate_kb, net.tx_rate_kb);
+         }
     }
 }
 
 // --- RENAMED: The UI for the Processes Tab ---
-void DrawProcessesUI(const std::vector<ProcessData>& processes, const std::string& sort_key, size_t selected_row) {
+static const int kProcessRowOffset = 5;
+
+size_t VisibleProcessRows() {
+    int rows = LINES - 1 - kProcessRowOffset;
+    return rows > 0 ? (size_t)rows : 0;
+}
+
+// Shows the cgroup of the selected process on the line above the table.
+static void DrawSelectedCgroup(const ProcessColumns& columns, size_t row) {
+    if (columns.cgroup[row] == 0) return;
+    mvprintw(2, 0, " %d %s in cgroup %s", columns.pid[row], ProcessName(columns.name[row]),
+             CgroupPath(columns.cgroup[row]).c_str());
+}
+
+// Lines under an expanded process, in the same columns. Threads share the
+// process's memory and have no history, so those columns stay blank.
+static void DrawThreadLine(int row, const ProcessData& t, bool last) {
+    attron(COLOR_PAIR(3) | A_DIM);
+    mvprintw(row, 0, "%-5d %s%-13.13s %-7.2f %-7s %-7s %-9s %-10.1f %-11.1f %-10.10s", t.pid, last ? "`-" : "|-",
+             ProcessName(t.name), t.cpu_usage, "", "", "", t.io_read_rate, t.io_write_rate, StateName(t.state));
+    attroff(COLOR_PAIR(3) | A_DIM);
+}
+
+void DrawProcessesUI(const ProcessColumns& columns, const std::vector<uint32_t>& order, SortKey sort_key,
+                     size_t selected_row, int expanded_pid, const std::vector<ProcessData>* threads) {
+    const ProcessColumns& c = columns;
     attron(COLOR_PAIR(1) | A_BOLD);
-    mvprintw(3, 0, " Arrows:Select | 'k':Kill | 'p':PID, 'm':Mem, 'c':CPU, 'i':I/O | 'v':Views | Sort: %s", sort_key.c_str());
+    mvprintw(3, 0, " Arrows:Select | Enter:Threads | '/':Filter | 'k':Kill | 'p','m','c','i':Sort | 'T':Tree | 'v':Views | Sort: %s", SortKeyName(sort_key));
     attroff(COLOR_PAIR(1) | A_BOLD);
 
     attron(A_REVERSE);
-    mvprintw(4, 0, "PID   NAME            CPU(%%)  MEM(KB)   READ/s(KB) WRITE/s(KB) STATE      ");
+    mvprintw(4, 0, "PID   NAME            CPU(%%)  1M(%%)   5M(%%)   MEM(KB)   READ/s(KB) WRITE/s(KB) STATE      ");
     attroff(A_REVERSE);
 
-    int row_offset = 5;
-    for (size_t i = 0; i < processes.size(); ++i) {
-        int current_row = i + row_offset;
+    // The expanded process (if it is on screen) is followed by up to half a
+    // screen of its threads and, when some are cut, a line counting the rest.
+    size_t visible = VisibleProcessRows();
+    size_t expanded = order.size();
+    size_t shown_threads = 0, thread_lines = 0;
+    if (expanded_pid != 0 && threads && !threads->empty()) {
+        size_t end = std::min(order.size(), selected_row + visible + 1);
+        for (size_t i = 0; i < end; ++i) {
+            if (c.pid[order[i]] == expanded_pid) { expanded = i; break; }
+        }
+        shown_threads = std::min(threads->size(), std::max<size_t>(visible / 2, 1));
+        thread_lines = shown_threads + (shown_threads < threads->size() ? 1 : 0);
+    }
+    auto line_of = [&](size_t i) { return i > expanded ? i + thread_lines : i; };
+
+    // Scroll so the selected row stays on screen.
+    size_t selected_line = line_of(selected_row);
+    size_t first = (visible > 0 && selected_line >= visible) ? selected_line - visible + 1 : 0;
+    for (size_t i = 0; i < order.size(); ++i) {
+        size_t line = line_of(i);
+        if (line + thread_lines < first) continue;
+        int current_row = (int)line - (int)first + kProcessRowOffset;
         if(current_row >= LINES - 1) break;
-        const auto& p = processes[i];
+        size_t r = order[i];
+        if (current_row >= kProcessRowOffset) {
+            if (i == selected_row) attron(A_REVERSE);
+            if (c.state[r] == 'R' && i != selected_row) attron(COLOR_PAIR(4) | A_BOLD);
+            else if (i != selected_row) attron(COLOR_PAIR(3));
+
+            mvprintw(current_row, 0, "%-5d %-15.15s %-7.2f %-7.2f %-7.2f %-9ld %-10.1f %-11.1f %-10.10s",
+                     c.pid[r], ProcessName(c.name[r]), c.cpu_usage[r], c.cpu_avg_1m[r], c.cpu_avg_5m[r], c.memory[r],
+                     c.io_read_rate[r], c.io_write_rate[r], StateName(c.state[r]));
+
+            if (i == selected_row) attroff(A_REVERSE);
+            else { attroff(COLOR_PAIR(3)); attroff(COLOR_PAIR(4) | A_BOLD); }
+        }
+        if (i != expanded) continue;
+        for (size_t t = 0; t < thread_lines; ++t) {
+            int row = current_row + 1 + (int)t;
+            if (row < kProcessRowOffset) continue;
+            if (row >= LINES - 1) break;
+            if (t < shown_threads) {
+                DrawThreadLine(row, (*threads)[t], t + 1 == thread_lines);
+            } else {
+                mvprintw(row, 6, "`- %zu more threads", threads->size() - shown_threads);
+            }
+        }
+    }
+    if (selected_row < order.size()) DrawSelectedCgroup(c, order[selected_row]);
+}
+
+// --- The cgroup view: one line per group, children indented under parents ---
+void DrawCgroupsUI(const std::vector<CgroupStats>& cgroups, size_t selected_row) {
+    attron(COLOR_PAIR(1) | A_BOLD);
+    mvprintw(3, 0, " Arrows:Select | 'v':Views | Root: %s", CgroupRoot().c_str());
+    attroff(COLOR_PAIR(1) | A_BOLD);
+
+    attron(A_REVERSE);
+    mvprintw(4, 0, "CGROUP                                   CPU(%%)  MEM(KB)    READ/s(KB) WRITE/s(KB) PSI(%%) ");
+    attroff(A_REVERSE);
+    if (cgroups.empty()) {
+        mvprintw(kProcessRowOffset, 1, "No cgroup v2 hierarchy at %s", CgroupRoot().c_str());
+        return;
+    }
+
+    size_t visible = VisibleProcessRows();
+    size_t first = (visible > 0 && selected_row >= visible) ? selected_row - visible + 1 : 0;
+    char label[64];
+    for (size_t i = first; i < cgroups.size(); ++i) {
+        int current_row = (int)(i - first) + kProcessRowOffset;
+        if (current_row >= LINES - 1) break;
+        const CgroupStats& group = cgroups[i];
+        size_t slash = group.path.rfind('/');
+        const char* name = group.depth == 0 ? "/" : group.path.c_str() + slash + 1;
+        snprintf(label, sizeof(label), "%*s%s", std::min(group.depth, 12) * 2, "", name);
+
         if (i == selected_row) attron(A_REVERSE);
-        if (p.state.find("R (running)") != std::string::npos && i != selected_row) attron(COLOR_PAIR(4) | A_BOLD);
-        else if (i != selected_row) attron(COLOR_PAIR(3));
-        
-        mvprintw(current_row, 0, "%-5d %-15.15s %-7.2f %-9ld %-10.1f %-11.1f %-10.10s", 
-                 p.pid, p.name.c_str(), p.cpu_usage, p.memory, 
-                 p.io_read_rate, p.io_write_rate, p.state.c_str());
-        
+        else attron(COLOR_PAIR(3));
+        mvprintw(current_row, 0, "%-40.40s %-7.2f %-10ld %-10.1f %-11.1f %-6.2f", label, group.cpu_percent,
+                 group.memory_kb, group.io_read_rate_kb, group.io_write_rate_kb, group.cpu_pressure);
+        if (i == selected_row) attroff(A_REVERSE);
+        else attroff(COLOR_PAIR(3));
+    }
+}
+
+// Tree mode: every figure is the subtree total; PROCS counts the process
+// and its descendants.
+void DrawTreeUI(const ProcessColumns& columns, const ProcessTree& tree, SortKey sort_key, size_t selected_row) {
+    const ProcessColumns& c = columns;
+    attron(COLOR_PAIR(1) | A_BOLD);
+    mvprintw(3, 0, " Arrows:Select | '+'/'-':Expand/Collapse | '/':Filter | 'k':Kill | 'p','m','c','i':Sort | 'T':List | Sort: %s", SortKeyName(sort_key));
+    attroff(COLOR_PAIR(1) | A_BOLD);
+
+    attron(A_REVERSE);
+    mvprintw(4, 0, "PID   TREE                         CPU(%%)  MEM(KB)    READ/s(KB) WRITE/s(KB) PROCS  STATE     ");
+    attroff(A_REVERSE);
+
+    const std::vector<ProcessTree::Row>& rows = tree.Rows();
+    size_t visible = VisibleProcessRows();
+    size_t first = (visible > 0 && selected_row >= visible) ? selected_row - visible + 1 : 0;
+    char label[64];
+    for (size_t i = first; i < rows.size(); ++i) {
+        int current_row = (int)(i - first) + kProcessRowOffset;
+        if (current_row >= LINES - 1) break;
+        const ProcessTree::Row& row = rows[i];
+        size_t r = row.index;
+        const ProcessTree::Rollup& total = tree.Total(r);
+        int indent = std::min(row.depth, 12) * 2;
+        const char* marker = !row.has_children ? "  " : row.collapsed ? "+ " : "- ";
+        snprintf(label, sizeof(label), "%*s%s%s", indent, "", marker, ProcessName(c.name[r]));
+
+        if (i == selected_row) attron(A_REVERSE);
+        else if (c.state[r] == 'R') attron(COLOR_PAIR(4) | A_BOLD);
+        else attron(COLOR_PAIR(3));
+        mvprintw(current_row, 0, "%-5d %-28.28s %-7.2f %-10ld %-10.1f %-11.1f %-6d %-10.10s",
+                 c.pid[r], label, total.cpu_usage, total.memory, total.io_read_rate, total.io_write_rate,
+                 total.descendants + 1, StateName(c.state[r]));
         if (i == selected_row) attroff(A_REVERSE);
         else { attroff(COLOR_PAIR(3)); attroff(COLOR_PAIR(4) | A_BOLD); }
     }
+    if (selected_row < rows.size()) DrawSelectedCgroup(c, rows[selected_row].index);
 }
 
 // --- Main DrawUI function that switches between views ---
-void DrawUI(enum ViewMode view, const SystemStats& stats, const std::vector<ProcessData>& processes, const std::string& sort_key, size_t selected_row) {
+void DrawUI(enum ViewMode view, const SystemStats& stats, const ProcessColumns& columns,
+            const std::vector<uint32_t>& order, SortKey sort_key, size_t selected_row, const std::string& status, bool show_timings, const ProcessTree* tree, int expanded_pid,
+            const std::vector<ProcessData>* threads, const std::string& footer) {
     static bool colors_initialized = false;
     if (!colors_initialized) {
         InitializeColors();
         colors_initialized = true;
     }
     
-    clear();
+    // erase() only blanks the virtual screen; unlike clear() it does not
+    // force a full repaint, so doupdate() sends just the cells that changed
+    // since the last frame.
+    erase();
     
     // Main header
     attron(A_BOLD);
-    mvprintw(0, 0, "Process Monitor - Press 'v' to switch views");
+    if (status.empty()) mvprintw(0, 0, "Process Monitor - Press 'v' to switch views");
+    else mvprintw(0, 0, "Process Monitor - %s", status.c_str());
     attroff(A_BOLD);
 
     if (view == ViewMode::PERFORMANCE) {
         DrawPerformanceUI(stats);
+    } else if (view == ViewMode::CGROUPS) {
+        DrawCgroupsUI(stats.cgroups, selected_row);
+    } else if (tree) {
+        DrawTreeUI(columns, *tree, sort_key, selected_row);
     } else {
-        DrawProcessesUI(processes, sort_key, selected_row);
+        DrawProcessesUI(columns, order, sort_key, selected_row, expanded_pid, threads);
     }
+    if (!footer.empty()) {
+        attron(A_BOLD);
+        mvprintw(LINES - 1, 0, "%.*s", COLS, footer.c_str());
+        attroff(A_BOLD);
+    }
+    if (show_timings) DrawTimingsOverlay();
     
-    refresh();
+    wnoutrefresh(stdscr);
+    doupdate();
 }
 
 // --- Unchanged helper functions ---
+// Fits a nanosecond count in six columns: "812ns", "45.3us", "1.20ms", "3.4s".
+static void FormatNs(char* out, size_t size, uint64_t ns) {
+    if (ns < 1000) snprintf(out, size, "%lluns", (unsigned long long)ns);
+    else if (ns < 1000000) snprintf(out, size, "%.1fus", ns / 1e3);
+    else if (ns < 1000000000) snprintf(out, size, "%.2fms", ns / 1e6);
+    else snprintf(out, size, "%.1fs", ns / 1e9);
+}
+
+// --- Timing overlay ('t'): per-phase last/p50/p99/max since startup ---
+void DrawTimingsOverlay() {
+    const int width = 56;
+    const int height = (int)Phase::COUNT + 5;
+    int x = COLS - width;
+    if (x < 0 || LINES < height + 1) return;
+
+    for (int row = 1; row <= height; ++row) mvhline(row, x, ' ', width);
+    attron(A_BOLD);
+    mvprintw(1, x + 1, "%-10s %8s %8s %8s %8s %7s", "phase", "last", "p50", "p99", "max", "count");
+    attroff(A_BOLD);
+    if (!InstrumentationEnabled()) {
+        mvprintw(3, x + 1, "instrumentation compiled out (INSTRUMENT=0)");
+        return;
+    }
+
+    char last[16], p50[16], p99[16], max[16];
+    for (int i = 0; i < (int)Phase::COUNT; ++i) {
+        PhaseSummary summary = SummarizePhase((Phase)i);
+        FormatNs(last, sizeof(last), summary.last_ns);
+        FormatNs(p50, sizeof(p50), summary.p50_ns);
+        FormatNs(p99, sizeof(p99), summary.p99_ns);
+        FormatNs(max, sizeof(max), summary.max_ns);
+        if (summary.count == 0) mvprintw(2 + i, x + 1, "%-10s %8s", PhaseName((Phase)i), "-");
+        else mvprintw(2 + i, x + 1, "%-10s %8s %8s %8s %8s %7llu", PhaseName((Phase)i), last, p50, p99, max,
+                      (unsigned long long)summary.count);
+    }
+    TickIo io = LastTickIo();
+    mvprintw(3 + (int)Phase::COUNT, x + 1, "last tick: %llu syscalls, %.1f KB read from /proc",
+             (unsigned long long)io.syscalls, io.bytes / 1024.0);
+}
+
 void DrawMeter(int y, int x, int width, const char* label, float percent) {
     int bar_width = width - 10;
     if (bar_width < 0) bar_width = 0;
+    if (bar_width > kMaxMeterWidth) bar_width = kMaxMeterWidth;
     int fill_width = (int)(bar_width * (percent / 100.0f));
-    
+    if (fill_width < 0) fill_width = 0;
+    if (fill_width > bar_width) fill_width = bar_width;
+
+    // Build the whole bar first and write it in one call.
+    char bar[kMaxMeterWidth];
+    std::memset(bar, '|', fill_width);
+    std::memset(bar + fill_width, ' ', bar_width - fill_width);
+
     mvprintw(y, x, "%-4s[", label);
     attron(COLOR_PAIR(2));
-    for (int i = 0; i < bar_width; ++i) {
-        if (i < fill_width) printw("|");
-        else printw(" ");
-    }
+    addnstr(bar, bar_width);
     attroff(COLOR_PAIR(2));
     printw("] %.1f%%", percent);
 }
 
+// Draws the newest `width` values as ASCII bars. `max_value` of 0 scales to
+// the largest value shown.
+void DrawSparkline(int y, int x, int width, const std::vector<float>& values, float max_value) {
+    static const char kLevels[] = " .:-=+*#%@";
+    const int levels = (int)sizeof(kLevels) - 2;
+    if (width <= 0 || values.empty()) return;
+    if (width > kMaxMeterWidth) width = kMaxMeterWidth;
+
+    size_t count = values.size() < (size_t)width ? values.size() : (size_t)width;
+    size_t first = values.size() - count;
+    if (max_value <= 0.0f) {
+        for (size_t i = first; i < values.size(); ++i) {
+            if (values[i] > max_value) max_value = values[i];
+        }
+    }
+
+    char line[kMaxMeterWidth];
+    for (size_t i = 0; i < count; ++i) {
+        float v = values[first + i];
+        int level = max_value > 0.0f ? (int)(v / max_value * levels + 0.5f) : 0;
+        if (level < 0) level = 0;
+        if (level > levels) level = levels;
+        line[i] = kLevels[level];
+    }
+    attron(COLOR_PAIR(2));
+    mvaddnstr(y, x, line, (int)count);
+    attroff(COLOR_PAIR(2));
+}
+
 void InitializeColors() {
     start_color();
     init_pair(1, COLOR_CYAN, COLOR_BLACK);
     init_pair(2, COLOR_GREEN, COLOR_BLACK);
     init_pair(3, COLOR_WHITE, COLOR_BLACK);
     init_pair(4, COLOR_YELLOW, COLOR_BLACK);
+    init_pair(5, COLOR_RED, COLOR_BLACK);
 }
@@ -0,0 +1,76 @@
+#include "worker_pool.h"
+
+WorkStealingPool::WorkStealingPool(unsigned workers)
+    : workers_(workers ? workers : 1), ranges_(new Range[workers_]) {
+    for (unsigned w = 1; w < workers_; ++w) {
+        threads_.emplace_back(&WorkStealingPool::ThreadMain, this, w);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto& t : threads_) t.join();
+}
+
+void WorkStealingPool::Run(size_t chunks, const std::function<void(unsigned, size_t)>& fn) {
+    if (chunks == 0) return;
+
+    // Deal the chunks out as evenly sized contiguous ranges.
+    size_t per_worker = chunks / workers_;
+    size_t extra = chunks % workers_;
+    size_t begin = 0;
+    for (unsigned w = 0; w < workers_; ++w) {
+        size_t count = per_worker + (w < extra ? 1 : 0);
+        ranges_[w].next.store(begin, std::memory_order_relaxed);
+        ranges_[w].end = begin + count;
+        begin += count;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fn_ = &fn;
+        running_ = workers_ - 1;
+        ++batch_;
+    }
+    start_cv_.notify_all();
+
+    Drain(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return running_ == 0; });
+    fn_ = nullptr;
+}
+
+void WorkStealingPool::ThreadMain(unsigned worker) {
+    unsigned long long seen_batch = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_cv_.wait(lock, [&] { return stop_ || batch_ != seen_batch; });
+            if (stop_) return;
+            seen_batch = batch_;
+        }
+
+        Drain(worker);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--running_ == 0) done_cv_.notify_one();
+    }
+}
+
+void WorkStealingPool::Drain(unsigned worker) {
+    // Own range first, then steal from the others, starting with the next one.
+    for (unsigned i = 0; i < workers_; ++i) {
+        unsigned victim = (worker + i) % workers_;
+        Range& r = ranges_[victim];
+        while (true) {
+            size_t chunk = r.next.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= r.end) break;
+            (*fn_)(worker, chunk);
+        }
+    }
+}